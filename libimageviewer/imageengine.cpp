@@ -15,6 +15,7 @@
 #include "service/commonservice.h"
 #include "unionimage/imgoperate.h"
 #include "unionimage/unionimage.h"
+#include "unionimage/snifferimageformat.h"
 #include "service/permissionconfig.h"
 #include "service/imagedataservice.h"
 
@@ -98,13 +99,12 @@ void ImageEngine::makeImgThumbnail(QString thumbnailSavePath, QStringList paths,
 bool ImageEngine::isImage(const QString &path)
 {
     qDebug() << "Checking if file is image:" << path;
-    bool bRet = false;
+    // 先按扩展名匹配，未命中时再读取文件头嗅探格式，不使用QMimeDatabase逐条扫描内容规则
     QMimeDatabase db;
-    QMimeType mt = db.mimeTypeForFile(path, QMimeDatabase::MatchContent);
     QMimeType mt1 = db.mimeTypeForFile(path, QMimeDatabase::MatchExtension);
-    if (mt.name().startsWith("image/") || mt.name().startsWith("video/x-mng") || mt1.name().startsWith("image/") ||
-        mt1.name().startsWith("video/x-mng")) {
-        bRet = true;
+    bool bRet = mt1.name().startsWith("image/") || mt1.name().startsWith("video/x-mng");
+    if (!bRet) {
+        bRet = !DetectImageFormat(path).isEmpty();
     }
     qDebug() << "File" << path << "is" << (bRet ? "an image" : "not an image");
     return bRet;
@@ -30,7 +30,8 @@ public:
     //是否是可选转的图片
     bool isRotatable(const QString &path);
 
-    //根据文件路径制作md5
+    //根据文件路径制作md5，需读取文件内容，仅为兼容保留
+    //缓存键请使用LibUnionImage_NameSpace::fileIdentity
     QString makeMD5(const QString &path);
 
 signals:
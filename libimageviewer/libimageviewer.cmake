@@ -70,6 +70,44 @@ else()
     message("--- Not found dfm-io, use base api copy MTP file.")
 endif()
 
+#find libturbojpeg, used for lossless JPEG rotation
+pkg_check_modules(turbojpeg_lib libturbojpeg)
+
+if(${turbojpeg_lib_FOUND})
+    message("--- Found ${turbojpeg_lib_LIBRARIES}, enable lossless JPEG rotation.")
+    add_definitions(-DUSE_TURBOJPEG)
+else()
+    message("--- Not found libturbojpeg, rotate JPEG by decode and encode.")
+endif()
+
+#find libjpeg and libpng, used for progressive display of large images
+pkg_check_modules(jpeg_lib libjpeg)
+pkg_check_modules(png_lib libpng)
+
+if(${jpeg_lib_FOUND})
+    message("--- Found ${jpeg_lib_LIBRARIES}, enable progressive JPEG display.")
+    add_definitions(-DUSE_LIBJPEG)
+else()
+    message("--- Not found libjpeg, decode large JPEG at once.")
+endif()
+
+if(${png_lib_FOUND})
+    message("--- Found ${png_lib_LIBRARIES}, enable progressive PNG display.")
+    add_definitions(-DUSE_LIBPNG)
+else()
+    message("--- Not found libpng, decode large PNG at once.")
+endif()
+
+#find libxxhash, used for file identity content hash
+pkg_check_modules(xxhash_lib libxxhash)
+
+if(${xxhash_lib_FOUND})
+    message("--- Found ${xxhash_lib_LIBRARIES}, use xxHash for content sampling hash.")
+    add_definitions(-DUSE_XXHASH)
+else()
+    message("--- Not found libxxhash, use FNV-1a for content sampling hash.")
+endif()
+
 #需要打开的头文件
 FILE(GLOB allHeaders "*.h" "*/*.h" "*/*/*.h")
 
@@ -112,7 +150,7 @@ add_library(${TARGET_NAME} SHARED ${allHeaders} ${allSources} ${RESOURCES} ${QM}
 # 将库安装到指定位置
 set_target_properties(${TARGET_NAME} PROPERTIES VERSION 0.1.0 SOVERSION 0.1)
 
-target_include_directories(${TARGET_NAME} PUBLIC ${3rd_lib_INCLUDE_DIRS} ${TIFF_INCLUDE_DIRS} ${dfm-io_lib_INCLUDE_DIRS})
+target_include_directories(${TARGET_NAME} PUBLIC ${3rd_lib_INCLUDE_DIRS} ${TIFF_INCLUDE_DIRS} ${dfm-io_lib_INCLUDE_DIRS} ${turbojpeg_lib_INCLUDE_DIRS} ${jpeg_lib_INCLUDE_DIRS} ${png_lib_INCLUDE_DIRS} ${xxhash_lib_INCLUDE_DIRS})
 target_link_libraries(${TARGET_NAME}
     Qt${QT_VERSION_MAJOR}::Core
     Qt${QT_VERSION_MAJOR}::Gui
@@ -124,6 +162,10 @@ target_link_libraries(${TARGET_NAME}
     ${3rd_lib_LIBRARIES}
     ${TIFF_LIBRARIES}
     ${dfm-io_lib_LIBRARIES}
+    ${turbojpeg_lib_LIBRARIES}
+    ${jpeg_lib_LIBRARIES}
+    ${png_lib_LIBRARIES}
+    ${xxhash_lib_LIBRARIES}
     dl)
 
 if(${QT_VERSION_MAJOR} EQUAL 6)
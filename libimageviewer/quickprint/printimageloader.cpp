@@ -4,9 +4,10 @@
 
 #include "printimageloader.h"
 #include "unionimage/unionimage.h"
+#include "service/decodedimagecache.h"
+#include "service/taskscheduler.h"
 
 #include <QImageReader>
-#include <QtConcurrent>
 
 static const int s_SingleFrame = -1;
 
@@ -99,6 +100,7 @@ void PrintImageLoader::cancel()
     }
 
     loadData.clear();
+    preloadData.clear();
     loaderState = Stopped;
 }
 
@@ -275,6 +277,13 @@ bool PrintImageLoader::loadImageData(PrintImageData::Ptr &imagePtr)
         return false;
     }
 
+    // 单帧图片与看图、幻灯片共享解码缓存
+    if (s_SingleFrame == imagePtr->frame && LibDecodedImageCache::instance()->find(imagePtr->filePath, imagePtr->data)) {
+        qDebug() << "Using cached decoded image:" << imagePtr->filePath;
+        imagePtr->state = Loaded;
+        return true;
+    }
+
     try {
         QImageReader reader(imagePtr->filePath);
         // jumpToImage 可能返回 false, 但数据正常读取
@@ -329,28 +338,25 @@ bool PrintImageLoader::syncPreload(const QStringList &fileList)
 }
 
 /**
-   @brief 使用 QtConcurrent 并行预载 \a fileLists 文件，成功预载后自动触发加载 asyncLoad()
+   @brief 使用任务调度器并行预载 \a fileLists 文件，成功预载后自动触发加载 asyncLoad()
    @sa onAsyncLoadFinished(), asyncLoad()
  */
 void PrintImageLoader::asyncPreload(const QStringList &fileList)
 {
-    // 默认 lambda 捕获没带 result_type 信息，用 std::function 包装
-    std::function<PrintDataList(const QString &)> preloadMapedFunc = [this](const QString &filePath) -> PrintDataList {
-        PrintDataList parsed = PrintImageLoader::preloadImageData(filePath);
+    // 每个文件的预载结果单独保存，完成后按*顺序*合并
+    preloadData.clear();
+    for (const QString &filePath : fileList) {
+        preloadData.append(qMakePair(filePath, PrintDataList()));
+    }
+
+    QFuture<void> asyncData = LibTaskScheduler::instance()->map(LibTaskScheduler::VisibleImage, preloadData,
+                                                                [this](QPair<QString, PrintDataList> &item) {
+        item.second = PrintImageLoader::preloadImageData(item.first);
         // 异常文件，通知停止处理，处于不同线程
-        if (!parsed.isEmpty() && !(parsed.first()->state == Normal || parsed.first()->state == Loaded)) {
-            Q_EMIT this->asyncLoadError(filePath);
+        if (!item.second.isEmpty() && !(item.second.first()->state == Normal || item.second.first()->state == Loaded)) {
+            Q_EMIT this->asyncLoadError(item.first);
         }
-
-        return parsed;
-    };
-
-    // 按*顺序*插入数据
-    QFuture<PrintDataList> asyncData = QtConcurrent::mappedReduced<PrintDataList>(
-            fileList,
-            preloadMapedFunc,
-            [](PrintDataList &result, const PrintDataList &parsed) { result.append(parsed); },
-            (QtConcurrent::OrderedReduce | QtConcurrent::SequentialReduce));
+    });
 
     // 仅在调用时绑定信号
     connect(&preloadWatcher, &QFutureWatcherBase::finished, this, &PrintImageLoader::onAsyncLoadFinished);
@@ -378,7 +384,7 @@ bool PrintImageLoader::syncLoad(PrintDataList &dataList)
  */
 void PrintImageLoader::asyncLoad(PrintDataList &dataList)
 {
-    QFuture<void> asyncData = QtConcurrent::map(dataList, [this](PrintImageData::Ptr &dataPtr) {
+    QFuture<void> asyncData = LibTaskScheduler::instance()->map(LibTaskScheduler::VisibleImage, dataList, [this](PrintImageData::Ptr &dataPtr) {
         if (!PrintImageLoader::loadImageData(dataPtr)) {
             Q_EMIT this->asyncLoadError(dataPtr->filePath);
         }
@@ -398,9 +404,13 @@ void PrintImageLoader::onAsyncLoadFinished()
     case Preloading:
         qInfo() << "Async print image preload finished.";
         // 清理缓存的数据, 继续加载数据
-        loadData = preloadWatcher.result();
+        loadData.clear();
+        for (const QPair<QString, PrintDataList> &item : preloadData) {
+            loadData.append(item.second);
+        }
+        preloadData.clear();
         disconnect(&preloadWatcher, &QFutureWatcherBase::finished, this, &PrintImageLoader::onAsyncLoadFinished);
-        preloadWatcher.setFuture(QFuture<PrintDataList>());
+        preloadWatcher.setFuture(QFuture<void>());
         loaderState = Loading;
         asyncLoad(loadData);
         break;
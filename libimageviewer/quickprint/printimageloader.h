@@ -9,6 +9,7 @@
 #include <QObject>
 #include <QSharedPointer>
 #include <QFutureWatcher>
+#include <QPair>
 
 enum ImageFileState {  // 图片文件状态
     Normal,
@@ -72,7 +73,8 @@ private:
     enum LoaderState { Stopped, Preloading, Loading };
     LoaderState loaderState = Stopped;  // 加载器状态
     PrintDataList loadData;             // 加载数据，Note:在异步加载过程中不可读取
-    QFutureWatcher<PrintDataList> preloadWatcher;
+    QList<QPair<QString, PrintDataList>> preloadData;  // 异步预载的文件及结果，完成后按顺序合并到loadData
+    QFutureWatcher<void> preloadWatcher;
     QFutureWatcher<void> loadWatcher;
 
     Q_DISABLE_COPY(PrintImageLoader)
@@ -6,7 +6,6 @@
 #include "aimodelservice_p.h"
 
 #include <QPushButton>
-#include <QtConcurrent>
 #include <QDBusInterface>
 #include <QDBusReply>
 #include <QDebug>
@@ -17,6 +16,7 @@
 
 #include "unionimage/unionimage.h"
 #include "service/commonservice.h"
+#include "service/taskscheduler.h"
 
 DWIDGET_USE_NAMESPACE
 
@@ -362,7 +362,7 @@ QString AIModelService::imageProcessing(const QString &filePath, int modelID, co
 
     qInfo() << QString("Call enhance processing %1, %2").arg(dptr->lastOutput).arg(model);
 
-    QFuture<EnhancePtr> f = QtConcurrent::run([=]() -> EnhancePtr {
+    QFuture<EnhancePtr> f = LibTaskScheduler::instance()->run(LibTaskScheduler::VisibleImage, [=]() -> EnhancePtr {
         if (AIModelService::Cancel == ptr->state.loadAcquire()) {
             qDebug() << "Enhance process cancelled before start";
             return ptr;
@@ -410,7 +410,7 @@ void AIModelService::reloadImageProcessing(const QString &filePath)
     ptr->state.storeRelease(Loading);
     qInfo() << QString("Reload enhance processing %1, %2").arg(ptr->output).arg(ptr->model);
 
-    QFuture<EnhancePtr> f = QtConcurrent::run([=]() -> EnhancePtr {
+    QFuture<EnhancePtr> f = LibTaskScheduler::instance()->run(LibTaskScheduler::VisibleImage, [=]() -> EnhancePtr {
         if (AIModelService::Cancel == ptr->state.loadAcquire()) {
             qDebug() << "Reload process cancelled before start";
             return ptr;
@@ -11,6 +11,7 @@
 #include <QDebug>
 
 #include "imageengine.h"
+#include "thumbnailstore.h"
 
 LibCommonService *LibCommonService::m_commonService = nullptr;
 LibCommonService *LibCommonService::instance()
@@ -48,11 +49,27 @@ QString LibCommonService::getImgSavePath()
 imageViewerSpace::ItemInfo LibCommonService::getImgInfoByPath(QString path)
 {
     QMutexLocker locker(&m_mutex);
-    QMap<QString, imageViewerSpace::ItemInfo> m_tempInfoMap = m_allInfoMap;
-    if (!m_tempInfoMap.contains(path)) {
+    if (!m_allInfoMap.contains(path)) {
         qWarning() << "Image info not found for path:" << path;
     }
-    return m_tempInfoMap[path];
+    imageViewerSpace::ItemInfo info = m_allInfoMap.value(path);
+    // 缩略图统一保存在LibThumbnailStore，已被淘汰时为空
+    LibThumbnailStore::instance()->find(path, info.image);
+    return info;
+}
+
+bool LibCommonService::setImgPreviewByPath(const QString &path, const imageViewerSpace::ItemInfo &itemInfo)
+{
+    QMutexLocker locker(&m_mutex);
+    // 已读取过完整信息（含损坏）时不覆盖，缩略图被淘汰后也不能用预览的尺寸和空白类型替换真实元数据
+    auto itr = m_allInfoMap.constFind(path);
+    if (itr != m_allInfoMap.constEnd() && itr->imageType != imageViewerSpace::ImageTypeBlank) {
+        return false;
+    }
+    qDebug() << "Setting preview image info for path:" << path;
+    storeItemInfo(path, itemInfo);
+    emit ImageEngine::instance()->sigOneImgReady(path, itemInfo);
+    return true;
 }
 
 /*void CommonService::setImgInfoByPat(QString path, imageViewerSpace::ItemInfo itemInfo)
@@ -68,6 +85,8 @@ void LibCommonService::reName(const QString &oldPath, const QString &newPath)
     info.path = newPath;
     m_allInfoMap[newPath] = info;
     m_allInfoMap.remove(oldPath);
+    LibThumbnailStore::instance()->rename(oldPath, newPath);
+    LibThumbnailStore::instance()->find(newPath, info.image);
     emit ImageEngine::instance()->sigOneImgReady(oldPath, info);
 }
 
@@ -75,10 +94,23 @@ void LibCommonService::slotSetImgInfoByPath(QString path, imageViewerSpace::Item
 {
     qDebug() << "Setting image info for path:" << path;
     QMutexLocker locker(&m_mutex);
-    m_allInfoMap[path] = itemInfo;
+    storeItemInfo(path, itemInfo);
     emit ImageEngine::instance()->sigOneImgReady(path, itemInfo);
 }
 
+void LibCommonService::storeItemInfo(const QString &path, const imageViewerSpace::ItemInfo &itemInfo)
+{
+    // 信息表只保存元数据，缩略图交由LibThumbnailStore按预算管理，避免重复持有
+    imageViewerSpace::ItemInfo info = itemInfo;
+    if (info.image.isNull()) {
+        LibThumbnailStore::instance()->remove(path);
+    } else {
+        LibThumbnailStore::instance()->insert(path, info.image);
+        info.image = QImage();
+    }
+    m_allInfoMap[path] = info;
+}
+
 LibCommonService::LibCommonService(QObject *parent) : QObject(parent)
 {
     qDebug() << "LibCommonService constructor called";
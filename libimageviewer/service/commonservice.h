@@ -31,6 +31,9 @@ public:
     //不发数据更新信号的保存信息
     //void setImgInfoByPat(QString path, imageViewerSpace::ItemInfo itemInfo);
 
+    //设置预览缩略图信息，已读取到完整图片信息或图片已损坏时不覆盖
+    bool setImgPreviewByPath(const QString &path, const imageViewerSpace::ItemInfo &itemInfo);
+
     //重命名更新缓存
     void reName(const QString &oldPath, const QString &newPath);
 
@@ -47,12 +50,14 @@ public slots:
 private:
     explicit LibCommonService(QObject *parent = nullptr);
     bool eventFilter(QObject *obj, QEvent *event);
+    //保存图片信息，缩略图存入LibThumbnailStore，需持有m_mutex
+    void storeItemInfo(const QString &path, const imageViewerSpace::ItemInfo &itemInfo);
 private:
     static LibCommonService *m_commonService;
     QMutex m_mutex;
     imageViewerSpace::ImgViewerType m_imgViewerType = imageViewerSpace::ImgViewerTypeNull;
     QString       m_imgSavePath;
-    QMap<QString, imageViewerSpace::ItemInfo> m_allInfoMap;//图片所有信息map
+    QMap<QString, imageViewerSpace::ItemInfo> m_allInfoMap;//图片所有信息map，不含缩略图
 
 
 };
@@ -0,0 +1,154 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "decodedimagecache.h"
+#include "unionimage/unionimage.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <climits>
+
+namespace {
+
+// 默认缓存预算
+const qint64 DEFAULT_CACHE_MAX_BYTES = 512LL * 1024 * 1024;
+
+int imageCostKB(const QImage &image, bool withLevels = false)
+{
+    // 逐级减半的图片合计约为原图的三分之一
+    const qint64 bytes = withLevels ? image.sizeInBytes() + image.sizeInBytes() / 3 : image.sizeInBytes();
+    return static_cast<int>(qMax<qint64>(1, bytes / 1024));
+}
+
+}
+
+LibDecodedImageCache *LibDecodedImageCache::instance()
+{
+    static LibDecodedImageCache cache;
+    return &cache;
+}
+
+LibDecodedImageCache::LibDecodedImageCache()
+{
+    setMaxBytes(DEFAULT_CACHE_MAX_BYTES);
+}
+
+bool LibDecodedImageCache::find(const QString &path, QImage &image,
+                                QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> *tiledSource)
+{
+    const LibUnionImage_NameSpace::FileIdentity identity = LibUnionImage_NameSpace::fileIdentity(path);
+
+    QMutexLocker locker(&m_mutex);
+    Entry *entry = m_cache.object(path);
+    if (entry && identity.isValid() && entry->identity == identity) {
+        ++m_hits;
+        image = entry->image;
+        if (tiledSource) {
+            *tiledSource = entry->tiledSource;
+        }
+        return true;
+    }
+    if (entry) {
+        qDebug() << "Decoded image cache entry outdated:" << path;
+        m_cache.remove(path);
+    }
+    ++m_misses;
+    return false;
+}
+
+bool LibDecodedImageCache::contains(const QString &path) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_cache.contains(path);
+}
+
+void LibDecodedImageCache::insert(const QString &path, const QImage &image)
+{
+    if (image.isNull()) {
+        return;
+    }
+    const LibUnionImage_NameSpace::FileIdentity identity = LibUnionImage_NameSpace::fileIdentity(path);
+    if (!identity.isValid()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    // QCache在代价超过上限时直接删除条目
+    m_cache.insert(path, new Entry{image, identity}, imageCostKB(image));
+}
+
+void LibDecodedImageCache::setTiledSource(const QString &path,
+                                          const QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> &source)
+{
+    if (source.isNull()) {
+        return;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    Entry *entry = m_cache.take(path);
+    if (!entry) {
+        return;
+    }
+    // 只附加到生成分块源的同一份解码结果上，重新放入以按新的代价计算预算
+    if (entry->image.cacheKey() == source->image().cacheKey()) {
+        entry->tiledSource = source;
+    }
+    m_cache.insert(path, entry, imageCostKB(entry->image, !entry->tiledSource.isNull()));
+}
+
+void LibDecodedImageCache::remove(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.remove(path);
+}
+
+void LibDecodedImageCache::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_cache.clear();
+}
+
+bool LibDecodedImageCache::loadImage(const QString &path, QImage &res, QString &errorMsg)
+{
+    if (find(path, res)) {
+        return true;
+    }
+    if (!LibUnionImage_NameSpace::loadStaticImageFromFile(path, res, errorMsg)) {
+        return false;
+    }
+    insert(path, res);
+    return true;
+}
+
+void LibDecodedImageCache::setMaxBytes(qint64 bytes)
+{
+    qDebug() << "Decoded image cache budget:" << bytes / 1024 / 1024 << "MB";
+    QMutexLocker locker(&m_mutex);
+    m_cache.setMaxCost(static_cast<int>(qBound<qint64>(0, bytes / 1024, INT_MAX)));
+}
+
+qint64 LibDecodedImageCache::maxBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<qint64>(m_cache.maxCost()) * 1024;
+}
+
+qint64 LibDecodedImageCache::totalBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return static_cast<qint64>(m_cache.totalCost()) * 1024;
+}
+
+quint64 LibDecodedImageCache::hitCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+quint64 LibDecodedImageCache::missCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
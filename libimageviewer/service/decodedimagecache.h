@@ -0,0 +1,83 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef DECODEDIMAGECACHE_H
+#define DECODEDIMAGECACHE_H
+
+#include <QCache>
+#include <QImage>
+#include <QMutex>
+#include <QSharedPointer>
+#include <QString>
+
+#include "unionimage/fileidentity.h"
+#include "unionimage/tiledimagesource.h"
+
+/**
+ * @brief The LibDecodedImageCache class
+ * 进程内共享的原图解码缓存，看图、幻灯片、打印等使用同一份解码结果
+ * 以路径为键，条目记录文件大小和修改时间，文件变化后旧条目失效
+ * 按字节预算做LRU淘汰，缓存的QImage隐式共享，取出时不拷贝像素
+ * 超宽、超高图片的内存分块源(含逐级减半的图片)与解码结果一同缓存，再次命中时无需重新生成
+ * 所有接口线程安全
+ */
+class LibDecodedImageCache
+{
+public:
+    static LibDecodedImageCache *instance();
+
+    /**
+     * @brief find
+     * @param[in]           path
+     * @param[out]          image
+     * @param[out]          tiledSource 非空时输出与该图片一同缓存的内存分块源，未缓存时为空指针
+     * @return bool
+     * 命中且文件未变化时返回true
+     */
+    bool find(const QString &path, QImage &image,
+              QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> *tiledSource = nullptr);
+
+    // 仅判断是否已缓存，不校验文件、不计入命中统计
+    bool contains(const QString &path) const;
+
+    // 缓存解码后的原图，超过预算的单张图片不缓存
+    void insert(const QString &path, const QImage &image);
+    // 为已缓存的图片附加由其生成的内存分块源，条目已被替换时忽略
+    void setTiledSource(const QString &path, const QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> &source);
+    void remove(const QString &path);
+    void clear();
+
+    /**
+     * @brief loadImage
+     * @param[in]           path
+     * @param[out]          res
+     * @param[out]          errorMsg
+     * @return bool
+     * 优先从缓存读取，未命中时调用loadStaticImageFromFile解码并缓存
+     */
+    bool loadImage(const QString &path, QImage &res, QString &errorMsg);
+
+    void setMaxBytes(qint64 bytes);
+    qint64 maxBytes() const;
+    qint64 totalBytes() const;
+    quint64 hitCount() const;
+    quint64 missCount() const;
+
+private:
+    LibDecodedImageCache();
+    Q_DISABLE_COPY(LibDecodedImageCache)
+
+    struct Entry {
+        QImage image;
+        LibUnionImage_NameSpace::FileIdentity identity;     // 写入时的文件身份，变化后条目失效
+        QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> tiledSource;    // 第0级与image共享像素
+    };
+
+    mutable QMutex m_mutex;
+    QCache<QString, Entry> m_cache;     // 代价单位为KB
+    quint64 m_hits = 0;
+    quint64 m_misses = 0;
+};
+
+#endif // DECODEDIMAGECACHE_H
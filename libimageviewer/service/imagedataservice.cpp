@@ -16,9 +16,20 @@
 
 #include "unionimage/pluginbaseutils.h"
 #include "unionimage/unionimage.h"
+#include "unionimage/imageexif.h"
 #include "unionimage/baseutils.h"
 #include "unionimage/imageutils.h"
 #include "commonservice.h"
+#include "thumbnailpack.h"
+#include "thumbnailstore.h"
+#include "taskscheduler.h"
+
+// 缩略图宽度
+const int THUMBNAIL_WIDTH = 200;
+// 单次请求中按可见缩略图优先级调度的数量，其余按后台缩略图调度
+const int VISIBLE_THUMBNAIL_COUNT = 50;
+// 与可见范围的距离超过该行数的缩略图请求被丢弃，再次可见时重新请求
+const int DROP_THUMBNAIL_DISTANCE = 200;
 
 LibImageDataService *LibImageDataService::s_ImageDataService = nullptr;
 static std::once_flag dataServiceFlag;
@@ -39,19 +50,26 @@ LibImageDataService::~LibImageDataService()
 {
     qDebug() << "LibImageDataService destructor called";
     stopReadThumbnail();
+    waitForReadThumbnail();
 }
 
 bool LibImageDataService::add(const QStringList &paths)
 {
     QMutexLocker locker(&m_imgDataMutex);
     qDebug() << "Adding" << paths.size() << "paths to request queue";
-    // FIXME: 虽然这样修改将后续的数据优先添加，但也会导致边缘变更单独更新的数据被优先读取，变成非中心加载而是偏向一侧加载。
-    // 反向添加，尾部数据在之后添加，QList两侧都有预留分配，非共享差异不大
-    std::for_each(paths.rbegin(), paths.rend(), [this](const QString &path){
-        if (!m_AllImageMap.contains(path)) {
-            m_requestQueue.prepend(path);
+    // 读取顺序由图片与可见范围的距离决定，与添加顺序无关
+    const qint64 now = m_clock.elapsed();
+    for (const QString &path : paths) {
+        if (!LibThumbnailStore::instance()->contains(path)) {
+            const int row = m_rows.value(path, -1);
+            const bool queued = m_requestQueue.contains(path);
+            m_requestQueue.push(path, row);
+            m_previewQueue.push(path, row);
+            if (!queued && m_requestQueue.contains(path)) {
+                m_requestTime.insert(path, now);
+            }
         }
-    });
+    }
 
     return true;
 }
@@ -60,10 +78,15 @@ bool LibImageDataService::add(const QString &path)
 {
     QMutexLocker locker(&m_imgDataMutex);
     if (!path.isEmpty()) {
-        if (!m_AllImageMap.contains(path)) {
+        if (!LibThumbnailStore::instance()->contains(path)) {
             qDebug() << "Adding single path to request queue:" << path;
-            // 后添加的单一数据优先加载
-            m_requestQueue.prepend(path);
+            const int row = m_rows.value(path, -1);
+            const bool queued = m_requestQueue.contains(path);
+            m_requestQueue.push(path, row);
+            m_previewQueue.push(path, row);
+            if (!queued && m_requestQueue.contains(path)) {
+                m_requestTime.insert(path, m_clock.elapsed());
+            }
         }
     }
     return true;
@@ -72,16 +95,22 @@ bool LibImageDataService::add(const QString &path)
 QString LibImageDataService::pop()
 {
     QMutexLocker locker(&m_imgDataMutex);
-    if (m_requestQueue.empty()) {
+    if (m_requestQueue.isEmpty()) {
         qDebug() << "Request queue is empty";
         return QString();
     }
-    QString res = m_requestQueue.first();
-    m_requestQueue.pop_front();
+    QString res = m_requestQueue.pop();
+    m_requestTime.remove(res);
     qDebug() << "Popped path from request queue:" << res;
     return res;
 }
 
+QString LibImageDataService::popPreview()
+{
+    QMutexLocker locker(&m_imgDataMutex);
+    return m_previewQueue.pop();
+}
+
 bool LibImageDataService::isRequestQueueEmpty()
 {
     QMutexLocker locker(&m_imgDataMutex);
@@ -90,7 +119,7 @@ bool LibImageDataService::isRequestQueueEmpty()
 
 int LibImageDataService::getCount()
 {
-    return m_AllImageMap.count();
+    return LibThumbnailStore::instance()->count();
 }
 
 bool LibImageDataService::readThumbnailByPaths(const QString &thumbnailPath, const QStringList &files, bool remake)
@@ -99,61 +128,89 @@ bool LibImageDataService::readThumbnailByPaths(const QString &thumbnailPath, con
     Q_UNUSED(remake)
 
     qInfo() << "Starting thumbnail generation for" << files.size() << "files";
-    LibImageDataService::instance()->add(files);
-
-    int threadCounts = static_cast<int>(readThreadGroup.size());
-    // 调整占用线程数量
-    int recommendThreadCounts = QThread::idealThreadCount() / 2;
-    int needCoreCounts = qBound(1, files.size(), recommendThreadCounts);
-    int curActivateThreads = 0;
-
-    qDebug() << "Thread configuration - Recommended:" << recommendThreadCounts 
-             << "Needed:" << needCoreCounts << "Current:" << threadCounts;
-
-    // 激活已有的线程
-    for (int i = 0; i < threadCounts && i < needCoreCounts; ++i) {
-        auto thread = readThreadGroup.at(static_cast<uint>(i));
-        if (!thread->isRunning()) {
-            thread->start();
-            curActivateThreads++;
-            qDebug() << "Activated existing thread" << i;
+    add(files);
+
+    QMutexLocker locker(&m_imgDataMutex);
+    scheduleReadTasks(files.size() <= VISIBLE_THUMBNAIL_COUNT);
+    return true;
+}
+
+void LibImageDataService::scheduleReadTasks(bool visible)
+{
+    // 每个任务只取一张图片，任务数与队列长度一致，调度器的工作线程常驻，无需反复创建线程
+    const int missing = m_previewQueue.size() + m_requestQueue.size() - m_scheduledTasks;
+    for (int i = 0; i < missing; ++i) {
+        // 任务执行时总是取优先级最高的图片，先投递的任务按可见缩略图调度
+        const bool visibleTask = visible || m_scheduledTasks < VISIBLE_THUMBNAIL_COUNT * 2;
+        ++m_scheduledTasks;
+        LibTaskScheduler::instance()->post(visibleTask ? LibTaskScheduler::VisibleThumbnail : LibTaskScheduler::BackgroundThumbnail,
+                                           [this]() {
+            runReadTask();
+        });
+    }
+    qDebug() << "Thumbnail tasks scheduled:" << m_scheduledTasks << "queued:" << m_requestQueue.size();
+}
+
+void LibImageDataService::runReadTask()
+{
+    QString path;
+    bool preview = false;
+    {
+        QMutexLocker locker(&m_imgDataMutex);
+        --m_scheduledTasks;
+        // 首先读取内嵌的EXIF缩略图快速填充预览，随后由完整缩略图替换
+        if (!m_previewQueue.isEmpty()) {
+            path = m_previewQueue.pop();
+            preview = true;
+        } else if (!m_requestQueue.isEmpty()) {
+            path = m_requestQueue.pop();
+        }
+        // 队列已被取消时任务直接结束
+        if (path.isEmpty()) {
+            return;
         }
+        ++m_inFlight;
     }
 
-    // 当前激活的线程不满足文件加载，且当前线程仍有余量，创建更多线程处理
-    int avaliableThreads = recommendThreadCounts - threadCounts;
-    int requesetThreads = needCoreCounts - curActivateThreads;
-    int addThreads = qMin(avaliableThreads, requesetThreads);
-    for (int i = 0; i < addThreads; ++i) {
-        qDebug() << "Creating new thumbnail thread" << (i + 1) << "of" << addThreads;
-        LibReadThumbnailThread *thread = new LibReadThumbnailThread;
-        thread->start();
-        readThreadGroup.push_back(thread);
+    if (preview) {
+        m_reader.readPreview(path);
+    } else {
+        m_reader.readThumbnail(path);
     }
 
-    return true;
+    bool idle = false;
+    {
+        QMutexLocker locker(&m_imgDataMutex);
+        --m_inFlight;
+        if (!preview) {
+            ++m_finished;
+            auto itr = m_requestTime.find(path);
+            if (itr != m_requestTime.end()) {
+                m_lastLatencyMs = m_clock.elapsed() - itr.value();
+                m_totalLatencyMs += m_lastLatencyMs;
+                m_maxLatencyMs = qMax(m_maxLatencyMs, m_lastLatencyMs);
+                m_requestTime.erase(itr);
+            }
+        }
+        idle = 0 == m_inFlight && m_previewQueue.isEmpty() && m_requestQueue.isEmpty();
+        if (idle) {
+            m_readIdle.wakeAll();
+        }
+    }
+
+    if (idle) {
+        qDebug() << "Thumbnail queue drained";
+        emit sigeUpdateListview();
+    }
 }
 
 #include "imageengine.h"
 void LibImageDataService::addImage(const QString &path, const QImage &image)
 {
-    QMutexLocker locker(&m_imgDataMutex);
-    m_AllImageMap[path] = image;
-    qDebug() << "Added image to cache - Path:" << path 
-             << "Queue size:" << m_requestQueue.size()
-             << "Cache size:" << m_AllImageMap.size();
-
-//    emit ImageEngine::instance()->sigOneImgReady(path, info);
-
-//    if (!m_AllImageMap.contains(path)) {
-//        m_AllImageMap[path] = image;
-//        while (m_AllImageMap.size() > 1000) {
-//            //保证缓存占用，始终只占用1000张缩略图缓存
-//            QString res = m_imageKey.first();
-//            m_imageKey.pop_front();
-//            m_AllImageMap.remove(res);
-//        }
-//    }
+    LibThumbnailStore::instance()->insert(path, image);
+    qDebug() << "Added image to cache - Path:" << path
+             << "Cache size:" << LibThumbnailStore::instance()->count()
+             << "Cache bytes:" << LibThumbnailStore::instance()->totalBytes();
 }
 
 void LibImageDataService::addMovieDurationStr(const QString &path, const QString &durationStr)
@@ -171,65 +228,123 @@ QString LibImageDataService::getMovieDurationStrByPath(const QString &path)
 
 void LibImageDataService::setAllDataKeys(const QStringList &paths, bool single)
 {
-    Q_UNUSED(paths);
     Q_UNUSED(single);
+    // 缩略图淘汰时按图片在列表中的位置计算与可见位置的距离
+    LibThumbnailStore::instance()->setOrder(paths);
+
+    QHash<QString, int> rows;
+    rows.reserve(paths.size());
+    for (int i = 0; i < paths.size(); ++i) {
+        rows.insert(paths.at(i), i);
+    }
+    QMutexLocker locker(&m_imgDataMutex);
+    m_rows.swap(rows);
+    m_requestQueue.reorder(m_rows);
+    m_previewQueue.reorder(m_rows);
+    // 切换图片列表后请求时间只保留仍在队列中的图片
+    for (auto itr = m_requestTime.begin(); itr != m_requestTime.end();) {
+        if (m_requestQueue.contains(itr.key())) {
+            ++itr;
+        } else {
+            itr = m_requestTime.erase(itr);
+        }
+    }
 }
 
-void LibImageDataService::setVisualIndex(int row)
+void LibImageDataService::setVisibleRange(int first, int last)
 {
     QMutexLocker locker(&m_imgDataMutex);
-    m_visualIndex = row;
+    m_requestQueue.setVisibleRange(first, last, DROP_THUMBNAIL_DISTANCE);
+    m_previewQueue.setVisibleRange(first, last, DROP_THUMBNAIL_DISTANCE);
+}
+
+void LibImageDataService::setVisualIndex(int row)
+{
+    LibThumbnailStore::instance()->setVisualIndex(row);
 }
 
 int LibImageDataService::getVisualIndex()
 {
-    QMutexLocker locker(&m_imgDataMutex);
-    return m_visualIndex;
+    return LibThumbnailStore::instance()->visualIndex();
 }
 
 QImage LibImageDataService::getThumnailImageByPath(const QString &path)
 {
-    QMutexLocker locker(&m_imgDataMutex);
-    return m_AllImageMap.contains(path) ? m_AllImageMap[path] : QImage();
+    QImage image;
+    if (LibThumbnailStore::instance()->find(path, image)) {
+        return image;
+    }
+
+    bool dropped = false;
+    {
+        QMutexLocker locker(&m_imgDataMutex);
+        dropped = m_requestQueue.takeDropped(path);
+        m_previewQueue.takeDropped(path);
+    }
+    if (LibThumbnailStore::instance()->takeEvicted(path) || dropped) {
+        // 缩略图已被淘汰或请求因远离可见范围被丢弃，重新生成，完成后通过sigOneImgReady通知刷新
+        qDebug() << "Regenerating thumbnail back in view:" << path;
+        readThumbnailByPaths(QString(), QStringList(path), false);
+    }
+    return image;
 }
 
 bool LibImageDataService::imageIsLoaded(const QString &path)
 {
-    QMutexLocker locker(&m_imgDataMutex);
-    return m_AllImageMap.contains(path);
+    return LibThumbnailStore::instance()->contains(path);
 }
 
 LibImageDataService::LibImageDataService(QObject *parent)
 {
     Q_UNUSED(parent);
+    m_clock.start();
 }
 
 void LibImageDataService::stopReadThumbnail()
 {
-    if (!readThreadGroup.empty()) {
-        qInfo() << "Stopping" << readThreadGroup.size() << "thumbnail threads";
-        for (auto &thread : readThreadGroup) {
-            thread->setQuit(true);
-        }
+    QMutexLocker locker(&m_imgDataMutex);
+    qInfo() << "Cancelling" << m_requestQueue.size() << "queued thumbnails, in flight:" << m_inFlight;
+    // 已投递的任务取不到图片会直接结束，正在读取的图片完成后自然退出，不阻塞调用线程
+    m_requestQueue.clear();
+    m_previewQueue.clear();
+    m_requestTime.clear();
+    if (0 == m_inFlight) {
+        m_readIdle.wakeAll();
+    }
+}
 
-        for (auto &thread : readThreadGroup) {
-            while (thread->isRunning());
-            thread->deleteLater();
+bool LibImageDataService::waitForReadThumbnail(int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QMutexLocker locker(&m_imgDataMutex);
+    while (m_inFlight > 0 || !m_previewQueue.isEmpty() || !m_requestQueue.isEmpty()) {
+        if (timeoutMs < 0) {
+            m_readIdle.wait(&m_imgDataMutex);
+            continue;
+        }
+        const qint64 remaining = timeoutMs - timer.elapsed();
+        if (remaining <= 0 || !m_readIdle.wait(&m_imgDataMutex, static_cast<unsigned long>(remaining))) {
+            return 0 == m_inFlight && m_previewQueue.isEmpty() && m_requestQueue.isEmpty();
         }
-
-        readThreadGroup.clear();
-        qDebug() << "All thumbnail threads stopped and cleaned up";
     }
+    return true;
 }
 
-//缩略图读取线程
-LibReadThumbnailThread::LibReadThumbnailThread(QObject *parent)
-    : QThread(parent)
+LibImageDataService::ThumbnailStats LibImageDataService::thumbnailStats()
 {
-    m_quit = false;
+    QMutexLocker locker(&m_imgDataMutex);
+    ThumbnailStats stats;
+    stats.queued = m_requestQueue.size();
+    stats.inFlight = m_inFlight;
+    stats.finished = m_finished;
+    stats.lastLatencyMs = m_lastLatencyMs;
+    stats.averageLatencyMs = m_finished > 0 ? m_totalLatencyMs / static_cast<qint64>(m_finished) : 0;
+    stats.maxLatencyMs = m_maxLatencyMs;
+    return stats;
 }
 
-void LibReadThumbnailThread::readThumbnail(QString path)
+void LibThumbnailReader::readThumbnail(QString path)
 {
     if (!QFileInfo(path).exists()) {
         qWarning() << "File does not exist:" << path;
@@ -244,11 +359,36 @@ void LibReadThumbnailThread::readThumbnail(QString path)
     QImage tImg;
     QString errMsg;
 
+    // 持久化存储中已有该文件的缩略图时直接使用，无需解码，未命中时保留已计算的文件身份供写入复用
+    LibUnionImage_NameSpace::FileIdentity identity;
+    if (LibThumbnailPack::instance()->find(path, itemInfo, &identity)) {
+        qDebug() << "Thumbnail loaded from pack:" << path;
+        LibCommonService::instance()->slotSetImgInfoByPath(path, itemInfo);
+        return;
+    }
+
     //SVG需要和常规图片分开处理
     auto imageInfo = LibCommonService::instance()->getImgInfoByPath(path);
     auto imageType = imageInfo.imageType;
+    // 探测一次获取原图尺寸与类型，解码时复用探测结果，避免重复打开文件
+    const LibUnionImage_NameSpace::ImageProbeInfo probeInfo = LibUnionImage_NameSpace::probeImage(path);
     if (imageType == imageViewerSpace::ImageTypeBlank) {
-        imageType = LibUnionImage_NameSpace::getImageType(path);
+        imageType = probeInfo.imageType;
+    }
+
+    // 文件管理器等已生成的freedesktop缩略图与原图匹配时直接复用，无需解码原图
+    if (imageType != imageViewerSpace::ImageTypeSvg) {
+        tImg = Libutils::image::cachedThumbnail(path, Libutils::image::ThumbLarge);
+        if (tImg.isNull()) {
+            tImg = Libutils::image::cachedThumbnail(path, Libutils::image::ThumbNormal);
+            // 尺寸不足的缩略图放大后模糊，仍需解码
+            if (qMax(tImg.width(), tImg.height()) < THUMBNAIL_WIDTH) {
+                tImg = QImage();
+            }
+        }
+        if (!tImg.isNull()) {
+            qDebug() << "Thumbnail reused from freedesktop cache:" << path;
+        }
     }
 
     if (imageType == imageViewerSpace::ImageTypeSvg) {
@@ -262,7 +402,9 @@ void LibReadThumbnailThread::readThumbnail(QString path)
         itemInfo.imgOriginalHeight = 128;
         itemInfo.image = tImg;
     } else {
-        if (!LibUnionImage_NameSpace::loadStaticImageFromFile(path, tImg, errMsg)) {
+        // 按缩略图尺寸缩小解码，避免大图全分辨率解码后再缩放
+        if (tImg.isNull()
+                && !LibUnionImage_NameSpace::loadStaticImageFromFile(path, tImg, errMsg, probeInfo, QSize(THUMBNAIL_WIDTH, THUMBNAIL_WIDTH))) {
             qWarning() << "Failed to load image:" << path << "Error:" << errMsg;
             //损坏图片也需要缓存更新
             itemInfo.imageType = imageViewerSpace::ImageTypeDamaged;
@@ -274,34 +416,21 @@ void LibReadThumbnailThread::readThumbnail(QString path)
                  << "Size:" << tImg.size()
                  << "Format:" << tImg.format();
 
-        //读取图片,给长宽重新赋值
-        itemInfo.imgOriginalWidth = tImg.width();
-        itemInfo.imgOriginalHeight = tImg.height();
+        //读取图片,给长宽重新赋值，缩小解码时使用探测到的原图尺寸
+        const QSize originalSize = probeInfo.displaySize().isValid() ? probeInfo.displaySize() : tImg.size();
+        itemInfo.imgOriginalWidth = originalSize.width();
+        itemInfo.imgOriginalHeight = originalSize.height();
 
         if (0 != tImg.height() && 0 != tImg.width() && (tImg.height() / tImg.width()) < 10 && (tImg.width() / tImg.height()) < 10) {
-            bool cache_exist = false;
-            if (tImg.height() != 200 && tImg.width() != 200) {
-                if (tImg.height() >= tImg.width()) {
-                    cache_exist = true;
-                    tImg = tImg.scaledToWidth(800,  Qt::FastTransformation);
-                    tImg = tImg.scaledToWidth(200,  Qt::SmoothTransformation);
-                } else if (tImg.height() <= tImg.width()) {
-                    cache_exist = true;
-                    tImg = tImg.scaledToWidth(800,  Qt::FastTransformation);
-                    tImg = tImg.scaledToWidth(200,  Qt::SmoothTransformation);
-                }
-            }
-            if (!cache_exist) {
-                if (static_cast<float>(tImg.height()) / static_cast<float>(tImg.width()) > 3) {
-                    tImg = tImg.scaledToWidth(800,  Qt::FastTransformation);
-                    tImg = tImg.scaledToWidth(200,  Qt::SmoothTransformation);
-                } else {
-                    tImg = tImg.scaledToWidth(800,  Qt::FastTransformation);
-                    tImg = tImg.scaledToWidth(200,  Qt::SmoothTransformation);
+            if (tImg.width() != THUMBNAIL_WIDTH) {
+                // 解码结果仍较大时先快速缩小，再平滑缩放到缩略图宽度
+                if (tImg.width() > THUMBNAIL_WIDTH * 4) {
+                    tImg = tImg.scaledToWidth(THUMBNAIL_WIDTH * 4,  Qt::FastTransformation);
                 }
+                tImg = tImg.scaledToWidth(THUMBNAIL_WIDTH,  Qt::SmoothTransformation);
             }
         } else {
-            tImg = tImg.scaled(200, 200);
+            tImg = tImg.scaled(THUMBNAIL_WIDTH, THUMBNAIL_WIDTH);
         }
 
         itemInfo.image = tImg;
@@ -316,38 +445,44 @@ void LibReadThumbnailThread::readThumbnail(QString path)
                  << "Type:" << itemInfo.imageType;
         //获取图片类型
         itemInfo.imageType = imageType;
+        LibThumbnailPack::instance()->insert(path, itemInfo, identity);
     }
     LibCommonService::instance()->slotSetImgInfoByPath(path, itemInfo);
 }
 
-void LibReadThumbnailThread::setQuit(bool quit)
+void LibThumbnailReader::readPreview(const QString &path)
 {
-    m_quit = quit;
+    LibUnionImage_NameSpace::ExifData exif;
+    QImage preview = LibUnionImage_NameSpace::loadExifThumbnail(path, &exif);
+    if (preview.isNull()) {
+        return;
+    }
+
+    imageViewerSpace::ItemInfo itemInfo;
+    itemInfo.path = path;
+    // 预览阶段不确定图片类型，由完整缩略图读取时更新
+    itemInfo.imageType = imageViewerSpace::ImageTypeBlank;
+    if (exif.pixelSize.isValid()) {
+        const QSize originalSize = exif.orientation >= 5 ? exif.pixelSize.transposed() : exif.pixelSize;
+        itemInfo.imgOriginalWidth = originalSize.width();
+        itemInfo.imgOriginalHeight = originalSize.height();
+    }
+    if (preview.width() > THUMBNAIL_WIDTH) {
+        preview = preview.scaledToWidth(THUMBNAIL_WIDTH, Qt::SmoothTransformation);
+    }
+    itemInfo.image = preview;
+
+    if (LibCommonService::instance()->setImgPreviewByPath(path, itemInfo)) {
+        qDebug() << "Set embedded preview for:" << path << "Size:" << preview.size();
+    }
 }
 
-imageViewerSpace::ImageType LibReadThumbnailThread::getImageType(const QString &imagepath)
+imageViewerSpace::ImageType LibThumbnailReader::getImageType(const QString &imagepath)
 {
     return LibUnionImage_NameSpace::getImageType(imagepath);
 }
 
-imageViewerSpace::PathType LibReadThumbnailThread::getPathType(const QString &imagepath)
+imageViewerSpace::PathType LibThumbnailReader::getPathType(const QString &imagepath)
 {
     return LibUnionImage_NameSpace::getPathType(imagepath);
 }
-
-void LibReadThumbnailThread::run()
-{
-    qDebug() << "Thumbnail thread started";
-    while (!LibImageDataService::instance()->isRequestQueueEmpty()) {
-        if (m_quit) {
-            qDebug() << "Thumbnail thread received quit signal";
-            break;
-        }
-        QString res = LibImageDataService::instance()->pop();
-        if (!res.isEmpty()) {
-            readThumbnail(res);
-        }
-    }
-    qDebug() << "Thumbnail thread finished";
-    emit LibImageDataService::instance()->sigeUpdateListview();
-}
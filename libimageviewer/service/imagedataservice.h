@@ -7,18 +7,43 @@
 
 #include <QObject>
 #include <QMap>
+#include <QHash>
 #include <QUrl>
 #include <QMutex>
 #include <QQueue>
-#include <QThread>
+#include <QElapsedTimer>
+#include <QWaitCondition>
 
 #include "image-viewer_global.h"
+#include "thumbnailrequestqueue.h"
+
+//缩略图读取，在任务调度器的工作线程中执行
+class LibThumbnailReader
+{
+public:
+    void readThumbnail(QString m_path);
+    //读取内嵌的EXIF缩略图作为预览
+    void readPreview(const QString &path);
+
+    //判断图片类型
+    imageViewerSpace::ImageType getImageType(const QString &imagepath);
+    //判断路径类型
+    imageViewerSpace::PathType getPathType(const QString &imagepath);
+};
 
-class LibReadThumbnailThread;
 class LibImageDataService: public QObject
 {
     Q_OBJECT
 public:
+    struct ThumbnailStats {
+        int queued = 0;             // 等待读取的缩略图数
+        int inFlight = 0;           // 正在读取的缩略图数
+        quint64 finished = 0;       // 已读取完成的缩略图数
+        qint64 lastLatencyMs = 0;   // 最近一张从请求到完成的耗时(毫秒)
+        qint64 averageLatencyMs = 0;
+        qint64 maxLatencyMs = 0;
+    };
+
     static LibImageDataService *instance(QObject *parent = nullptr);
     explicit LibImageDataService(QObject *parent = nullptr);
     ~LibImageDataService();
@@ -27,6 +52,8 @@ public:
     bool add(const QString &path);
     QString pop();
     bool isRequestQueueEmpty();
+    //取出待读取内嵌预览图的路径
+    QString popPreview();
     //获取全部图片数量
     int getCount();
 
@@ -34,6 +61,7 @@ public:
     bool readThumbnailByPaths(const QString &thumbnailPath, const QStringList &files, bool remake);
 
     void addImage(const QString &path, const QImage &image);
+    //获取缩略图，已被淘汰时重新生成并返回空图，需在主线程调用
     QImage getThumnailImageByPath(const QString &path);
     bool imageIsLoaded(const QString &path);
 
@@ -43,55 +71,52 @@ public:
     //设置当前窗口所有数据
     void setAllDataKeys(const QStringList &paths, bool single = false);
 
-    //
+    //设置缩略图栏中可见的行范围，距离该范围越近的缩略图越先读取，过远的请求被丢弃
+    void setVisibleRange(int first, int last);
+
+    //设置当前可见位置，缩略图缓存优先淘汰距离该位置最远的图片
     void setVisualIndex(int row);
     int getVisualIndex();
 
-    //取消图片加载
+    //取消图片加载，丢弃排队的请求，不等待正在读取的图片
     void stopReadThumbnail();
+    //等待排队和正在读取的缩略图全部完成，超时返回false，timeoutMs小于0时一直等待
+    bool waitForReadThumbnail(int timeoutMs = -1);
+    ThumbnailStats thumbnailStats();
 
 private slots:
 signals:
     void sigeUpdateListview();
 public:
 private:
+    //按请求队列补足调度器中的读取任务，需持有m_imgDataMutex
+    void scheduleReadTasks(bool visible);
+    //调度器中执行的读取任务，每次取优先级最高的一张图片，预览优先
+    void runReadTask();
+
     static LibImageDataService *s_ImageDataService;
     QMutex m_queuqMutex;
-    QList<QString> m_requestQueue;
+    LibThumbnailRequestQueue m_requestQueue;
+    //内嵌EXIF预览图请求，先于完整缩略图处理
+    LibThumbnailRequestQueue m_previewQueue;
+    //图片在列表中的行号
+    QHash<QString, int> m_rows;
 
     //图片数据锁
     QMutex m_imgDataMutex;
-    QMap<QString, QImage> m_AllImageMap;
     QMap<QString, QString> m_movieDurationStrMap;
-    QQueue<QString> m_imageKeys;
-    int m_visualIndex = 0;//用户查找视图中的model index
-
-    //图片读取线程
-    std::vector<LibReadThumbnailThread *> readThreadGroup;
-};
 
-
-//缩略图读取线程
-class LibReadThumbnailThread : public QThread
-{
-    Q_OBJECT
-
-public:
-    explicit LibReadThumbnailThread(QObject *parent = nullptr);
-    ~LibReadThumbnailThread() override = default;
-    void readThumbnail(QString m_path);
-    void setQuit(bool quit);
-
-    //判断图片类型
-    imageViewerSpace::ImageType getImageType(const QString &imagepath);
-    //判断路径类型
-    imageViewerSpace::PathType getPathType(const QString &imagepath);
-
-protected:
-    void run() override;
-
-private:
-    std::atomic_bool m_quit;
+    //缩略图读取任务状态，由m_imgDataMutex保护
+    LibThumbnailReader m_reader;
+    int m_scheduledTasks = 0;               //已投递到调度器尚未开始的任务数
+    int m_inFlight = 0;
+    quint64 m_finished = 0;
+    qint64 m_totalLatencyMs = 0;
+    qint64 m_lastLatencyMs = 0;
+    qint64 m_maxLatencyMs = 0;
+    QHash<QString, qint64> m_requestTime;   //请求加入队列的时间，用于统计耗时
+    QElapsedTimer m_clock;
+    QWaitCondition m_readIdle;
 };
 
 #endif // IMAGEDATASERVICE_H
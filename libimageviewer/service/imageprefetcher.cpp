@@ -0,0 +1,243 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "imageprefetcher.h"
+#include "decodedimagecache.h"
+#include "taskscheduler.h"
+#include "unionimage/unionimage.h"
+#include "unionimage/progressivedecoder.h"
+#include "unionimage/tiledimagesource.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace {
+
+// 正常翻页时向前预取的数量
+const int PREFETCH_AHEAD = 2;
+// 快速翻页(按住方向键)时向前预取的数量
+const int FAST_PREFETCH_AHEAD = 4;
+// 反方向保留的数量，便于回看
+const int PREFETCH_BEHIND = 1;
+// 平滑后的翻页间隔低于该值(毫秒)视为快速翻页
+const int FAST_NAVIGATE_INTERVAL = 500;
+// 一次跳过超过该数量的图片时视为跳转，重新统计速度
+const int MAX_STEP = 2;
+
+}
+
+LibImagePrefetcher *LibImagePrefetcher::instance()
+{
+    static LibImagePrefetcher prefetcher;
+    return &prefetcher;
+}
+
+LibImagePrefetcher::LibImagePrefetcher()
+{
+    // 保证解码缓存和调度器先于预取器构造、晚于预取器析构
+    LibDecodedImageCache::instance();
+    LibTaskScheduler::instance();
+}
+
+LibImagePrefetcher::~LibImagePrefetcher()
+{
+    cancel();
+    // 已投递的任务会访问预取器，等待其全部结束
+    QMutexLocker locker(&m_mutex);
+    while (!m_queued.isEmpty()) {
+        m_decodeFinished.wait(&m_mutex);
+    }
+}
+
+void LibImagePrefetcher::navigate(const QString &path, const QStringList &paths)
+{
+    const int index = paths.indexOf(path);
+    if (-1 == index) {
+        cancel();
+        return;
+    }
+
+    const int count = paths.count();
+    QString lastPath;
+    {
+        QMutexLocker locker(&m_mutex);
+        lastPath = m_currentPath;
+    }
+    const int lastIndex = paths.indexOf(lastPath);
+    if (-1 != lastIndex && lastIndex != index) {
+        int step = index - lastIndex;
+        // 首尾循环翻页时按最短距离计算方向
+        if (qAbs(step) > count / 2) {
+            step += step > 0 ? -count : count;
+        }
+        if (qAbs(step) <= MAX_STEP) {
+            m_direction = step > 0 ? 1 : -1;
+            const qint64 elapsed = m_navigateTimer.isValid() ? m_navigateTimer.elapsed() : -1;
+            if (elapsed >= 0) {
+                m_intervalMs = m_intervalMs < 0 ? elapsed : (m_intervalMs * 3 + elapsed) / 4;
+            }
+        } else {
+            m_intervalMs = -1;
+        }
+    }
+    m_navigateTimer.start();
+
+    const bool fast = m_intervalMs >= 0 && m_intervalMs < FAST_NAVIGATE_INTERVAL;
+    const int ahead = fast ? FAST_PREFETCH_AHEAD : PREFETCH_AHEAD;
+
+    // 按优先级排列：翻页方向上由近及远，然后是反方向
+    QStringList window;
+    for (int i = 1; i <= ahead; ++i) {
+        const int next = index + i * m_direction;
+        if (next < 0 || next >= count) {
+            break;
+        }
+        window.append(paths.at(next));
+    }
+    for (int i = 1; i <= PREFETCH_BEHIND; ++i) {
+        const int previous = index - i * m_direction;
+        if (previous < 0 || previous >= count) {
+            break;
+        }
+        window.append(paths.at(previous));
+    }
+
+    QStringList toQueue;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_currentPath = path;
+        m_window = window;
+        m_wanted.clear();
+        m_wanted.insert(path);
+        for (const QString &item : window) {
+            m_wanted.insert(item);
+            if (!m_queued.contains(item) && !m_writing.contains(item) && !LibDecodedImageCache::instance()->contains(item)) {
+                m_queued.insert(item);
+                toQueue.append(item);
+            }
+        }
+        cancelUnwanted();
+    }
+
+    if (!toQueue.isEmpty()) {
+        qDebug() << "Prefetching images:" << toQueue << "direction:" << m_direction << "interval:" << m_intervalMs;
+    }
+    for (const QString &item : toQueue) {
+        LibTaskScheduler::instance()->post(LibTaskScheduler::NeighbourPrefetch, [this, item]() {
+            prefetch(item);
+        });
+    }
+}
+
+void LibImagePrefetcher::cancel()
+{
+    QMutexLocker locker(&m_mutex);
+    m_currentPath.clear();
+    m_window.clear();
+    m_wanted.clear();
+    cancelUnwanted();
+}
+
+void LibImagePrefetcher::cancelUnwanted()
+{
+    for (auto itr = m_tokens.constBegin(); itr != m_tokens.constEnd(); ++itr) {
+        if (!m_wanted.contains(itr.key())) {
+            itr.value()->cancel();
+        }
+    }
+}
+
+QStringList LibImagePrefetcher::window() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_window;
+}
+
+bool LibImagePrefetcher::isDecoding(const QString &path) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_decoding.contains(path);
+}
+
+bool LibImagePrefetcher::whenDecoded(const QString &path, const std::function<void()> &continuation)
+{
+    QMutexLocker locker(&m_mutex);
+    if (!m_decoding.contains(path)) {
+        return false;
+    }
+    m_continuations[path].append(continuation);
+    return true;
+}
+
+void LibImagePrefetcher::beginWrite(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    ++m_writing[path];
+    const LibUnionImage_NameSpace::DecodeCancelTokenPtr token = m_tokens.value(path);
+    if (token) {
+        token->cancel();
+    }
+    LibDecodedImageCache::instance()->remove(path);
+}
+
+void LibImagePrefetcher::endWrite(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    auto itr = m_writing.find(path);
+    if (itr != m_writing.end() && --itr.value() <= 0) {
+        m_writing.erase(itr);
+    }
+    LibDecodedImageCache::instance()->remove(path);
+}
+
+void LibImagePrefetcher::prefetch(const QString &path)
+{
+    const LibUnionImage_NameSpace::DecodeCancelTokenPtr token(new LibUnionImage_NameSpace::DecodeCancelToken);
+    {
+        QMutexLocker locker(&m_mutex);
+        // 已移出窗口、正在被改写，或已成为当前图片(由看图界面解码)的任务不再开始
+        if (!m_wanted.contains(path) || path == m_currentPath || m_writing.contains(path)
+                || LibDecodedImageCache::instance()->contains(path)) {
+            m_queued.remove(path);
+            m_decodeFinished.wakeAll();
+            return;
+        }
+        m_decoding.insert(path);
+        m_tokens.insert(path, token);
+    }
+
+    // 动图、多页图、SVG不使用原图缓存，超大图片使用分块模式
+    const LibUnionImage_NameSpace::ImageProbeInfo probeInfo = LibUnionImage_NameSpace::probeImage(path);
+    const bool cacheable = imageViewerSpace::ImageTypeStatic == probeInfo.imageType
+                           && !LibUnionImage_NameSpace::TiledImageSource::isHugeImage(probeInfo.displaySize());
+    if (cacheable) {
+        // 不需要中间结果，移出窗口时取消标记在扫描行批次之间中止解码
+        LibUnionImage_NameSpace::ProgressiveOptions options;
+        options.cancelToken = token;
+        QImage image;
+        QString errorMsg;
+        if (LibUnionImage_NameSpace::loadStaticImageProgressive(path, image, errorMsg, options, LibUnionImage_NameSpace::ProgressiveCallback())) {
+            // Qt插件的解码无法中途取消，解码期间开始改写文件时结果已过期，在锁内判断以免与beginWrite交错
+            QMutexLocker locker(&m_mutex);
+            if (!token->isCancelled() && !m_writing.contains(path)) {
+                LibDecodedImageCache::instance()->insert(path, image);
+            }
+        } else {
+            qDebug() << "Prefetch stopped:" << path << errorMsg;
+        }
+    }
+
+    QList<std::function<void()>> continuations;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_decoding.remove(path);
+        m_queued.remove(path);
+        m_tokens.remove(path);
+        continuations = m_continuations.take(path);
+    }
+    m_decodeFinished.wakeAll();
+    for (const std::function<void()> &continuation : continuations) {
+        continuation();
+    }
+}
@@ -0,0 +1,95 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef IMAGEPREFETCHER_H
+#define IMAGEPREFETCHER_H
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+#include <QWaitCondition>
+
+#include <functional>
+
+#include "unionimage/unionimage.h"
+
+/**
+ * @brief The LibImagePrefetcher class
+ * 根据翻页方向和速度预先解码相邻图片的原图，结果存入LibDecodedImageCache
+ * 解码任务以相邻图片预取的优先级在LibTaskScheduler中执行
+ * 快速翻页时向前预取更多图片，移出预取窗口的任务在开始前取消，解码中的任务通过取消标记中止
+ * navigate()需在主线程调用，其余接口线程安全
+ */
+class LibImagePrefetcher
+{
+public:
+    static LibImagePrefetcher *instance();
+
+    /**
+     * @brief navigate
+     * @param[in]           path    当前显示的图片
+     * @param[in]           paths   可翻页的图片列表
+     * 更新翻页方向和速度，重新计算预取窗口并投递解码任务
+     */
+    void navigate(const QString &path, const QStringList &paths);
+
+    // 取消所有预取任务
+    void cancel();
+
+    // 当前预取窗口，按优先级排序，不包含当前图片
+    QStringList window() const;
+
+    // 是否正在预取解码该图片
+    bool isDecoding(const QString &path) const;
+
+    /**
+     * @brief whenDecoded
+     * @param[in]           path
+     * @param[in]           continuation
+     * @return bool
+     * 该图片正在预取解码时记录continuation，解码结束后在预取线程中调用，返回true
+     * 未在解码时不做任何操作，返回false
+     * 用于当前图片正在预取时接着预取的结果加载，不占用当前图片的线程等待
+     */
+    bool whenDecoded(const QString &path, const std::function<void()> &continuation);
+
+    /**
+     * @brief beginWrite
+     * @param[in]           path
+     * 文件即将被改写(如旋转回写)，取消该图片正在进行的预取并丢弃已缓存的解码结果，
+     * 调用endWrite前不再预取该图片，避免缓存改写前的内容
+     */
+    void beginWrite(const QString &path);
+    // 文件改写完成，丢弃改写期间可能写入的解码结果，之后可重新预取，与beginWrite成对调用
+    void endWrite(const QString &path);
+
+private:
+    LibImagePrefetcher();
+    ~LibImagePrefetcher();
+    Q_DISABLE_COPY(LibImagePrefetcher)
+
+    void prefetch(const QString &path);
+    // 取消已移出预取窗口的解码，需持有m_mutex
+    void cancelUnwanted();
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_decodeFinished;
+    QString m_currentPath;              // 当前图片由看图界面解码，不重复预取
+    QStringList m_window;
+    QSet<QString> m_wanted;             // 预取窗口及当前图片，不在其中的任务取消
+    QSet<QString> m_queued;             // 已投递未结束的任务
+    QSet<QString> m_decoding;           // 正在解码的任务
+    QHash<QString, LibUnionImage_NameSpace::DecodeCancelTokenPtr> m_tokens;    // 正在解码的任务的取消标记
+    QHash<QString, QList<std::function<void()>>> m_continuations;           // 解码结束后继续执行的操作
+    QHash<QString, int> m_writing;      // 正在改写的文件及未完成的改写次数
+
+    // 以下仅在主线程访问
+    int m_direction = 1;                // 1向后翻页，-1向前翻页
+    qint64 m_intervalMs = -1;           // 平滑后的翻页间隔，-1代表未知
+    QElapsedTimer m_navigateTimer;
+};
+
+#endif // IMAGEPREFETCHER_H
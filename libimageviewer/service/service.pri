@@ -1,11 +1,23 @@
 HEADERS += \
     $$PWD/commonservice.h \
     $$PWD/configsetter.h  \
+    $$PWD/decodedimagecache.h \
     $$PWD/imagedataservice.h \
+    $$PWD/imageprefetcher.h \
     $$PWD/ocrinterface.h  \
+    $$PWD/taskscheduler.h \
+    $$PWD/thumbnailpack.h \
+    $$PWD/thumbnailrequestqueue.h \
+    $$PWD/thumbnailstore.h \
 
 SOURCES += \
     $$PWD/commonservice.cpp \
     $$PWD/configsetter.cpp \
+    $$PWD/decodedimagecache.cpp \
     $$PWD/imagedataservice.cpp \
+    $$PWD/imageprefetcher.cpp \
     $$PWD/ocrinterface.cpp  \
+    $$PWD/taskscheduler.cpp \
+    $$PWD/thumbnailpack.cpp \
+    $$PWD/thumbnailrequestqueue.cpp \
+    $$PWD/thumbnailstore.cpp \
@@ -0,0 +1,270 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "taskscheduler.h"
+
+#include <QAtomicInt>
+#include <QMutexLocker>
+#include <QThread>
+#include <QDebug>
+
+namespace {
+
+// 工作线程数下限，保证当前图片始终有一个保留线程
+const int MIN_WORKERS = 2;
+
+// 当前工作线程正在执行的任务类别，-1代表不在执行任务
+thread_local int currentClass = -1;
+
+/**
+ * @brief The ParallelState struct
+ * parallelFor的共享状态，各线程领取下标直到全部领取完，调用方等待全部完成
+ * 下标全部领取后才开始的分担任务不会再访问调用方的函数
+ */
+struct ParallelState {
+    QAtomicInt next;
+    QMutex mutex;
+    QWaitCondition done;
+    int finished = 0;
+    int count = 0;
+
+    void drain(const std::function<void(int)> *function)
+    {
+        int processed = 0;
+        int index;
+        while ((index = next.fetchAndAddOrdered(1)) < count) {
+            (*function)(index);
+            ++processed;
+        }
+        if (processed > 0) {
+            QMutexLocker locker(&mutex);
+            finished += processed;
+            if (finished == count) {
+                done.wakeAll();
+            }
+        }
+    }
+};
+
+}
+
+LibTaskScheduler *LibTaskScheduler::instance()
+{
+    static LibTaskScheduler scheduler;
+    return &scheduler;
+}
+
+LibTaskScheduler::LibTaskScheduler()
+{
+    m_clock.start();
+
+    const int workers = qMax(MIN_WORKERS, QThread::idealThreadCount());
+    m_workerCount = workers;
+    // 默认并发上限：预取和后台任务只占用少量线程，避免与当前图片争抢CPU
+    m_maxConcurrency[VisibleImage] = workers;
+    m_maxConcurrency[NeighbourPrefetch] = qBound(1, workers / 4, 2);
+    m_maxConcurrency[VisibleThumbnail] = qMax(1, workers / 2);
+    m_maxConcurrency[BackgroundThumbnail] = qMax(1, workers / 4);
+    m_maxConcurrency[Metadata] = 1;
+
+    for (int i = 0; i < workers; ++i) {
+        QThread *worker = QThread::create([this]() {
+            workerLoop();
+        });
+        worker->setObjectName(QString("ImageTaskWorker%1").arg(i));
+        worker->start();
+        m_workers.append(worker);
+    }
+    qDebug() << "Task scheduler started with" << workers << "workers";
+}
+
+LibTaskScheduler::~LibTaskScheduler()
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        m_quit = true;
+        for (QQueue<Task> &queue : m_queues) {
+            queue.clear();
+        }
+    }
+    m_taskAvailable.wakeAll();
+    for (QThread *worker : m_workers) {
+        worker->wait();
+        delete worker;
+    }
+}
+
+void LibTaskScheduler::post(TaskClass taskClass, const std::function<void()> &task)
+{
+    if (taskClass < 0 || taskClass >= TaskClassCount || !task) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_quit) {
+            return;
+        }
+        m_queues[taskClass].enqueue(Task{task, m_clock.elapsed()});
+        ++m_stats[taskClass].queued;
+    }
+    m_taskAvailable.wakeOne();
+}
+
+void LibTaskScheduler::parallelFor(int count, const std::function<void(int)> &function)
+{
+    if (count <= 0 || !function) {
+        return;
+    }
+    if (1 == count) {
+        function(0);
+        return;
+    }
+
+    QSharedPointer<ParallelState> state(new ParallelState);
+    state->count = count;
+    const std::function<void(int)> *functionPtr = &function;
+    const TaskClass taskClass = currentTaskClass();
+    const int helpers = qMin(count, m_workerCount) - 1;
+    for (int i = 0; i < helpers; ++i) {
+        post(taskClass, [state, functionPtr]() {
+            state->drain(functionPtr);
+        });
+    }
+
+    state->drain(functionPtr);
+    QMutexLocker locker(&state->mutex);
+    while (state->finished < count) {
+        state->done.wait(&state->mutex);
+    }
+}
+
+LibTaskScheduler::TaskClass LibTaskScheduler::currentTaskClass()
+{
+    return currentClass < 0 ? VisibleImage : static_cast<TaskClass>(currentClass);
+}
+
+void LibTaskScheduler::setMaxConcurrency(TaskClass taskClass, int count)
+{
+    if (taskClass < 0 || taskClass >= TaskClassCount) {
+        return;
+    }
+    {
+        QMutexLocker locker(&m_mutex);
+        m_maxConcurrency[taskClass] = qMax(1, count);
+    }
+    m_taskAvailable.wakeAll();
+}
+
+int LibTaskScheduler::maxConcurrency(TaskClass taskClass) const
+{
+    if (taskClass < 0 || taskClass >= TaskClassCount) {
+        return 0;
+    }
+    QMutexLocker locker(&m_mutex);
+    return m_maxConcurrency[taskClass];
+}
+
+int LibTaskScheduler::workerCount() const
+{
+    return m_workerCount;
+}
+
+LibTaskScheduler::Stats LibTaskScheduler::stats(TaskClass taskClass) const
+{
+    if (taskClass < 0 || taskClass >= TaskClassCount) {
+        return Stats();
+    }
+    QMutexLocker locker(&m_mutex);
+    return m_stats[taskClass];
+}
+
+bool LibTaskScheduler::waitForIdle(int timeoutMs)
+{
+    QElapsedTimer timer;
+    timer.start();
+    QMutexLocker locker(&m_mutex);
+    forever {
+        bool idle = true;
+        for (const Stats &stats : m_stats) {
+            if (stats.queued > 0 || stats.running > 0) {
+                idle = false;
+                break;
+            }
+        }
+        if (idle) {
+            return true;
+        }
+        if (timeoutMs < 0) {
+            m_taskFinished.wait(&m_mutex);
+        } else {
+            const qint64 remaining = timeoutMs - timer.elapsed();
+            if (remaining <= 0) {
+                return false;
+            }
+            m_taskFinished.wait(&m_mutex, static_cast<unsigned long>(remaining));
+        }
+    }
+}
+
+int LibTaskScheduler::nextTaskClass() const
+{
+    for (int taskClass = 0; taskClass < TaskClassCount; ++taskClass) {
+        if (m_queues[taskClass].isEmpty() || m_stats[taskClass].running >= m_maxConcurrency[taskClass]) {
+            continue;
+        }
+        // 保留一个线程给当前图片
+        if (VisibleImage != taskClass && m_lowPriorityRunning >= m_workerCount - 1) {
+            continue;
+        }
+        return taskClass;
+    }
+    return -1;
+}
+
+void LibTaskScheduler::workerLoop()
+{
+    QThread::Priority priority = QThread::NormalPriority;
+    QMutexLocker locker(&m_mutex);
+    forever {
+        int taskClass = -1;
+        while (!m_quit && (taskClass = nextTaskClass()) < 0) {
+            m_taskAvailable.wait(&m_mutex);
+        }
+        if (m_quit) {
+            break;
+        }
+
+        Task task = m_queues[taskClass].dequeue();
+        Stats &stats = m_stats[taskClass];
+        const qint64 waitMs = m_clock.elapsed() - task.enqueuedMs;
+        --stats.queued;
+        ++stats.running;
+        stats.totalWaitMs += waitMs;
+        stats.maxWaitMs = qMax(stats.maxWaitMs, waitMs);
+        if (VisibleImage != taskClass) {
+            ++m_lowPriorityRunning;
+        }
+        locker.unlock();
+
+        const QThread::Priority taskPriority = VisibleImage == taskClass ? QThread::NormalPriority : QThread::LowPriority;
+        if (taskPriority != priority) {
+            priority = taskPriority;
+            QThread::currentThread()->setPriority(priority);
+        }
+        currentClass = taskClass;
+        task.function();
+        task.function = nullptr;
+        currentClass = -1;
+
+        locker.relock();
+        --stats.running;
+        ++stats.finished;
+        if (VisibleImage != taskClass) {
+            --m_lowPriorityRunning;
+        }
+        // 释放的并发额度可能使其他类别的任务可以运行
+        m_taskAvailable.wakeAll();
+        m_taskFinished.wakeAll();
+    }
+}
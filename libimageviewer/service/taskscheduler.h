@@ -0,0 +1,188 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TASKSCHEDULER_H
+#define TASKSCHEDULER_H
+
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QFuture>
+#include <QFutureInterface>
+#include <QMutex>
+#include <QQueue>
+#include <QSharedPointer>
+#include <QVector>
+#include <QWaitCondition>
+
+#include <functional>
+
+class QThread;
+
+/**
+ * @brief The LibTaskScheduler class
+ * 进程内统一的图片任务调度器，所有工作线程共享按优先级分类的任务队列
+ * 空闲线程总是取最高优先级类别中可运行的任务，各类别有独立的并发上限
+ * 始终为当前图片保留一个线程，当前图片的解码不会排在大量后台任务之后
+ * 所有接口线程安全
+ */
+class LibTaskScheduler
+{
+public:
+    // 任务类别，数值越小优先级越高
+    enum TaskClass {
+        VisibleImage = 0,       // 当前显示的图片、分块及打印等用户正在等待的任务
+        NeighbourPrefetch,      // 相邻图片预取
+        VisibleThumbnail,       // 可见区域的缩略图
+        BackgroundThumbnail,    // 后台缩略图
+        Metadata,               // 元数据读取
+        TaskClassCount
+    };
+
+    struct Stats {
+        int queued = 0;             // 排队中的任务数
+        int running = 0;            // 正在执行的任务数
+        quint64 finished = 0;       // 已完成的任务数
+        qint64 totalWaitMs = 0;     // 已开始任务的排队总时长(毫秒)
+        qint64 maxWaitMs = 0;       // 已开始任务的最长排队时长(毫秒)
+    };
+
+    static LibTaskScheduler *instance();
+
+    // 投递任务，不关心结果
+    void post(TaskClass taskClass, const std::function<void()> &task);
+
+    /**
+     * @brief run
+     * @param[in]           taskClass
+     * @param[in]           function
+     * @return QFuture
+     * 投递任务并通过QFuture返回结果，可配合QFutureWatcher使用
+     * 开始执行前QFuture被取消的任务不会执行
+     */
+    template <typename Function>
+    auto run(TaskClass taskClass, Function function) -> QFuture<decltype(function())>;
+
+    /**
+     * @brief map
+     * @param[in]           taskClass
+     * @param[in,out]       sequence
+     * @param[in]           function
+     * @return QFuture<void>
+     * 对sequence的每个元素投递一个任务，全部完成后QFuture结束
+     * 与QtConcurrent::map相同，sequence需在完成前保持有效
+     */
+    template <typename Sequence, typename Function>
+    QFuture<void> map(TaskClass taskClass, Sequence &sequence, Function function);
+
+    /**
+     * @brief parallelFor
+     * @param[in]           count
+     * @param[in]           function    对[0, count)中的每个下标调用一次
+     * 将一个任务内部的工作拆分给空闲线程，类别与调用方正在执行的任务相同，全部完成后返回
+     * 调用线程自身参与执行，不依赖其他线程，在工作线程中调用不会死锁，也不会占着线程等待其他线程池
+     */
+    void parallelFor(int count, const std::function<void(int)> &function);
+
+    // 当前线程正在执行的任务类别，不在工作线程中时返回VisibleImage
+    static TaskClass currentTaskClass();
+
+    void setMaxConcurrency(TaskClass taskClass, int count);
+    int maxConcurrency(TaskClass taskClass) const;
+    int workerCount() const;
+    Stats stats(TaskClass taskClass) const;
+
+    /**
+     * @brief waitForIdle
+     * @param[in]           timeoutMs   小于0时一直等待
+     * @return bool
+     * 等待所有排队和执行中的任务完成，超时返回false
+     */
+    bool waitForIdle(int timeoutMs = -1);
+
+private:
+    LibTaskScheduler();
+    ~LibTaskScheduler();
+    Q_DISABLE_COPY(LibTaskScheduler)
+
+    struct Task {
+        std::function<void()> function;
+        qint64 enqueuedMs;
+    };
+
+    // 返回下一个可运行任务的类别，没有时返回-1，需持有m_mutex
+    int nextTaskClass() const;
+    void workerLoop();
+
+    template <typename Result>
+    struct FutureReporter {
+        template <typename Function>
+        static void report(QFutureInterface<Result> &future, Function &function)
+        {
+            future.reportResult(function());
+        }
+    };
+
+    mutable QMutex m_mutex;
+    QWaitCondition m_taskAvailable;
+    QWaitCondition m_taskFinished;
+    QQueue<Task> m_queues[TaskClassCount];
+    int m_maxConcurrency[TaskClassCount];
+    Stats m_stats[TaskClassCount];
+    int m_lowPriorityRunning = 0;       // 非当前图片类别的运行任务数
+    bool m_quit = false;
+    int m_workerCount = 0;
+    QElapsedTimer m_clock;
+    QVector<QThread *> m_workers;
+};
+
+template <>
+struct LibTaskScheduler::FutureReporter<void> {
+    template <typename Function>
+    static void report(QFutureInterface<void> &, Function &function)
+    {
+        function();
+    }
+};
+
+template <typename Function>
+auto LibTaskScheduler::run(TaskClass taskClass, Function function) -> QFuture<decltype(function())>
+{
+    typedef decltype(function()) Result;
+    QFutureInterface<Result> future;
+    future.reportStarted();
+    post(taskClass, [future, function]() mutable {
+        if (!future.isCanceled()) {
+            FutureReporter<Result>::report(future, function);
+        }
+        future.reportFinished();
+    });
+    return future.future();
+}
+
+template <typename Sequence, typename Function>
+QFuture<void> LibTaskScheduler::map(TaskClass taskClass, Sequence &sequence, Function function)
+{
+    QFutureInterface<void> future;
+    future.reportStarted();
+    if (sequence.isEmpty()) {
+        future.reportFinished();
+        return future.future();
+    }
+
+    QSharedPointer<QAtomicInt> remaining(new QAtomicInt(static_cast<int>(sequence.size())));
+    for (auto it = sequence.begin(); it != sequence.end(); ++it) {
+        auto *item = &(*it);
+        post(taskClass, [future, function, item, remaining]() mutable {
+            if (!future.isCanceled()) {
+                function(*item);
+            }
+            if (!remaining->deref()) {
+                future.reportFinished();
+            }
+        });
+    }
+    return future.future();
+}
+
+#endif // TASKSCHEDULER_H
@@ -0,0 +1,769 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "thumbnailpack.h"
+#include "commonservice.h"
+#include "unionimage/fileidentity.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QHash>
+#include <QRandomGenerator>
+#include <QStandardPaths>
+#include <QDebug>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+namespace {
+
+const quint32 PACK_MAGIC = 0x4b505444;      // "DTPK"
+const quint32 INDEX_MAGIC = 0x58495444;     // "DTIX"
+const quint32 RECORD_MAGIC = 0x424d4854;    // "THMB"
+const quint32 FORMAT_VERSION = 3;
+
+const QString PACK_FILE_NAME = "thumbnails.pack";
+const QString INDEX_FILE_NAME = "thumbnails.idx";
+const QString LOCK_FILE_NAME = "thumbnails.lock";
+
+// 索引最小容量及最大装载率
+const quint32 MIN_INDEX_CAPACITY = 4096;
+const quint64 MAX_LOAD_PERCENT = 70;
+// 默认打包文件预算
+const qint64 DEFAULT_PACK_MAX_BYTES = 1024LL * 1024 * 1024;
+// 失效条目超过打包文件的该比例且超过最小值时自动压缩
+const quint64 COMPACT_DEAD_PERCENT = 50;
+const quint64 COMPACT_MIN_DEAD_BYTES = 16ULL * 1024 * 1024;
+// 超出预算压缩时丢弃最早的条目直到预算的该比例
+const quint64 LOW_WATERMARK_PERCENT = 75;
+// 记录按16字节对齐，像素数据可直接构造QImage
+const quint64 RECORD_ALIGN = 16;
+const int MAX_THUMBNAIL_SIDE = 4096;
+
+struct PackHeader {
+    quint32 magic;
+    quint32 version;
+    quint64 packId;
+};
+
+// 校验和位于结构体末尾，计算时不包含自身
+template <typename Header>
+quint64 headerChecksum(const Header &header)
+{
+    return LibUnionImage_NameSpace::hash64(&header, sizeof(Header) - sizeof(quint64));
+}
+
+quint64 alignRecord(quint64 size)
+{
+    return (size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+}
+
+quint32 nextPowerOfTwo(quint64 value)
+{
+    quint32 result = MIN_INDEX_CAPACITY;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+quint64 newPackId()
+{
+    return QRandomGenerator::global()->generate64() ^ static_cast<quint64>(QDateTime::currentMSecsSinceEpoch());
+}
+
+bool supportedFormat(quint32 format)
+{
+    return QImage::Format_RGB888 == format || QImage::Format_RGB32 == format
+           || QImage::Format_ARGB32_Premultiplied == format;
+}
+
+}
+
+struct LibThumbnailPack::IndexHeader {
+    quint32 magic;
+    quint32 version;
+    quint64 packId;         // 与打包文件头一致，压缩替换打包文件后旧索引失效
+    quint32 capacity;
+    quint32 count;          // 已占用的槽位数，包含内容键
+    quint64 packSize;       // 已提交的打包文件长度，之后的数据视为未完成的写入
+    quint64 deadBytes;      // 估算值，压缩时重新统计
+    quint32 records;        // 身份键数量
+    quint32 reserved;
+    quint64 checksum;
+};
+
+struct LibThumbnailPack::IndexSlot {
+    quint64 key;
+    quint64 offset;
+    quint64 linkedContentKey;   // 非0时为链接槽位，文件移动后的身份键借用内容键相同的记录
+};
+
+struct LibThumbnailPack::RecordHeader {
+    quint32 magic;
+    quint32 format;
+    quint64 key;
+    qint32 width;
+    qint32 height;
+    qint32 bytesPerLine;
+    qint32 originalWidth;
+    qint32 originalHeight;
+    qint32 imageType;
+    quint64 contentKey;     // 内容采样哈希键，文件移动后据此找回
+    quint64 device;         // 写入时的文件身份，按内容找回时识别原地修改
+    quint64 inode;
+    qint64 modifiedNs;
+    quint64 dataSize;
+    quint64 checksum;
+};
+
+struct LibThumbnailPack::LiveEntry {
+    quint64 key;
+    quint64 offset;
+    quint64 size;
+    bool identity;          // 身份键或内容键
+    quint64 linkedContentKey;
+};
+
+LibThumbnailPack *LibThumbnailPack::instance()
+{
+    static LibThumbnailPack pack([]() {
+        const QString savePath = LibCommonService::instance()->getImgSavePath();
+        return savePath.isEmpty() ? QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/thumbnailpack"
+                                  : savePath + "/thumbnailpack";
+    }());
+    return &pack;
+}
+
+LibThumbnailPack::LibThumbnailPack(const QString &dirPath)
+    : m_dirPath(dirPath)
+    , m_maxBytes(DEFAULT_PACK_MAX_BYTES)
+{
+    if (open()) {
+        qDebug() << "Thumbnail pack opened:" << m_dirPath << "entries:" << count()
+                 << "bytes:" << packBytes() << "writable:" << m_writable;
+    } else {
+        qWarning() << "Failed to open thumbnail pack:" << m_dirPath;
+        close();
+    }
+}
+
+LibThumbnailPack::~LibThumbnailPack()
+{
+    close();
+}
+
+bool LibThumbnailPack::open()
+{
+    if (!QDir().mkpath(m_dirPath)) {
+        return false;
+    }
+
+    // 同一目录只允许一个进程写入
+    m_writeLock.reset(new QLockFile(m_dirPath + "/" + LOCK_FILE_NAME));
+    m_writeLock->setStaleLockTime(0);
+    m_writable = m_writeLock->tryLock(0);
+    const QIODevice::OpenMode mode = m_writable ? QIODevice::ReadWrite : QIODevice::ReadOnly;
+
+    m_packFile.setFileName(m_dirPath + "/" + PACK_FILE_NAME);
+    m_indexFile.setFileName(m_dirPath + "/" + INDEX_FILE_NAME);
+    if (!m_packFile.open(mode)) {
+        return false;
+    }
+
+    PackHeader packHeader;
+    const bool packOk = m_packFile.read(reinterpret_cast<char *>(&packHeader), sizeof(packHeader)) == sizeof(packHeader)
+                        && PACK_MAGIC == packHeader.magic && FORMAT_VERSION == packHeader.version;
+    if (packOk) {
+        m_packId = packHeader.packId;
+    } else if (!m_writable || !createPack()) {
+        return false;
+    }
+    if (!mapPack()) {
+        return false;
+    }
+
+    if (m_indexFile.open(mode) && mapIndex() && validIndex()) {
+        // 上次写入中断时留下的未提交数据不截断，其他进程可能仍映射着该文件，下次写入从提交长度处覆盖
+        const quint64 packSize = indexHeader()->packSize;
+        if (m_writable && static_cast<quint64>(m_packMapSize) > packSize) {
+            qWarning() << "Thumbnail pack has uncommitted data after" << packSize << ", it will be overwritten";
+        }
+        return true;
+    }
+    if (!m_writable) {
+        return false;
+    }
+    qWarning() << "Thumbnail pack index invalid, rebuilding:" << m_indexFile.fileName();
+    return rebuildIndex();
+}
+
+void LibThumbnailPack::close()
+{
+    if (m_packMap) {
+        m_packFile.unmap(m_packMap);
+        m_packMap = nullptr;
+        m_packMapSize = 0;
+    }
+    if (m_indexMap) {
+        m_indexFile.unmap(m_indexMap);
+        m_indexMap = nullptr;
+        m_indexMapSize = 0;
+    }
+    m_packFile.close();
+    m_indexFile.close();
+    if (m_writeLock && m_writable) {
+        m_writeLock->unlock();
+    }
+    m_writable = false;
+}
+
+bool LibThumbnailPack::createPack()
+{
+    // 旧版本的打包文件可能仍被其他进程映射，写入临时文件后原子替换，不在原文件上截断
+    const quint64 packId = newPackId();
+    const PackHeader header{PACK_MAGIC, FORMAT_VERSION, packId};
+    const QString tempPath = m_packFile.fileName() + ".tmp";
+    QFile temp(tempPath);
+    if (!temp.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || temp.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header) || !temp.flush()) {
+        temp.remove();
+        return false;
+    }
+    temp.close();
+
+    m_packFile.close();
+    if (0 != std::rename(QFile::encodeName(tempPath).constData(), QFile::encodeName(m_packFile.fileName()).constData())) {
+        temp.remove();
+        return false;
+    }
+    m_packId = packId;
+    return m_packFile.open(QIODevice::ReadWrite);
+}
+
+bool LibThumbnailPack::mapPack()
+{
+    if (m_packMap) {
+        m_packFile.unmap(m_packMap);
+        m_packMap = nullptr;
+        m_packMapSize = 0;
+    }
+    const qint64 size = m_packFile.size();
+    if (size < static_cast<qint64>(sizeof(PackHeader))) {
+        return false;
+    }
+    m_packMap = m_packFile.map(0, size);
+    m_packMapSize = m_packMap ? size : 0;
+    return m_packMap != nullptr;
+}
+
+bool LibThumbnailPack::mapIndex()
+{
+    if (m_indexMap) {
+        m_indexFile.unmap(m_indexMap);
+        m_indexMap = nullptr;
+        m_indexMapSize = 0;
+    }
+    const qint64 size = m_indexFile.size();
+    if (size < static_cast<qint64>(sizeof(IndexHeader))) {
+        return false;
+    }
+    m_indexMap = m_indexFile.map(0, size);
+    m_indexMapSize = m_indexMap ? size : 0;
+    return m_indexMap != nullptr;
+}
+
+bool LibThumbnailPack::validIndex() const
+{
+    const IndexHeader *header = indexHeader();
+    if (!header || INDEX_MAGIC != header->magic || FORMAT_VERSION != header->version
+            || m_packId != header->packId || headerChecksum(*header) != header->checksum) {
+        return false;
+    }
+    const quint64 capacity = header->capacity;
+    return capacity >= MIN_INDEX_CAPACITY && 0 == (capacity & (capacity - 1))
+           && static_cast<quint64>(header->count) * 100 <= capacity * MAX_LOAD_PERCENT
+           && sizeof(IndexHeader) + capacity * sizeof(IndexSlot) <= static_cast<quint64>(m_indexMapSize)
+           && header->packSize >= sizeof(PackHeader) && header->packSize <= static_cast<quint64>(m_packMapSize);
+}
+
+bool LibThumbnailPack::validRecord(const RecordHeader *record, quint64 available) const
+{
+    if (available < sizeof(RecordHeader) || RECORD_MAGIC != record->magic
+            || headerChecksum(*record) != record->checksum || !supportedFormat(record->format)) {
+        return false;
+    }
+    if (record->width <= 0 || record->height <= 0 || record->width > MAX_THUMBNAIL_SIDE
+            || record->height > MAX_THUMBNAIL_SIDE || record->bytesPerLine < record->width) {
+        return false;
+    }
+    return record->dataSize == static_cast<quint64>(record->bytesPerLine) * static_cast<quint64>(record->height)
+           && record->dataSize <= available - sizeof(RecordHeader);
+}
+
+LibThumbnailPack::IndexHeader *LibThumbnailPack::indexHeader() const
+{
+    return reinterpret_cast<IndexHeader *>(m_indexMap);
+}
+
+LibThumbnailPack::IndexSlot *LibThumbnailPack::indexSlots() const
+{
+    return reinterpret_cast<IndexSlot *>(m_indexMap + sizeof(IndexHeader));
+}
+
+LibThumbnailPack::IndexSlot *LibThumbnailPack::findSlot(quint64 key) const
+{
+    // 装载率不超过70%，线性探测总能找到空槽位
+    const quint64 mask = indexHeader()->capacity - 1;
+    IndexSlot *slots = indexSlots();
+    for (quint64 i = key & mask;; i = (i + 1) & mask) {
+        if (slots[i].key == key || 0 == slots[i].key) {
+            return &slots[i];
+        }
+    }
+}
+
+const LibThumbnailPack::RecordHeader *LibThumbnailPack::recordAt(const IndexSlot &slot) const
+{
+    const quint64 offset = slot.offset;
+    if (offset < sizeof(PackHeader) || offset >= static_cast<quint64>(m_packMapSize) || 0 != offset % RECORD_ALIGN) {
+        return nullptr;
+    }
+    const RecordHeader *record = reinterpret_cast<const RecordHeader *>(m_packMap + offset);
+    if (!validRecord(record, static_cast<quint64>(m_packMapSize) - offset)
+            || (record->key != slot.key && record->contentKey != slot.key
+                && (0 == slot.linkedContentKey || record->contentKey != slot.linkedContentKey))) {
+        return nullptr;
+    }
+    return record;
+}
+
+QVector<LibThumbnailPack::LiveEntry> LibThumbnailPack::liveEntries() const
+{
+    QVector<LiveEntry> entries;
+    const IndexHeader *header = indexHeader();
+    const IndexSlot *slots = indexSlots();
+    entries.reserve(static_cast<int>(header->count));
+    for (quint32 i = 0; i < header->capacity; ++i) {
+        if (0 == slots[i].key) {
+            continue;
+        }
+        const RecordHeader *record = recordAt(slots[i]);
+        if (record) {
+            entries.append(LiveEntry{slots[i].key, slots[i].offset, alignRecord(sizeof(RecordHeader) + record->dataSize),
+                                     slots[i].key != record->contentKey, slots[i].linkedContentKey});
+        }
+    }
+    std::sort(entries.begin(), entries.end(), [](const LiveEntry &left, const LiveEntry &right) {
+        return left.offset < right.offset;
+    });
+    return entries;
+}
+
+bool LibThumbnailPack::rebuildIndex()
+{
+    // 同一键以最后写入的记录为准
+    QHash<quint64, LiveEntry> latest;
+    quint64 deadBytes = 0;
+    quint64 offset = alignRecord(sizeof(PackHeader));
+    const quint64 size = static_cast<quint64>(m_packMapSize);
+    while (offset < size) {
+        const RecordHeader *record = reinterpret_cast<const RecordHeader *>(m_packMap + offset);
+        if (!validRecord(record, size - offset)) {
+            break;
+        }
+        const quint64 recordSize = alignRecord(sizeof(RecordHeader) + record->dataSize);
+        auto itr = latest.find(record->key);
+        if (itr != latest.end()) {
+            deadBytes += itr->size;
+        }
+        latest.insert(record->key, LiveEntry{record->key, offset, recordSize, true, 0});
+        if (0 != record->contentKey) {
+            latest.insert(record->contentKey, LiveEntry{record->contentKey, offset, recordSize, false, 0});
+        }
+        offset += recordSize;
+    }
+
+    // 损坏或不完整的尾部记录不计入提交长度，保留在文件中由之后的写入覆盖，避免截断其他进程的映射
+    const quint64 packSize = qMin(offset, size);
+    if (packSize < size) {
+        qWarning() << "Thumbnail pack has" << size - packSize << "invalid bytes after" << packSize;
+    }
+
+    QVector<LiveEntry> entries = latest.values().toVector();
+    return writeIndex(entries, packSize, deadBytes);
+}
+
+bool LibThumbnailPack::writeIndex(const QVector<LiveEntry> &entries, quint64 packSize, quint64 deadBytes)
+{
+    const quint32 capacity = nextPowerOfTwo(static_cast<quint64>(entries.size()) * 100 / MAX_LOAD_PERCENT + 1);
+    QVector<IndexSlot> slots(static_cast<int>(capacity), IndexSlot{0, 0, 0});
+    const quint64 mask = capacity - 1;
+    quint32 records = 0;
+    for (const LiveEntry &entry : entries) {
+        if (entry.identity) {
+            ++records;
+        }
+        quint64 i = entry.key & mask;
+        while (0 != slots[static_cast<int>(i)].key) {
+            i = (i + 1) & mask;
+        }
+        slots[static_cast<int>(i)] = IndexSlot{entry.key, entry.offset, entry.linkedContentKey};
+    }
+
+    IndexHeader header{INDEX_MAGIC, FORMAT_VERSION, m_packId, capacity, static_cast<quint32>(entries.size()),
+                       packSize, deadBytes, records, 0, 0};
+    header.checksum = headerChecksum(header);
+
+    // 写入临时文件后原子替换，读取中的其他进程仍使用旧文件
+    const QString tempPath = m_indexFile.fileName() + ".tmp";
+    QFile temp(tempPath);
+    if (!temp.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || temp.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)
+            || temp.write(reinterpret_cast<const char *>(slots.constData()), slots.size() * static_cast<int>(sizeof(IndexSlot)))
+            != slots.size() * static_cast<int>(sizeof(IndexSlot))) {
+        temp.remove();
+        return false;
+    }
+    temp.close();
+
+    if (m_indexMap) {
+        m_indexFile.unmap(m_indexMap);
+        m_indexMap = nullptr;
+        m_indexMapSize = 0;
+    }
+    m_indexFile.close();
+    if (0 != std::rename(QFile::encodeName(tempPath).constData(), QFile::encodeName(m_indexFile.fileName()).constData())) {
+        temp.remove();
+        return false;
+    }
+    return m_indexFile.open(QIODevice::ReadWrite) && mapIndex();
+}
+
+bool LibThumbnailPack::find(const QString &path, imageViewerSpace::ItemInfo &info,
+                            LibUnionImage_NameSpace::FileIdentity *foundIdentity)
+{
+    LibUnionImage_NameSpace::FileIdentity localIdentity;
+    LibUnionImage_NameSpace::FileIdentity &identity = foundIdentity ? *foundIdentity : localIdentity;
+    identity = LibUnionImage_NameSpace::fileIdentity(path);
+    if (!identity.isValid()) {
+        return false;
+    }
+    if (readRecord(identity.key(), info)) {
+        return true;
+    }
+
+    // 身份未命中时按内容采样哈希查找，文件被移动、复制或重命名后仍可复用
+    identity.contentHash = LibUnionImage_NameSpace::sampledContentHash(path);
+    const quint64 contentKey = identity.contentKey();
+    if (0 == contentKey || !readRecord(contentKey, info, &identity)) {
+        return false;
+    }
+    qDebug() << "Thumbnail pack matched moved file by content:" << path;
+    linkKey(identity.key(), contentKey);
+    return true;
+}
+
+bool LibThumbnailPack::readRecord(quint64 key, imageViewerSpace::ItemInfo &info,
+                                  const LibUnionImage_NameSpace::FileIdentity *identity)
+{
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        {
+            QReadLocker locker(&m_lock);
+            if (!m_indexMap || !m_packMap) {
+                return false;
+            }
+            const IndexSlot *slot = findSlot(key);
+            if (slot->key != key) {
+                return false;
+            }
+            const quint64 offset = slot->offset;
+            if (m_writable || offset < static_cast<quint64>(m_packMapSize)) {
+                const RecordHeader *record = recordAt(*slot);
+                if (!record) {
+                    return false;
+                }
+                // 同一文件修改时间变化说明内容已改变，采样哈希未覆盖修改的位置时也不能复用
+                if (identity && record->device == identity->device && record->inode == identity->inode
+                        && record->modifiedNs != identity->modifiedNs) {
+                    return false;
+                }
+                // 直接引用映射的像素数据，拷贝一次即可使用，无需解码
+                const QImage mapped(reinterpret_cast<const uchar *>(record) + sizeof(RecordHeader), record->width,
+                                    record->height, record->bytesPerLine, static_cast<QImage::Format>(record->format));
+                info.image = mapped.copy();
+                info.imgOriginalWidth = record->originalWidth;
+                info.imgOriginalHeight = record->originalHeight;
+                info.imageType = static_cast<imageViewerSpace::ImageType>(record->imageType);
+                return !info.image.isNull();
+            }
+        }
+        // 其他进程追加了记录，重新映射打包文件
+        QWriteLocker locker(&m_lock);
+        if (!m_packFile.isOpen() || !mapPack()) {
+            return false;
+        }
+    }
+    return false;
+}
+
+void LibThumbnailPack::linkKey(quint64 key, quint64 contentKey)
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_writable || !m_indexMap || !m_packMap) {
+        return;
+    }
+    const IndexSlot *contentSlot = findSlot(contentKey);
+    if (contentSlot->key != contentKey || !recordAt(*contentSlot)) {
+        return;
+    }
+    // 新身份键指向已有记录，不重复写入像素数据，槽位记录内容键以便校验和压缩时保留
+    const quint64 offset = contentSlot->offset;
+    IndexSlot *slot = findSlot(key);
+    IndexHeader *header = indexHeader();
+    if (slot->key != key) {
+        slot->key = key;
+        ++header->count;
+        ++header->records;
+    }
+    slot->offset = offset;
+    slot->linkedContentKey = contentKey;
+    header->checksum = headerChecksum(*header);
+    growIndexIfNeeded();
+}
+
+bool LibThumbnailPack::growIndexIfNeeded()
+{
+    const IndexHeader *header = indexHeader();
+    if (static_cast<quint64>(header->count) * 100 <= static_cast<quint64>(header->capacity) * MAX_LOAD_PERCENT) {
+        return true;
+    }
+    return writeIndex(liveEntries(), header->packSize, header->deadBytes);
+}
+
+bool LibThumbnailPack::insert(const QString &path, const imageViewerSpace::ItemInfo &info,
+                              const LibUnionImage_NameSpace::FileIdentity &knownIdentity)
+{
+    if (info.image.isNull() || info.image.width() > MAX_THUMBNAIL_SIDE || info.image.height() > MAX_THUMBNAIL_SIDE) {
+        return false;
+    }
+    LibUnionImage_NameSpace::FileIdentity identity = LibUnionImage_NameSpace::fileIdentity(path);
+    if (!identity.isValid()) {
+        return false;
+    }
+    // find未命中时已计算过内容采样哈希，文件未变化时直接复用，否则重新计算
+    // 此时文件刚被解码，读取的数据通常已在页缓存中
+    if (0 != knownIdentity.contentHash && knownIdentity == identity) {
+        identity.contentHash = knownIdentity.contentHash;
+    } else {
+        identity.contentHash = LibUnionImage_NameSpace::sampledContentHash(path);
+    }
+    const quint64 key = identity.key();
+
+    // 不透明图片以RGB888保存，减少四分之一的空间
+    const QImage image = info.image.convertToFormat(info.image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                                                 : QImage::Format_RGB888);
+    RecordHeader record;
+    memset(&record, 0, sizeof(record));
+    record.magic = RECORD_MAGIC;
+    record.format = static_cast<quint32>(image.format());
+    record.key = key;
+    record.width = image.width();
+    record.height = image.height();
+    record.bytesPerLine = image.bytesPerLine();
+    record.originalWidth = info.imgOriginalWidth;
+    record.originalHeight = info.imgOriginalHeight;
+    record.imageType = info.imageType;
+    record.contentKey = identity.contentKey();
+    record.device = identity.device;
+    record.inode = identity.inode;
+    record.modifiedNs = identity.modifiedNs;
+    record.dataSize = static_cast<quint64>(image.bytesPerLine()) * static_cast<quint64>(image.height());
+    record.checksum = headerChecksum(record);
+    const quint64 recordSize = alignRecord(sizeof(RecordHeader) + record.dataSize);
+    const QByteArray padding(static_cast<int>(recordSize - sizeof(RecordHeader) - record.dataSize), '\0');
+
+    QWriteLocker locker(&m_lock);
+    if (!m_writable || !m_indexMap || !m_packMap) {
+        return false;
+    }
+    IndexHeader *header = indexHeader();
+    const quint64 offset = header->packSize;
+    if (!m_packFile.seek(static_cast<qint64>(offset))
+            || m_packFile.write(reinterpret_cast<const char *>(&record), sizeof(record)) != sizeof(record)
+            || m_packFile.write(reinterpret_cast<const char *>(image.constBits()), static_cast<qint64>(record.dataSize))
+            != static_cast<qint64>(record.dataSize)
+            || m_packFile.write(padding) != padding.size() || !m_packFile.flush()) {
+        // 写入失败的数据位于提交长度之后，不截断文件，下次写入覆盖
+        qWarning() << "Failed to write thumbnail pack:" << m_packFile.errorString();
+        mapPack();
+        return false;
+    }
+    if (!mapPack()) {
+        return false;
+    }
+
+    // 打包文件写入完成后再更新索引，中断时未提交的数据会在下次打开时丢弃
+    IndexSlot *slot = findSlot(key);
+    if (slot->key == key) {
+        // 内容相同的旧记录不再被任何键引用，内容不同的旧记录仍可通过内容键找到
+        const RecordHeader *old = recordAt(*slot);
+        if (old && (0 == old->contentKey || old->contentKey == record.contentKey)) {
+            header->deadBytes += alignRecord(sizeof(RecordHeader) + old->dataSize);
+        }
+        slot->offset = offset;
+        slot->linkedContentKey = 0;
+    } else {
+        slot->offset = offset;
+        slot->key = key;
+        ++header->count;
+        ++header->records;
+    }
+    if (0 != record.contentKey) {
+        IndexSlot *contentSlot = findSlot(record.contentKey);
+        if (contentSlot->key != record.contentKey) {
+            contentSlot->key = record.contentKey;
+            ++header->count;
+        }
+        contentSlot->offset = offset;
+    }
+    header->packSize = offset + recordSize;
+    header->checksum = headerChecksum(*header);
+
+    if (!growIndexIfNeeded()) {
+        return false;
+    }
+    header = indexHeader();
+
+    if (header->packSize > static_cast<quint64>(m_maxBytes)
+            || (header->deadBytes > COMPACT_MIN_DEAD_BYTES && header->deadBytes * 100 > header->packSize * COMPACT_DEAD_PERCENT)) {
+        compactLocked();
+    }
+    return true;
+}
+
+bool LibThumbnailPack::compact()
+{
+    QWriteLocker locker(&m_lock);
+    if (!m_writable || !m_indexMap || !m_packMap) {
+        return false;
+    }
+    return compactLocked();
+}
+
+bool LibThumbnailPack::compactLocked()
+{
+    // 条目按偏移排序，身份键和内容键可能指向同一条记录，只复制一次
+    QVector<LiveEntry> entries = liveEntries();
+    quint64 totalSize = alignRecord(sizeof(PackHeader));
+    for (int i = 0; i < entries.size(); ++i) {
+        if (0 == i || entries.at(i).offset != entries.at(i - 1).offset) {
+            totalSize += entries.at(i).size;
+        }
+    }
+    // 超出预算时丢弃最早写入的记录
+    int first = 0;
+    if (totalSize > static_cast<quint64>(m_maxBytes)) {
+        const quint64 target = static_cast<quint64>(m_maxBytes) * LOW_WATERMARK_PERCENT / 100;
+        while (first < entries.size() && totalSize > target) {
+            const quint64 dropOffset = entries.at(first).offset;
+            totalSize -= entries.at(first).size;
+            while (first < entries.size() && entries.at(first).offset == dropOffset) {
+                ++first;
+            }
+        }
+    }
+
+    const quint64 packId = newPackId();
+    const QString tempPath = m_packFile.fileName() + ".tmp";
+    QFile temp(tempPath);
+    const PackHeader packHeader{PACK_MAGIC, FORMAT_VERSION, packId};
+    const QByteArray headerPadding(static_cast<int>(alignRecord(sizeof(PackHeader)) - sizeof(PackHeader)), '\0');
+    bool ok = temp.open(QIODevice::WriteOnly | QIODevice::Truncate)
+              && temp.write(reinterpret_cast<const char *>(&packHeader), sizeof(packHeader)) == sizeof(packHeader)
+              && temp.write(headerPadding) == headerPadding.size();
+
+    QVector<LiveEntry> kept;
+    kept.reserve(entries.size() - first);
+    quint64 offset = alignRecord(sizeof(PackHeader));
+    quint64 newOffset = offset;
+    int recordCount = 0;
+    for (int i = first; ok && i < entries.size(); ++i) {
+        const LiveEntry &entry = entries.at(i);
+        if (i == first || entry.offset != entries.at(i - 1).offset) {
+            ok = temp.write(reinterpret_cast<const char *>(m_packMap + entry.offset), static_cast<qint64>(entry.size))
+                 == static_cast<qint64>(entry.size);
+            newOffset = offset;
+            offset += entry.size;
+            ++recordCount;
+        }
+        kept.append(LiveEntry{entry.key, newOffset, entry.size, entry.identity, entry.linkedContentKey});
+    }
+    ok = ok && temp.flush();
+    temp.close();
+    if (!ok) {
+        qWarning() << "Failed to compact thumbnail pack:" << temp.errorString();
+        temp.remove();
+        return false;
+    }
+
+    const quint64 oldSize = static_cast<quint64>(m_packMapSize);
+    m_packFile.unmap(m_packMap);
+    m_packMap = nullptr;
+    m_packMapSize = 0;
+    m_packFile.close();
+    if (0 != std::rename(QFile::encodeName(tempPath).constData(), QFile::encodeName(m_packFile.fileName()).constData())) {
+        temp.remove();
+        return m_packFile.open(QIODevice::ReadWrite) && mapPack();
+    }
+    m_packId = packId;
+    if (!m_packFile.open(QIODevice::ReadWrite) || !mapPack()) {
+        return false;
+    }
+    qDebug() << "Thumbnail pack compacted from" << oldSize << "to" << offset << "bytes, kept" << recordCount << "records";
+    return writeIndex(kept, offset, 0);
+}
+
+bool LibThumbnailPack::isValid() const
+{
+    QReadLocker locker(&m_lock);
+    return m_indexMap && m_packMap;
+}
+
+bool LibThumbnailPack::isWritable() const
+{
+    QReadLocker locker(&m_lock);
+    return m_writable;
+}
+
+int LibThumbnailPack::count() const
+{
+    QReadLocker locker(&m_lock);
+    return m_indexMap ? static_cast<int>(indexHeader()->records) : 0;
+}
+
+qint64 LibThumbnailPack::packBytes() const
+{
+    QReadLocker locker(&m_lock);
+    return m_indexMap ? static_cast<qint64>(indexHeader()->packSize) : 0;
+}
+
+qint64 LibThumbnailPack::deadBytes() const
+{
+    QReadLocker locker(&m_lock);
+    return m_indexMap ? static_cast<qint64>(indexHeader()->deadBytes) : 0;
+}
+
+void LibThumbnailPack::setMaxBytes(qint64 bytes)
+{
+    QWriteLocker locker(&m_lock);
+    m_maxBytes = qMax<qint64>(0, bytes);
+}
+
+qint64 LibThumbnailPack::maxBytes() const
+{
+    QReadLocker locker(&m_lock);
+    return m_maxBytes;
+}
@@ -0,0 +1,119 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef THUMBNAILPACK_H
+#define THUMBNAILPACK_H
+
+#include "image-viewer_global.h"
+#include "unionimage/fileidentity.h"
+
+#include <QFile>
+#include <QLockFile>
+#include <QReadWriteLock>
+#include <QScopedPointer>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The LibThumbnailPack class
+ * 持久化的缩略图存储，替代每张图片一个PNG文件的方式
+ * 缩略图以未压缩像素追加写入打包文件，哈希索引文件记录键到偏移的映射，二者均内存映射读取，
+ * 命中时只需一次内存拷贝，没有PNG解压和目录查找的开销
+ * 以文件身份(设备、inode、大小、修改时间)为键，图片修改后旧条目自然失效，
+ * 同时记录内容采样哈希，文件移动或复制后按内容找回已有缩略图，并为新身份键建立链接
+ * 同一文件(设备、inode相同)修改时间变化时视为原地修改，不按内容复用旧条目
+ * 索引损坏或与打包文件不一致时扫描打包文件重建，失效条目过多或超出预算时压缩
+ * 同一目录只允许一个进程写入，其他进程以只读方式打开
+ * 其他进程可能映射着打包文件，写入进程从不原地截断，只追加或以临时文件原子替换
+ * 所有接口线程安全
+ */
+class LibThumbnailPack
+{
+public:
+    static LibThumbnailPack *instance();
+
+    // 在指定目录打开或创建存储，目录不可用时所有操作均失败
+    explicit LibThumbnailPack(const QString &dirPath);
+    ~LibThumbnailPack();
+
+    /**
+     * @brief find
+     * @param[in]           path
+     * @param[out]          info        填充缩略图、原图尺寸和图片类型
+     * @param[out]          identity    非空时输出文件身份，未命中时包含已计算的内容采样哈希，供随后的insert复用
+     * @return bool
+     * 文件未变化且存在有效条目时返回true
+     */
+    bool find(const QString &path, imageViewerSpace::ItemInfo &info,
+              LibUnionImage_NameSpace::FileIdentity *identity = nullptr);
+
+    // 保存缩略图及原图尺寸、图片类型，同一文件的旧条目变为失效条目
+    // knownIdentity为find输出的身份，文件未变化时复用其内容采样哈希，不再重复读取文件
+    bool insert(const QString &path, const imageViewerSpace::ItemInfo &info,
+                const LibUnionImage_NameSpace::FileIdentity &knownIdentity = LibUnionImage_NameSpace::FileIdentity());
+
+    // 丢弃失效条目，超出预算时同时丢弃最早写入的条目
+    bool compact();
+
+    bool isValid() const;
+    bool isWritable() const;
+    int count() const;
+    qint64 packBytes() const;
+    qint64 deadBytes() const;
+
+    void setMaxBytes(qint64 bytes);
+    qint64 maxBytes() const;
+
+private:
+    Q_DISABLE_COPY(LibThumbnailPack)
+
+    struct IndexHeader;
+    struct IndexSlot;
+    struct RecordHeader;
+    struct LiveEntry;
+
+    bool open();
+    void close();
+    bool createPack();
+    bool mapPack();
+    bool mapIndex();
+    bool validIndex() const;
+    bool validRecord(const RecordHeader *record, quint64 available) const;
+
+    IndexHeader *indexHeader() const;
+    IndexSlot *indexSlots() const;
+    // 返回键所在或应插入的槽位
+    IndexSlot *findSlot(quint64 key) const;
+    // 校验并返回槽位指向的记录，记录的身份键或内容键须为槽位的键，链接槽位按内容键校验，无效时返回nullptr
+    const RecordHeader *recordAt(const IndexSlot &slot) const;
+    // identity非空时为按内容键查找，拒绝同一文件原地修改前的记录
+    bool readRecord(quint64 key, imageViewerSpace::ItemInfo &info,
+                    const LibUnionImage_NameSpace::FileIdentity *identity = nullptr);
+    // 为文件的新身份键建立到内容键相同记录的链接槽位
+    void linkKey(quint64 key, quint64 contentKey);
+    bool growIndexIfNeeded();
+    // 索引中仍有效的条目，按写入顺序排列
+    QVector<LiveEntry> liveEntries() const;
+
+    // 扫描打包文件重建索引，丢弃尾部不完整的记录
+    bool rebuildIndex();
+    // 以原子替换的方式写入新索引，容量按条目数计算
+    bool writeIndex(const QVector<LiveEntry> &entries, quint64 packSize, quint64 deadBytes);
+    bool compactLocked();
+
+    QString m_dirPath;
+    mutable QReadWriteLock m_lock;
+    QScopedPointer<QLockFile> m_writeLock;
+    QFile m_packFile;
+    QFile m_indexFile;
+    uchar *m_packMap = nullptr;
+    qint64 m_packMapSize = 0;
+    uchar *m_indexMap = nullptr;
+    qint64 m_indexMapSize = 0;
+    quint64 m_packId = 0;
+    bool m_writable = false;
+    qint64 m_maxBytes;
+};
+
+#endif // THUMBNAILPACK_H
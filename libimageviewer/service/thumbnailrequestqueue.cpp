@@ -0,0 +1,180 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "thumbnailrequestqueue.h"
+
+#include <QDebug>
+
+#include <iterator>
+
+void LibThumbnailRequestQueue::push(const QString &path, int row)
+{
+    if (path.isEmpty()) {
+        return;
+    }
+    const int rank = row < 0 ? -1 : row;
+    auto itr = m_index.find(path);
+    if (itr != m_index.end()) {
+        if (itr.value() == rank && rank >= 0) {
+            return;
+        }
+        remove(path);
+    }
+    if (rank >= 0 && isFar(rank)) {
+        m_dropped.insert(path);
+        return;
+    }
+
+    if (rank >= 0) {
+        // 行号变化后旧路径仍占用该行时，以新请求为准
+        auto existing = m_ranked.find(rank);
+        if (existing != m_ranked.end()) {
+            m_index.remove(existing.value());
+            existing.value() = path;
+        } else {
+            m_ranked.insert(rank, path);
+        }
+    } else {
+        m_unranked.prepend(path);
+    }
+    m_index.insert(path, rank);
+    m_dropped.remove(path);
+}
+
+QString LibThumbnailRequestQueue::pop()
+{
+    if (m_ranked.isEmpty()) {
+        if (m_unranked.isEmpty()) {
+            return QString();
+        }
+        const QString path = m_unranked.takeFirst();
+        m_index.remove(path);
+        return path;
+    }
+
+    // 第一个不小于可见范围起点的请求位于范围内或右侧，它的前一个位于左侧
+    auto right = m_ranked.lowerBound(m_first);
+    auto left = right == m_ranked.begin() ? m_ranked.end() : std::prev(right);
+    auto chosen = right;
+    if (right == m_ranked.end()) {
+        chosen = left;
+    } else if (left != m_ranked.end()) {
+        const int rightDistance = qMax(0, right.key() - m_last);
+        const int leftDistance = m_first - left.key();
+        if (leftDistance < rightDistance || (leftDistance == rightDistance && m_preferLeft)) {
+            chosen = left;
+        }
+        if (leftDistance == rightDistance) {
+            m_preferLeft = !m_preferLeft;
+        }
+    }
+
+    const QString path = chosen.value();
+    m_ranked.erase(chosen);
+    m_index.remove(path);
+    return path;
+}
+
+bool LibThumbnailRequestQueue::remove(const QString &path)
+{
+    auto itr = m_index.find(path);
+    if (itr == m_index.end()) {
+        return false;
+    }
+    if (itr.value() >= 0) {
+        m_ranked.remove(itr.value());
+    } else {
+        m_unranked.removeOne(path);
+    }
+    m_index.erase(itr);
+    return true;
+}
+
+bool LibThumbnailRequestQueue::contains(const QString &path) const
+{
+    return m_index.contains(path);
+}
+
+int LibThumbnailRequestQueue::size() const
+{
+    return m_index.size();
+}
+
+bool LibThumbnailRequestQueue::isEmpty() const
+{
+    return m_index.isEmpty();
+}
+
+void LibThumbnailRequestQueue::clear()
+{
+    m_ranked.clear();
+    m_unranked.clear();
+    m_index.clear();
+    m_dropped.clear();
+}
+
+void LibThumbnailRequestQueue::reorder(const QHash<QString, int> &rows)
+{
+    const QList<QString> paths = m_index.keys();
+    m_ranked.clear();
+    m_unranked.clear();
+    m_index.clear();
+    for (const QString &path : paths) {
+        push(path, rows.value(path, -1));
+    }
+
+    // 不在新列表中的图片不会再显示，无需重新请求
+    for (auto itr = m_dropped.begin(); itr != m_dropped.end();) {
+        if (rows.contains(*itr)) {
+            ++itr;
+        } else {
+            itr = m_dropped.erase(itr);
+        }
+    }
+}
+
+void LibThumbnailRequestQueue::setVisibleRange(int first, int last, int dropDistance)
+{
+    m_first = qMax(0, qMin(first, last));
+    m_last = qMax(m_first, qMax(first, last));
+    m_dropDistance = dropDistance;
+    dropFar();
+}
+
+bool LibThumbnailRequestQueue::takeDropped(const QString &path)
+{
+    return m_dropped.remove(path);
+}
+
+void LibThumbnailRequestQueue::dropFar()
+{
+    if (m_dropDistance < 0 || m_ranked.isEmpty()) {
+        return;
+    }
+    int droppedCount = 0;
+    // 请求按行号有序，只需从两端删除
+    while (!m_ranked.isEmpty() && isFar(m_ranked.firstKey())) {
+        const QString path = m_ranked.take(m_ranked.firstKey());
+        m_index.remove(path);
+        m_dropped.insert(path);
+        ++droppedCount;
+    }
+    while (!m_ranked.isEmpty() && isFar(m_ranked.lastKey())) {
+        const QString path = m_ranked.take(m_ranked.lastKey());
+        m_index.remove(path);
+        m_dropped.insert(path);
+        ++droppedCount;
+    }
+    if (droppedCount > 0) {
+        qDebug() << "Dropped" << droppedCount << "thumbnail requests out of view, visible range:" << m_first << m_last;
+    }
+}
+
+bool LibThumbnailRequestQueue::isFar(int row) const
+{
+    if (m_dropDistance < 0) {
+        return false;
+    }
+    return row < m_first - m_dropDistance || row > m_last + m_dropDistance;
+}
@@ -0,0 +1,66 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef THUMBNAILREQUESTQUEUE_H
+#define THUMBNAILREQUESTQUEUE_H
+
+#include <QHash>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QString>
+
+/**
+ * @brief The LibThumbnailRequestQueue class
+ * 缩略图请求的优先队列，优先级为图片所在行与可见范围的距离，可见范围内的请求最先取出，
+ * 范围外的请求由近及远、左右交替取出
+ * 请求按行号有序保存并以路径索引，插入、删除和取出均为O(log n)；
+ * 距离由取出时的可见范围决定，滚动时只更新范围，无需重排已有请求
+ * 距离可见范围过远的请求被丢弃并记录，再次可见时由调用方重新请求
+ * 非线程安全，由调用方加锁
+ */
+class LibThumbnailRequestQueue
+{
+public:
+    // 插入请求，row小于0表示不在图片列表中，此类请求排在列表内请求之后，后加入的先取出
+    void push(const QString &path, int row);
+    // 取出优先级最高的请求，队列为空时返回空字符串
+    QString pop();
+    bool remove(const QString &path);
+    bool contains(const QString &path) const;
+    int size() const;
+    bool isEmpty() const;
+    // 清空请求和丢弃记录
+    void clear();
+
+    // 图片列表变化时按新的行号重新排列已有请求，O(n log n)
+    void reorder(const QHash<QString, int> &rows);
+
+    /**
+     * @brief setVisibleRange
+     * @param[in]           first
+     * @param[in]           last
+     * @param[in]           dropDistance    与可见范围的距离超过该值的请求被丢弃，小于0时不丢弃
+     */
+    void setVisibleRange(int first, int last, int dropDistance = -1);
+
+    // 该路径的请求曾被丢弃时返回true并清除记录
+    bool takeDropped(const QString &path);
+
+private:
+    // 丢弃距离可见范围过远的请求
+    void dropFar();
+    bool isFar(int row) const;
+
+    QMap<int, QString> m_ranked;        // 行号到路径，按行号有序
+    QList<QString> m_unranked;          // 不在图片列表中的请求
+    QHash<QString, int> m_index;        // 路径到行号，不在列表中时为-1
+    QSet<QString> m_dropped;
+    int m_first = 0;
+    int m_last = 0;
+    int m_dropDistance = -1;
+    bool m_preferLeft = false;          // 距离相同时左右交替
+};
+
+#endif // THUMBNAILREQUESTQUEUE_H
@@ -0,0 +1,217 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "thumbnailstore.h"
+
+#include <QMutexLocker>
+#include <QVector>
+#include <QDebug>
+
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+// 默认预算，200像素宽的缩略图约可缓存1000张
+const qint64 DEFAULT_STORE_MAX_BYTES = 128LL * 1024 * 1024;
+// 超出预算时一次淘汰到预算的该比例，避免每次插入都重新排序
+const int LOW_WATERMARK_PERCENT = 75;
+
+}
+
+LibThumbnailStore *LibThumbnailStore::instance()
+{
+    static LibThumbnailStore store;
+    return &store;
+}
+
+LibThumbnailStore::LibThumbnailStore()
+    : m_maxBytes(DEFAULT_STORE_MAX_BYTES)
+{
+}
+
+bool LibThumbnailStore::find(const QString &path, QImage &image)
+{
+    QMutexLocker locker(&m_mutex);
+    auto itr = m_entries.find(path);
+    if (itr == m_entries.end()) {
+        return false;
+    }
+    itr->lastUsed = ++m_useCounter;
+    image = itr->image;
+    return true;
+}
+
+bool LibThumbnailStore::contains(const QString &path) const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.contains(path);
+}
+
+void LibThumbnailStore::insert(const QString &path, const QImage &image)
+{
+    if (path.isEmpty() || image.isNull()) {
+        return;
+    }
+    const qint64 bytes = image.sizeInBytes();
+
+    QMutexLocker locker(&m_mutex);
+    auto itr = m_entries.find(path);
+    if (itr != m_entries.end()) {
+        m_totalBytes -= itr->bytes;
+        m_entries.erase(itr);
+    }
+    if (bytes > m_maxBytes) {
+        return;
+    }
+    m_entries.insert(path, Entry{image, bytes, ++m_useCounter});
+    m_totalBytes += bytes;
+    m_evicted.remove(path);
+    evict();
+}
+
+void LibThumbnailStore::remove(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    auto itr = m_entries.find(path);
+    if (itr != m_entries.end()) {
+        m_totalBytes -= itr->bytes;
+        m_entries.erase(itr);
+    }
+    m_evicted.remove(path);
+}
+
+void LibThumbnailStore::rename(const QString &oldPath, const QString &newPath)
+{
+    QMutexLocker locker(&m_mutex);
+    auto itr = m_entries.find(oldPath);
+    if (itr == m_entries.end()) {
+        return;
+    }
+    const Entry entry = itr.value();
+    m_entries.erase(itr);
+    auto existing = m_entries.find(newPath);
+    if (existing != m_entries.end()) {
+        m_totalBytes -= existing->bytes;
+        m_entries.erase(existing);
+    }
+    m_entries.insert(newPath, entry);
+    if (m_order.contains(oldPath)) {
+        m_order.insert(newPath, m_order.take(oldPath));
+    }
+}
+
+void LibThumbnailStore::clear()
+{
+    QMutexLocker locker(&m_mutex);
+    m_entries.clear();
+    m_evicted.clear();
+    m_totalBytes = 0;
+}
+
+bool LibThumbnailStore::takeEvicted(const QString &path)
+{
+    QMutexLocker locker(&m_mutex);
+    return m_evicted.remove(path);
+}
+
+void LibThumbnailStore::setOrder(const QStringList &paths)
+{
+    QHash<QString, int> order;
+    order.reserve(paths.size());
+    for (int i = 0; i < paths.size(); ++i) {
+        order.insert(paths.at(i), i);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    m_order.swap(order);
+    // 不在新列表中的图片不会再显示，无需重新生成
+    for (auto itr = m_evicted.begin(); itr != m_evicted.end();) {
+        if (m_order.contains(*itr)) {
+            ++itr;
+        } else {
+            itr = m_evicted.erase(itr);
+        }
+    }
+}
+
+void LibThumbnailStore::setVisualIndex(int index)
+{
+    QMutexLocker locker(&m_mutex);
+    m_visualIndex = index;
+}
+
+int LibThumbnailStore::visualIndex() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_visualIndex;
+}
+
+void LibThumbnailStore::setMaxBytes(qint64 bytes)
+{
+    qDebug() << "Thumbnail store budget:" << bytes / 1024 / 1024 << "MB";
+    QMutexLocker locker(&m_mutex);
+    m_maxBytes = qMax<qint64>(0, bytes);
+    evict();
+}
+
+qint64 LibThumbnailStore::maxBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_maxBytes;
+}
+
+qint64 LibThumbnailStore::totalBytes() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_totalBytes;
+}
+
+int LibThumbnailStore::count() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_entries.size();
+}
+
+void LibThumbnailStore::evict()
+{
+    if (m_totalBytes <= m_maxBytes) {
+        return;
+    }
+
+    struct Candidate {
+        int distance;
+        quint64 lastUsed;
+        QString path;
+    };
+    QVector<Candidate> candidates;
+    candidates.reserve(m_entries.size());
+    for (auto itr = m_entries.constBegin(); itr != m_entries.constEnd(); ++itr) {
+        auto order = m_order.constFind(itr.key());
+        // 不在图片列表中的条目最先淘汰
+        const int distance = order == m_order.constEnd() ? INT_MAX : qAbs(order.value() - m_visualIndex);
+        candidates.append(Candidate{distance, itr->lastUsed, itr.key()});
+    }
+    std::sort(candidates.begin(), candidates.end(), [](const Candidate &left, const Candidate &right) {
+        if (left.distance != right.distance) {
+            return left.distance > right.distance;
+        }
+        return left.lastUsed < right.lastUsed;
+    });
+
+    const qint64 target = m_maxBytes * LOW_WATERMARK_PERCENT / 100;
+    int evictedCount = 0;
+    for (const Candidate &candidate : candidates) {
+        if (m_totalBytes <= target) {
+            break;
+        }
+        auto itr = m_entries.find(candidate.path);
+        m_totalBytes -= itr->bytes;
+        m_entries.erase(itr);
+        m_evicted.insert(candidate.path);
+        ++evictedCount;
+    }
+    qDebug() << "Thumbnail store evicted" << evictedCount << "entries, remaining:" << m_entries.size()
+             << "bytes:" << m_totalBytes << "visual index:" << m_visualIndex;
+}
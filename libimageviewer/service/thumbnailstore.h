@@ -0,0 +1,80 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef THUMBNAILSTORE_H
+#define THUMBNAILSTORE_H
+
+#include <QHash>
+#include <QImage>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+
+/**
+ * @brief The LibThumbnailStore class
+ * 进程内唯一的缩略图存储，LibCommonService和LibImageDataService不再各自保存缩略图
+ * 以路径为键哈希查找，按字节预算淘汰，超出预算时优先淘汰距离当前可见位置最远的条目，
+ * 距离相同或不在图片列表中的条目按最近最少使用淘汰
+ * 被淘汰的路径会被记录，再次需要时由缩略图读取线程重新生成
+ * 所有接口线程安全
+ */
+class LibThumbnailStore
+{
+public:
+    static LibThumbnailStore *instance();
+
+    // 读取缩略图并更新最近使用时间，未缓存时返回false
+    bool find(const QString &path, QImage &image);
+
+    // 仅判断是否已缓存，不更新最近使用时间
+    bool contains(const QString &path) const;
+
+    // 缓存缩略图，超过预算的单张图片不缓存
+    void insert(const QString &path, const QImage &image);
+    void remove(const QString &path);
+    void rename(const QString &oldPath, const QString &newPath);
+    void clear();
+
+    /**
+     * @brief takeEvicted
+     * @param[in]           path
+     * @return bool
+     * 该路径的缩略图曾因超出预算被淘汰时返回true并清除记录，调用方负责重新生成
+     */
+    bool takeEvicted(const QString &path);
+
+    // 设置图片列表顺序，淘汰时以列表中的位置计算与可见位置的距离
+    void setOrder(const QStringList &paths);
+    void setVisualIndex(int index);
+    int visualIndex() const;
+
+    void setMaxBytes(qint64 bytes);
+    qint64 maxBytes() const;
+    qint64 totalBytes() const;
+    int count() const;
+
+private:
+    LibThumbnailStore();
+    Q_DISABLE_COPY(LibThumbnailStore)
+
+    struct Entry {
+        QImage image;
+        qint64 bytes;
+        quint64 lastUsed;
+    };
+
+    // 超出预算时淘汰到预算的低水位，需持有m_mutex
+    void evict();
+
+    mutable QMutex m_mutex;
+    QHash<QString, Entry> m_entries;
+    QHash<QString, int> m_order;        // 路径在图片列表中的位置
+    QSet<QString> m_evicted;            // 被淘汰、等待重新生成的路径
+    int m_visualIndex = 0;
+    qint64 m_maxBytes = 0;
+    qint64 m_totalBytes = 0;
+    quint64 m_useCounter = 0;
+};
+
+#endif // THUMBNAILSTORE_H
@@ -4,6 +4,7 @@
 
 #include "imageanimation.h"
 #include "unionimage/unionimage.h"
+#include "service/decodedimagecache.h"
 
 #include <QDebug>
 #include <QVBoxLayout>
@@ -620,7 +621,7 @@ void LibImageAnimationPrivate::setImage1(const QString &imageName1_bar)
     m_imageName1 = imageName1_bar;
     QImage tImg;
     QString errMsg;
-    LibUnionImage_NameSpace::loadStaticImageFromFile(imageName1_bar, tImg, errMsg);
+    LibDecodedImageCache::instance()->loadImage(imageName1_bar, tImg, errMsg);
     QPixmap p1 = QPixmap::fromImage(tImg);
     int beginX = 0, beginY = 0;
 
@@ -688,7 +689,7 @@ void LibImageAnimationPrivate::setImage2(const QString &imageName2_bar)
     int beginX = 0, beginY = 0;
     QImage tImg;
     QString errMsg;
-    LibUnionImage_NameSpace::loadStaticImageFromFile(imageName2_bar, tImg, errMsg);
+    LibDecodedImageCache::instance()->loadImage(imageName2_bar, tImg, errMsg);
     QPixmap p2 = QPixmap::fromImage(tImg);
 
     QRect screenGeometry;
@@ -0,0 +1,120 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "fileidentity.h"
+
+#include <QFile>
+#include <QDebug>
+
+#include <sys/stat.h>
+
+#ifdef USE_XXHASH
+#include <xxhash.h>
+#endif
+
+namespace {
+
+// 内容采样的块大小，头、中、尾各一块
+const qint64 SAMPLE_BLOCK_SIZE = 64 * 1024;
+// 身份键和内容键使用不同的种子，避免二者混用时冲突
+const quint64 IDENTITY_SEED = 0x4964656e74697479ULL;
+const quint64 CONTENT_SEED = 0x436f6e74656e7400ULL;
+
+}
+
+namespace LibUnionImage_NameSpace {
+
+quint64 hash64(const void *data, size_t size, quint64 seed)
+{
+#ifdef USE_XXHASH
+    return XXH64(data, size, seed);
+#else
+    // FNV-1a
+    quint64 hash = 14695981039346656037ULL ^ seed;
+    const uchar *bytes = static_cast<const uchar *>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+#endif
+}
+
+quint64 FileIdentity::key() const
+{
+    const qint64 values[] = {static_cast<qint64>(device), static_cast<qint64>(inode), size, modifiedNs, changedNs};
+    const quint64 result = hash64(values, sizeof(values), IDENTITY_SEED);
+    return result ? result : 1;
+}
+
+quint64 FileIdentity::contentKey() const
+{
+    if (0 == contentHash) {
+        return 0;
+    }
+    const qint64 values[] = {size, static_cast<qint64>(contentHash)};
+    const quint64 result = hash64(values, sizeof(values), CONTENT_SEED);
+    return result ? result : 1;
+}
+
+QString FileIdentity::toString() const
+{
+    return QString::number(key(), 16).rightJustified(16, '0');
+}
+
+bool FileIdentity::operator==(const FileIdentity &other) const
+{
+    return device == other.device && inode == other.inode && size == other.size
+           && modifiedNs == other.modifiedNs && changedNs == other.changedNs;
+}
+
+FileIdentity fileIdentity(const QString &path, bool withContentHash)
+{
+    FileIdentity identity;
+    struct stat st;
+    if (stat(QFile::encodeName(path).constData(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        return identity;
+    }
+    identity.device = static_cast<quint64>(st.st_dev);
+    identity.inode = static_cast<quint64>(st.st_ino);
+    identity.size = static_cast<qint64>(st.st_size);
+    identity.modifiedNs = static_cast<qint64>(st.st_mtim.tv_sec) * 1000000000LL + st.st_mtim.tv_nsec;
+    identity.changedNs = static_cast<qint64>(st.st_ctim.tv_sec) * 1000000000LL + st.st_ctim.tv_nsec;
+    if (withContentHash) {
+        identity.contentHash = sampledContentHash(path);
+    }
+    return identity;
+}
+
+quint64 sampledContentHash(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open file for content hash:" << path;
+        return 0;
+    }
+
+    const qint64 size = file.size();
+    QByteArray data;
+    if (size <= SAMPLE_BLOCK_SIZE * 3) {
+        data = file.readAll();
+    } else {
+        data.reserve(static_cast<int>(SAMPLE_BLOCK_SIZE * 3));
+        const qint64 offsets[] = {0, (size - SAMPLE_BLOCK_SIZE) / 2, size - SAMPLE_BLOCK_SIZE};
+        for (qint64 offset : offsets) {
+            if (!file.seek(offset)) {
+                return 0;
+            }
+            data.append(file.read(SAMPLE_BLOCK_SIZE));
+        }
+    }
+    if (data.isEmpty() && size > 0) {
+        return 0;
+    }
+    data.append(reinterpret_cast<const char *>(&size), sizeof(size));
+    const quint64 result = hash64(data.constData(), static_cast<size_t>(data.size()), CONTENT_SEED);
+    return result ? result : 1;
+}
+
+};
@@ -0,0 +1,64 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef FILEIDENTITY_H
+#define FILEIDENTITY_H
+
+#include <QString>
+
+#include "unionimage.h"
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief The FileIdentity struct
+ * 文件身份，只需一次stat即可得到，用于替代读取文件内容计算MD5作为缓存键
+ * 设备号和inode区分不同文件，大小、修改时间和状态变化时间(纳秒精度)识别内容变化
+ * 可选的内容采样哈希对文件头、中、尾各一块数据计算，文件被移动或复制后仍能识别为同一内容
+ */
+struct UNIONIMAGESHARED_EXPORT FileIdentity {
+    quint64 device = 0;
+    quint64 inode = 0;
+    qint64 size = -1;
+    qint64 modifiedNs = 0;
+    qint64 changedNs = 0;
+    quint64 contentHash = 0;        // 未计算时为0
+
+    bool isValid() const
+    {
+        return size >= 0;
+    }
+
+    // 身份键，进程间稳定，不会为0
+    quint64 key() const;
+    // 内容键，未计算内容哈希时返回0
+    quint64 contentKey() const;
+    // 十六进制字符串形式的身份键，可用作文件名
+    QString toString() const;
+
+    bool operator==(const FileIdentity &other) const;
+    bool operator!=(const FileIdentity &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+/**
+ * @brief fileIdentity
+ * @param[in]           path
+ * @param[in]           withContentHash     是否同时计算内容采样哈希，需要读取约192KB数据
+ * @return FileIdentity
+ * 文件不存在时返回无效的身份
+ */
+UNIONIMAGESHARED_EXPORT FileIdentity fileIdentity(const QString &path, bool withContentHash = false);
+
+// 对文件头、中、尾各读取一块计算哈希，小文件读取全部内容，失败时返回0
+UNIONIMAGESHARED_EXPORT quint64 sampledContentHash(const QString &path);
+
+// 64位非加密哈希，有libxxhash时使用XXH64
+UNIONIMAGESHARED_EXPORT quint64 hash64(const void *data, size_t size, quint64 seed = 0);
+
+};
+
+#endif // FILEIDENTITY_H
@@ -0,0 +1,395 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "imageexif.h"
+#include "imagetransform.h"
+
+#include <QBuffer>
+#include <QFile>
+#include <QIODevice>
+#include <QSet>
+#include <QVector>
+#include <QtEndian>
+#include <QDebug>
+
+#include <cstring>
+
+namespace LibUnionImage_NameSpace {
+
+namespace {
+
+const quint16 TAG_ORIENTATION = 0x0112;
+const quint16 TAG_JPEG_OFFSET = 0x0201;
+const quint16 TAG_JPEG_LENGTH = 0x0202;
+const quint16 TAG_EXIF_IFD = 0x8769;
+const quint16 TAG_PIXEL_X = 0xA002;
+const quint16 TAG_PIXEL_Y = 0xA003;
+
+const quint16 TYPE_SHORT = 3;
+const quint16 TYPE_LONG = 4;
+
+// IFD项数上限，防止损坏文件导致大量读取
+const int MAX_IFD_ENTRIES = 1024;
+// 内嵌缩略图大小上限，RAW文件的预览图可能较大
+const qint64 MAX_THUMBNAIL_LENGTH = 4 * 1024 * 1024;
+// JPEG文件头中查找APP1段时最多遍历的段数
+const int MAX_JPEG_SEGMENTS = 64;
+
+struct IfdEntry {
+    quint16 tag = 0;
+    quint16 type = 0;
+    quint32 count = 0;
+    uchar value[4] = {0, 0, 0, 0};
+    qint64 valueOffset = 0;         // 值字段相对于TIFF头的偏移
+};
+
+/**
+ * @brief The TiffReader class
+ * 按TIFF头指定的字节序读取IFD，偏移均相对于TIFF头起始位置
+ */
+class TiffReader
+{
+public:
+    TiffReader(QIODevice *device, qint64 base, qint64 length)
+        : m_device(device)
+        , m_base(base)
+        , m_length(length)
+    {
+    }
+
+    bool readHeader(quint32 &firstIfd)
+    {
+        uchar header[8];
+        if (!readAt(0, header, sizeof(header))) {
+            return false;
+        }
+        if (header[0] == 'I' && header[1] == 'I') {
+            m_bigEndian = false;
+        } else if (header[0] == 'M' && header[1] == 'M') {
+            m_bigEndian = true;
+        } else {
+            return false;
+        }
+        if (u16(header + 2) != 42) {
+            return false;
+        }
+        firstIfd = u32(header + 4);
+        return true;
+    }
+
+    bool readIfd(quint32 offset, QVector<IfdEntry> &entries, quint32 &nextIfd)
+    {
+        uchar countData[2];
+        if (!readAt(offset, countData, sizeof(countData))) {
+            return false;
+        }
+        const int count = u16(countData);
+        if (count <= 0 || count > MAX_IFD_ENTRIES) {
+            return false;
+        }
+
+        QByteArray data(count * 12 + 4, 0);
+        uchar *p = reinterpret_cast<uchar *>(data.data());
+        if (!readAt(offset + 2, p, data.size())) {
+            return false;
+        }
+
+        entries.resize(count);
+        for (int i = 0; i < count; ++i) {
+            const uchar *e = p + i * 12;
+            IfdEntry &entry = entries[i];
+            entry.tag = u16(e);
+            entry.type = u16(e + 2);
+            entry.count = u32(e + 4);
+            memcpy(entry.value, e + 8, 4);
+            entry.valueOffset = static_cast<qint64>(offset) + 2 + i * 12 + 8;
+        }
+        nextIfd = u32(p + count * 12);
+        return true;
+    }
+
+    // 仅处理单个SHORT/LONG值，值直接存放在IFD项中
+    bool value(const IfdEntry &entry, quint32 &res) const
+    {
+        if (entry.count != 1) {
+            return false;
+        }
+        if (entry.type == TYPE_SHORT) {
+            res = u16(entry.value);
+            return true;
+        }
+        if (entry.type == TYPE_LONG) {
+            res = u32(entry.value);
+            return true;
+        }
+        return false;
+    }
+
+    bool readAt(qint64 offset, uchar *data, qint64 size)
+    {
+        if (offset < 0 || size < 0 || offset + size > m_length) {
+            return false;
+        }
+        if (!m_device->seek(m_base + offset)) {
+            return false;
+        }
+        return m_device->read(reinterpret_cast<char *>(data), size) == size;
+    }
+
+    qint64 base() const { return m_base; }
+    qint64 length() const { return m_length; }
+    bool isBigEndian() const { return m_bigEndian; }
+
+private:
+    quint16 u16(const uchar *p) const
+    {
+        return m_bigEndian ? qFromBigEndian<quint16>(p) : qFromLittleEndian<quint16>(p);
+    }
+
+    quint32 u32(const uchar *p) const
+    {
+        return m_bigEndian ? qFromBigEndian<quint32>(p) : qFromLittleEndian<quint32>(p);
+    }
+
+    QIODevice *m_device;
+    qint64 m_base;
+    qint64 m_length;
+    bool m_bigEndian = false;
+};
+
+/**
+ * @brief findExifSegment
+ * 遍历JPEG文件头的标记段，找到"Exif\0\0"开头的APP1段，返回其中TIFF头的位置和长度
+ */
+bool findExifSegment(QIODevice *device, qint64 &tiffBase, qint64 &tiffLength)
+{
+    if (!device->seek(0)) {
+        return false;
+    }
+    uchar soi[2];
+    if (device->read(reinterpret_cast<char *>(soi), 2) != 2 || soi[0] != 0xFF || soi[1] != 0xD8) {
+        return false;
+    }
+
+    for (int i = 0; i < MAX_JPEG_SEGMENTS; ++i) {
+        uchar marker[2];
+        if (device->read(reinterpret_cast<char *>(marker), 2) != 2 || marker[0] != 0xFF) {
+            return false;
+        }
+        // 跳过填充字节
+        while (marker[1] == 0xFF) {
+            if (!device->getChar(reinterpret_cast<char *>(&marker[1]))) {
+                return false;
+            }
+        }
+        // 图像数据开始或结束，后续不会再有APP1段
+        if (marker[1] == 0xDA || marker[1] == 0xD9) {
+            return false;
+        }
+        // 无长度的独立标记
+        if (marker[1] == 0x01 || (marker[1] >= 0xD0 && marker[1] <= 0xD7)) {
+            continue;
+        }
+
+        uchar lengthData[2];
+        if (device->read(reinterpret_cast<char *>(lengthData), 2) != 2) {
+            return false;
+        }
+        const qint64 length = qFromBigEndian<quint16>(lengthData);
+        if (length < 2) {
+            return false;
+        }
+        const qint64 payloadPos = device->pos();
+        if (marker[1] == 0xE1 && length >= 2 + 6 + 8) {
+            const QByteArray signature = device->read(6);
+            if (signature == QByteArray("Exif\0\0", 6)) {
+                tiffBase = payloadPos + 6;
+                tiffLength = length - 2 - 6;
+                return true;
+            }
+        }
+        if (!device->seek(payloadPos + length - 2)) {
+            return false;
+        }
+    }
+    return false;
+}
+
+void applyIfdEntries(TiffReader &reader, const QVector<IfdEntry> &entries, ExifData &exif,
+                     quint32 &exifIfd, quint32 &jpegOffset, quint32 &jpegLength)
+{
+    for (const IfdEntry &entry : entries) {
+        quint32 value = 0;
+        if (!reader.value(entry, value)) {
+            continue;
+        }
+        switch (entry.tag) {
+        case TAG_ORIENTATION:
+            if (value >= 1 && value <= 8 && exif.orientationOffset < 0) {
+                exif.orientation = static_cast<int>(value);
+                exif.orientationOffset = reader.base() + entry.valueOffset;
+            }
+            break;
+        case TAG_EXIF_IFD:
+            exifIfd = value;
+            break;
+        case TAG_JPEG_OFFSET:
+            jpegOffset = value;
+            break;
+        case TAG_JPEG_LENGTH:
+            jpegLength = value;
+            break;
+        case TAG_PIXEL_X:
+            exif.pixelSize.setWidth(static_cast<int>(value));
+            break;
+        case TAG_PIXEL_Y:
+            exif.pixelSize.setHeight(static_cast<int>(value));
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool parseTiff(TiffReader &reader, ExifData &exif, bool loadThumbnail)
+{
+    quint32 ifdOffset = 0;
+    if (!reader.readHeader(ifdOffset)) {
+        return false;
+    }
+
+    quint32 exifIfd = 0;
+    quint32 jpegOffset = 0;
+    quint32 jpegLength = 0;
+    QSet<quint32> visited;
+    QVector<IfdEntry> entries;
+
+    exif.bigEndian = reader.isBigEndian();
+
+    // IFD0为主图信息，IFD1为缩略图信息，优先使用IFD1中的缩略图
+    for (int index = 0; index < 2 && ifdOffset != 0 && !visited.contains(ifdOffset); ++index) {
+        visited.insert(ifdOffset);
+        quint32 nextIfd = 0;
+        if (!reader.readIfd(ifdOffset, entries, nextIfd)) {
+            break;
+        }
+        applyIfdEntries(reader, entries, exif, exifIfd, jpegOffset, jpegLength);
+        if (index == 0 && nextIfd != 0) {
+            exif.ifd1LinkOffset = reader.base() + ifdOffset + 2 + entries.size() * 12;
+        }
+        ifdOffset = nextIfd;
+    }
+
+    if (exifIfd != 0 && !visited.contains(exifIfd)) {
+        quint32 nextIfd = 0;
+        quint32 unused = 0;
+        if (reader.readIfd(exifIfd, entries, nextIfd)) {
+            applyIfdEntries(reader, entries, exif, unused, unused, unused);
+        }
+    }
+
+    if (jpegOffset > 0 && jpegLength > 0
+            && static_cast<qint64>(jpegOffset) + jpegLength <= reader.length()) {
+        exif.thumbnailOffset = reader.base() + jpegOffset;
+        exif.thumbnailLength = jpegLength;
+    }
+
+    if (loadThumbnail && exif.hasThumbnail() && exif.thumbnailLength <= MAX_THUMBNAIL_LENGTH) {
+        exif.thumbnail.resize(static_cast<int>(exif.thumbnailLength));
+        uchar *data = reinterpret_cast<uchar *>(exif.thumbnail.data());
+        if (!reader.readAt(jpegOffset, data, exif.thumbnailLength) || !exif.thumbnail.startsWith("\xff\xd8")) {
+            exif.thumbnail.clear();
+        }
+    }
+    return true;
+}
+
+}
+
+UNIONIMAGESHARED_EXPORT bool readExifData(QIODevice *device, ExifData &exif, bool loadThumbnail)
+{
+    exif = ExifData();
+    if (!device || !device->isOpen() || device->isSequential()) {
+        return false;
+    }
+
+    const QByteArray magic = device->peek(4);
+    if (magic.startsWith("\xff\xd8")) {
+        qint64 tiffBase = 0;
+        qint64 tiffLength = 0;
+        if (!findExifSegment(device, tiffBase, tiffLength)) {
+            return false;
+        }
+        TiffReader reader(device, tiffBase, tiffLength);
+        return parseTiff(reader, exif, loadThumbnail);
+    }
+
+    if (magic == QByteArray("II\x2a\x00", 4) || magic == QByteArray("MM\x00\x2a", 4)) {
+        TiffReader reader(device, 0, device->size());
+        return parseTiff(reader, exif, loadThumbnail);
+    }
+    return false;
+}
+
+UNIONIMAGESHARED_EXPORT bool readExifData(const QString &path, ExifData &exif, bool loadThumbnail)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        exif = ExifData();
+        return false;
+    }
+    return readExifData(&file, exif, loadThumbnail);
+}
+
+UNIONIMAGESHARED_EXPORT bool resetExifOrientation(QByteArray &jpegData)
+{
+    ExifData exif;
+    {
+        QBuffer buffer(&jpegData);
+        if (!buffer.open(QIODevice::ReadOnly) || !readExifData(&buffer, exif)) {
+            return false;
+        }
+    }
+
+    uchar *data = reinterpret_cast<uchar *>(jpegData.data());
+    if (exif.orientationOffset >= 0 && exif.orientationOffset + 2 <= jpegData.size()) {
+        if (exif.bigEndian) {
+            qToBigEndian<quint16>(1, data + exif.orientationOffset);
+        } else {
+            qToLittleEndian<quint16>(1, data + exif.orientationOffset);
+        }
+    }
+    // 内嵌缩略图仍为旧方向，断开IFD1避免显示方向错误的预览
+    if (exif.ifd1LinkOffset >= 0 && exif.ifd1LinkOffset + 4 <= jpegData.size()) {
+        memset(data + exif.ifd1LinkOffset, 0, 4);
+    }
+    return true;
+}
+
+UNIONIMAGESHARED_EXPORT QImage loadExifThumbnail(const QString &path, ExifData *exif)
+{
+    ExifData data;
+    if (!readExifData(path, data, true) || data.thumbnail.isEmpty()) {
+        if (exif) {
+            *exif = data;
+        }
+        return QImage();
+    }
+
+    QImage image = QImage::fromData(data.thumbnail, "JPG");
+    if (!image.isNull()) {
+        // 内嵌缩略图与主图使用相同的EXIF方向
+        image = orientImage(image, data.orientation);
+    } else {
+        qWarning() << "Failed to decode embedded EXIF thumbnail:" << path;
+    }
+
+    if (exif) {
+        data.thumbnail.clear();
+        *exif = data;
+    }
+    return image;
+}
+
+};
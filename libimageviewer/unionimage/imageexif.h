@@ -0,0 +1,77 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef IMAGEEXIF_H
+#define IMAGEEXIF_H
+
+#include <QByteArray>
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+#include "unionimage.h"
+
+class QIODevice;
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief ExifData
+ * 从JPEG的APP1段或TIFF文件头的IFD中解析出的EXIF信息
+ */
+struct ExifData {
+    int orientation = 1;            // EXIF方向，1代表不做操作
+    QSize pixelSize;                // EXIF记录的原图尺寸，未记录时无效
+    qint64 thumbnailOffset = -1;    // 内嵌JPEG缩略图在文件中的偏移
+    qint64 thumbnailLength = 0;     // 内嵌JPEG缩略图长度
+    QByteArray thumbnail;           // 内嵌JPEG缩略图数据，仅在需要时读取
+    qint64 orientationOffset = -1;  // 方向值在文件中的偏移，用于回写
+    qint64 ifd1LinkOffset = -1;     // IFD0中指向IFD1(缩略图)的偏移字段在文件中的位置
+    bool bigEndian = false;         // TIFF头字节序
+
+    bool hasThumbnail() const { return thumbnailOffset >= 0 && thumbnailLength > 0; }
+};
+
+/**
+ * @brief readExifData
+ * @param[in]           device          已打开的文件设备，读取后位置不确定
+ * @param[out]          exif
+ * @param[in]           loadThumbnail   是否读取内嵌缩略图数据
+ * @return bool
+ * 解析JPEG(APP1 Exif)或TIFF类文件(包括DNG/NEF/CR2等)的IFD，不解码主图
+ * 文件不包含EXIF信息时返回false
+ */
+UNIONIMAGESHARED_EXPORT bool readExifData(QIODevice *device, ExifData &exif, bool loadThumbnail = false);
+
+/**
+ * @brief readExifData
+ * @param[in]           path
+ * @param[out]          exif
+ * @param[in]           loadThumbnail
+ * @return bool
+ * 打开文件并解析EXIF信息
+ */
+UNIONIMAGESHARED_EXPORT bool readExifData(const QString &path, ExifData &exif, bool loadThumbnail = false);
+
+/**
+ * @brief resetExifOrientation
+ * @param[in][out]      jpegData        完整的JPEG文件数据
+ * @return bool
+ * 像素已按方向校正后，将EXIF方向改写为1，并断开与主图不再一致的内嵌缩略图(IFD1)
+ * 数据中没有EXIF信息时返回false
+ */
+UNIONIMAGESHARED_EXPORT bool resetExifOrientation(QByteArray &jpegData);
+
+/**
+ * @brief loadExifThumbnail
+ * @param[in]           path
+ * @param[out]          exif            可选，返回解析到的EXIF信息
+ * @return QImage
+ * 读取图片内嵌的EXIF缩略图，并按EXIF方向校正，不存在时返回空图
+ */
+UNIONIMAGESHARED_EXPORT QImage loadExifThumbnail(const QString &path, ExifData *exif = nullptr);
+
+};
+
+#endif // IMAGEEXIF_H
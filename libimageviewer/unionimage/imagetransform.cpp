@@ -0,0 +1,701 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "imagetransform.h"
+#include "imageexif.h"
+#include "service/taskscheduler.h"
+
+#include <QFile>
+#include <QSaveFile>
+#include <QTransform>
+#include <QThread>
+#include <QVector>
+#include <QPair>
+#include <QDebug>
+
+#include <cstring>
+
+#if defined(__GNUC__) && defined(__x86_64__)
+#include <immintrin.h>
+#define IMAGETRANSFORM_X86
+#elif defined(__GNUC__) && defined(__aarch64__)
+#include <arm_neon.h>
+#define IMAGETRANSFORM_NEON
+#endif
+
+#ifdef USE_TURBOJPEG
+#include <turbojpeg.h>
+#endif
+
+namespace LibUnionImage_NameSpace {
+
+namespace {
+
+// 分块转置的块边长(像素)，源块与目标块均可保留在L1缓存中
+const int TRANSPOSE_BLOCK = 32;
+// 超过该像素数的图像按行带拆分到线程池并行处理
+const qint64 PARALLEL_PIXEL_THRESHOLD = 2048 * 2048;
+// 并行处理时的最大分带数
+const int MAX_PARALLEL_BANDS = 16;
+
+struct Pixel24 {
+    uchar c[3];
+};
+
+struct Pixel128 {
+    quint64 c[2];
+};
+
+// EXIF方向对应的2x2变换矩阵(以图像中心为原点，y轴向下)，dst = M * src
+const int ORIENTATION_MATRIX[8][4] = {
+    { 1,  0,  0,  1},   // 1 不做操作
+    {-1,  0,  0,  1},   // 2 水平翻转
+    {-1,  0,  0, -1},   // 3 旋转180度
+    { 1,  0,  0, -1},   // 4 垂直翻转
+    { 0,  1,  1,  0},   // 5 转置
+    { 0, -1,  1,  0},   // 6 顺时针90度
+    { 0, -1, -1,  0},   // 7 反转置
+    { 0,  1, -1,  0},   // 8 逆时针90度
+};
+
+bool isTransposed(int orientation)
+{
+    return orientation >= 5 && orientation <= 8;
+}
+
+/**
+ * @brief TransposeTileFunc
+ * 32位像素的转置微内核：从src起读取N行(行距srcStep，可为负以逆序读取)，
+ * 每行N个像素，转置后写入dst起的N行(行距dstStep，可为负)
+ */
+typedef void (*TransposeTileFunc)(const uchar *src, qsizetype srcStep, uchar *dst, qsizetype dstStep);
+
+/**
+ * @brief ReverseRowFunc
+ * 32位像素的行内逆序：dst[w - 1 - x] = src[x]
+ */
+typedef void (*ReverseRowFunc)(const quint32 *src, quint32 *dst, int w);
+
+struct Kernel32 {
+    TransformKernel kernel;
+    int tileSize;                       // 转置微内核的边长，0代表无SIMD转置
+    TransposeTileFunc transposeTile;
+    ReverseRowFunc reverseRow;
+};
+
+void reverseRowScalar(const quint32 *src, quint32 *dst, int w)
+{
+    for (int x = 0; x < w; ++x) {
+        dst[w - 1 - x] = src[x];
+    }
+}
+
+#ifdef IMAGETRANSFORM_X86
+// x86_64必定支持SSE2，无需运行时检测
+void transposeTileSse2(const uchar *src, qsizetype srcStep, uchar *dst, qsizetype dstStep)
+{
+    const __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src));
+    const __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + srcStep));
+    const __m128i r2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 2 * srcStep));
+    const __m128i r3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + 3 * srcStep));
+
+    const __m128i t0 = _mm_unpacklo_epi32(r0, r1);
+    const __m128i t1 = _mm_unpackhi_epi32(r0, r1);
+    const __m128i t2 = _mm_unpacklo_epi32(r2, r3);
+    const __m128i t3 = _mm_unpackhi_epi32(r2, r3);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst), _mm_unpacklo_epi64(t0, t2));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + dstStep), _mm_unpackhi_epi64(t0, t2));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * dstStep), _mm_unpacklo_epi64(t1, t3));
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 3 * dstStep), _mm_unpackhi_epi64(t1, t3));
+}
+
+void reverseRowSse2(const quint32 *src, quint32 *dst, int w)
+{
+    int x = 0;
+    for (; x + 4 <= w; x += 4) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + x));
+        v = _mm_shuffle_epi32(v, _MM_SHUFFLE(0, 1, 2, 3));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + w - x - 4), v);
+    }
+    for (; x < w; ++x) {
+        dst[w - 1 - x] = src[x];
+    }
+}
+
+__attribute__((target("avx2")))
+void transposeTileAvx2(const uchar *src, qsizetype srcStep, uchar *dst, qsizetype dstStep)
+{
+    __m256i r[8];
+    for (int i = 0; i < 8; ++i) {
+        r[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i * srcStep));
+    }
+
+    const __m256i t0 = _mm256_unpacklo_epi32(r[0], r[1]);
+    const __m256i t1 = _mm256_unpackhi_epi32(r[0], r[1]);
+    const __m256i t2 = _mm256_unpacklo_epi32(r[2], r[3]);
+    const __m256i t3 = _mm256_unpackhi_epi32(r[2], r[3]);
+    const __m256i t4 = _mm256_unpacklo_epi32(r[4], r[5]);
+    const __m256i t5 = _mm256_unpackhi_epi32(r[4], r[5]);
+    const __m256i t6 = _mm256_unpacklo_epi32(r[6], r[7]);
+    const __m256i t7 = _mm256_unpackhi_epi32(r[6], r[7]);
+
+    const __m256i u0 = _mm256_unpacklo_epi64(t0, t2);
+    const __m256i u1 = _mm256_unpackhi_epi64(t0, t2);
+    const __m256i u2 = _mm256_unpacklo_epi64(t1, t3);
+    const __m256i u3 = _mm256_unpackhi_epi64(t1, t3);
+    const __m256i u4 = _mm256_unpacklo_epi64(t4, t6);
+    const __m256i u5 = _mm256_unpackhi_epi64(t4, t6);
+    const __m256i u6 = _mm256_unpacklo_epi64(t5, t7);
+    const __m256i u7 = _mm256_unpackhi_epi64(t5, t7);
+
+    // 每个128位通道内已完成4x4转置，最后交换上下两个通道
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute2x128_si256(u0, u4, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + dstStep), _mm256_permute2x128_si256(u1, u5, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 2 * dstStep), _mm256_permute2x128_si256(u2, u6, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 3 * dstStep), _mm256_permute2x128_si256(u3, u7, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 4 * dstStep), _mm256_permute2x128_si256(u0, u4, 0x31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 5 * dstStep), _mm256_permute2x128_si256(u1, u5, 0x31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 6 * dstStep), _mm256_permute2x128_si256(u2, u6, 0x31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 7 * dstStep), _mm256_permute2x128_si256(u3, u7, 0x31));
+}
+
+__attribute__((target("avx2")))
+void reverseRowAvx2(const quint32 *src, quint32 *dst, int w)
+{
+    const __m256i index = _mm256_setr_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    int x = 0;
+    for (; x + 8 <= w; x += 8) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + x));
+        v = _mm256_permutevar8x32_epi32(v, index);
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + w - x - 8), v);
+    }
+    for (; x < w; ++x) {
+        dst[w - 1 - x] = src[x];
+    }
+}
+
+bool cpuSupportsAvx2()
+{
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+#endif
+
+#ifdef IMAGETRANSFORM_NEON
+// aarch64必定支持NEON，无需运行时检测
+void transposeTileNeon(const uchar *src, qsizetype srcStep, uchar *dst, qsizetype dstStep)
+{
+    const uint32x4_t r0 = vld1q_u32(reinterpret_cast<const uint32_t *>(src));
+    const uint32x4_t r1 = vld1q_u32(reinterpret_cast<const uint32_t *>(src + srcStep));
+    const uint32x4_t r2 = vld1q_u32(reinterpret_cast<const uint32_t *>(src + 2 * srcStep));
+    const uint32x4_t r3 = vld1q_u32(reinterpret_cast<const uint32_t *>(src + 3 * srcStep));
+
+    const uint32x4x2_t t01 = vtrnq_u32(r0, r1);
+    const uint32x4x2_t t23 = vtrnq_u32(r2, r3);
+
+    vst1q_u32(reinterpret_cast<uint32_t *>(dst), vcombine_u32(vget_low_u32(t01.val[0]), vget_low_u32(t23.val[0])));
+    vst1q_u32(reinterpret_cast<uint32_t *>(dst + dstStep), vcombine_u32(vget_low_u32(t01.val[1]), vget_low_u32(t23.val[1])));
+    vst1q_u32(reinterpret_cast<uint32_t *>(dst + 2 * dstStep), vcombine_u32(vget_high_u32(t01.val[0]), vget_high_u32(t23.val[0])));
+    vst1q_u32(reinterpret_cast<uint32_t *>(dst + 3 * dstStep), vcombine_u32(vget_high_u32(t01.val[1]), vget_high_u32(t23.val[1])));
+}
+
+void reverseRowNeon(const quint32 *src, quint32 *dst, int w)
+{
+    int x = 0;
+    for (; x + 4 <= w; x += 4) {
+        uint32x4_t v = vld1q_u32(reinterpret_cast<const uint32_t *>(src + x));
+        v = vrev64q_u32(v);
+        v = vextq_u32(v, v, 2);
+        vst1q_u32(reinterpret_cast<uint32_t *>(dst + w - x - 4), v);
+    }
+    for (; x < w; ++x) {
+        dst[w - 1 - x] = src[x];
+    }
+}
+#endif
+
+/**
+ * @brief kernel32
+ * 选择32位像素使用的内核，请求的内核当前CPU不支持时返回nullptr
+ */
+const Kernel32 *kernel32(TransformKernel kernel)
+{
+    static const Kernel32 s_scalar = {TransformKernelScalar, 0, nullptr, reverseRowScalar};
+#if defined(IMAGETRANSFORM_X86)
+    static const Kernel32 s_sse2 = {TransformKernelSSE2, 4, transposeTileSse2, reverseRowSse2};
+    static const Kernel32 s_avx2 = {TransformKernelAVX2, 8, transposeTileAvx2, reverseRowAvx2};
+    static const bool s_hasAvx2 = cpuSupportsAvx2();
+    switch (kernel) {
+    case TransformKernelAuto:
+        return s_hasAvx2 ? &s_avx2 : &s_sse2;
+    case TransformKernelScalar:
+        return &s_scalar;
+    case TransformKernelSSE2:
+        return &s_sse2;
+    case TransformKernelAVX2:
+        return s_hasAvx2 ? &s_avx2 : nullptr;
+    default:
+        return nullptr;
+    }
+#elif defined(IMAGETRANSFORM_NEON)
+    static const Kernel32 s_neon = {TransformKernelNEON, 4, transposeTileNeon, reverseRowNeon};
+    switch (kernel) {
+    case TransformKernelAuto:
+    case TransformKernelNEON:
+        return &s_neon;
+    case TransformKernelScalar:
+        return &s_scalar;
+    default:
+        return nullptr;
+    }
+#else
+    return (kernel == TransformKernelAuto || kernel == TransformKernelScalar) ? &s_scalar : nullptr;
+#endif
+}
+
+/**
+ * @brief mirrorRows
+ * 方向2/3/4，处理源图像[y0, y1)行，按行复制，需要时行内逆序
+ */
+template <typename Pixel>
+void mirrorRows(const QImage &src, QImage &dst, int orientation, int y0, int y1, const Kernel32 *)
+{
+    const int w = src.width();
+    const int h = src.height();
+    const bool reverseRow = (orientation == 2 || orientation == 3);
+    const bool reverseCol = (orientation == 3 || orientation == 4);
+
+    for (int y = y0; y < y1; ++y) {
+        const Pixel *s = reinterpret_cast<const Pixel *>(src.constScanLine(y));
+        Pixel *d = reinterpret_cast<Pixel *>(dst.scanLine(reverseCol ? h - 1 - y : y));
+        if (reverseRow) {
+            for (int x = 0; x < w; ++x) {
+                d[w - 1 - x] = s[x];
+            }
+        } else {
+            memcpy(d, s, static_cast<size_t>(w) * sizeof(Pixel));
+        }
+    }
+}
+
+template <>
+void mirrorRows<quint32>(const QImage &src, QImage &dst, int orientation, int y0, int y1, const Kernel32 *kernel)
+{
+    const int w = src.width();
+    const int h = src.height();
+    const bool reverseRow = (orientation == 2 || orientation == 3);
+    const bool reverseCol = (orientation == 3 || orientation == 4);
+
+    for (int y = y0; y < y1; ++y) {
+        const quint32 *s = reinterpret_cast<const quint32 *>(src.constScanLine(y));
+        quint32 *d = reinterpret_cast<quint32 *>(dst.scanLine(reverseCol ? h - 1 - y : y));
+        if (reverseRow) {
+            kernel->reverseRow(s, d, w);
+        } else {
+            memcpy(d, s, static_cast<size_t>(w) * sizeof(quint32));
+        }
+    }
+}
+
+/**
+ * @brief transposePixels
+ * 逐像素转置源图像[sy0, sy1) x [sx0, sx1)区域，源行号对应目标列号，源列号对应目标行号
+ */
+template <typename Pixel>
+inline void transposePixels(const uchar *srcBits, qsizetype srcStride, uchar *dstBits, qsizetype dstStride,
+                            int w, int h, bool reverseDstX, bool reverseDstY,
+                            int sy0, int sy1, int sx0, int sx1)
+{
+    for (int sy = sy0; sy < sy1; ++sy) {
+        const Pixel *s = reinterpret_cast<const Pixel *>(srcBits + sy * srcStride);
+        const int dx = reverseDstX ? h - 1 - sy : sy;
+        for (int sx = sx0; sx < sx1; ++sx) {
+            const int dy = reverseDstY ? w - 1 - sx : sx;
+            reinterpret_cast<Pixel *>(dstBits + dy * dstStride)[dx] = s[sx];
+        }
+    }
+}
+
+/**
+ * @brief transposeBlocked
+ * 方向5/6/7/8，处理源图像[y0, y1)行，按块遍历源图像，源行连续读取，目标列在块内写入
+ */
+template <typename Pixel>
+void transposeBlocked(const QImage &src, QImage &dst, int orientation, int y0, int y1, const Kernel32 *)
+{
+    const int w = src.width();
+    const int h = src.height();
+    const uchar *srcBits = src.constBits();
+    uchar *dstBits = dst.bits();
+    const qsizetype srcStride = src.bytesPerLine();
+    const qsizetype dstStride = dst.bytesPerLine();
+    const bool reverseDstX = (orientation == 6 || orientation == 7);
+    const bool reverseDstY = (orientation == 7 || orientation == 8);
+
+    for (int by = y0; by < y1; by += TRANSPOSE_BLOCK) {
+        const int ey = qMin(by + TRANSPOSE_BLOCK, y1);
+        for (int bx = 0; bx < w; bx += TRANSPOSE_BLOCK) {
+            const int ex = qMin(bx + TRANSPOSE_BLOCK, w);
+            transposePixels<Pixel>(srcBits, srcStride, dstBits, dstStride, w, h,
+                                   reverseDstX, reverseDstY, by, ey, bx, ex);
+        }
+    }
+}
+
+/**
+ * @brief transposeBlocked<quint32>
+ * 32位像素在每个块内再按SIMD微内核转置，块内不足微内核边长的边缘逐像素处理
+ * 目标列需要逆序时从微内核最后一行开始以负行距读取，目标行需要逆序时以负行距写入
+ */
+template <>
+void transposeBlocked<quint32>(const QImage &src, QImage &dst, int orientation, int y0, int y1, const Kernel32 *kernel)
+{
+    const int w = src.width();
+    const int h = src.height();
+    const uchar *srcBits = src.constBits();
+    uchar *dstBits = dst.bits();
+    const qsizetype srcStride = src.bytesPerLine();
+    const qsizetype dstStride = dst.bytesPerLine();
+    const bool reverseDstX = (orientation == 6 || orientation == 7);
+    const bool reverseDstY = (orientation == 7 || orientation == 8);
+    const int tile = kernel->tileSize;
+
+    for (int by = y0; by < y1; by += TRANSPOSE_BLOCK) {
+        const int ey = qMin(by + TRANSPOSE_BLOCK, y1);
+        for (int bx = 0; bx < w; bx += TRANSPOSE_BLOCK) {
+            const int ex = qMin(bx + TRANSPOSE_BLOCK, w);
+            int sy = by;
+            if (tile > 0) {
+                for (; sy + tile <= ey; sy += tile) {
+                    const int firstRow = reverseDstX ? sy + tile - 1 : sy;
+                    const int dx = reverseDstX ? h - sy - tile : sy;
+                    int sx = bx;
+                    for (; sx + tile <= ex; sx += tile) {
+                        const int dy = reverseDstY ? w - 1 - sx : sx;
+                        kernel->transposeTile(srcBits + firstRow * srcStride + sx * 4,
+                                              reverseDstX ? -srcStride : srcStride,
+                                              dstBits + dy * dstStride + dx * 4,
+                                              reverseDstY ? -dstStride : dstStride);
+                    }
+                    transposePixels<quint32>(srcBits, srcStride, dstBits, dstStride, w, h,
+                                             reverseDstX, reverseDstY, sy, sy + tile, sx, ex);
+                }
+            }
+            transposePixels<quint32>(srcBits, srcStride, dstBits, dstStride, w, h,
+                                     reverseDstX, reverseDstY, sy, ey, bx, ex);
+        }
+    }
+}
+
+/**
+ * @brief orientPixels
+ * 大图按源图像行带拆分并行处理，行带边界与转置块对齐，各行带写入的目标区域互不重叠
+ */
+template <typename Pixel>
+void orientPixels(const QImage &src, QImage &dst, int orientation, const Kernel32 *kernel)
+{
+    const bool transposed = isTransposed(orientation);
+    auto process = [&](int y0, int y1) {
+        if (transposed) {
+            transposeBlocked<Pixel>(src, dst, orientation, y0, y1, kernel);
+        } else {
+            mirrorRows<Pixel>(src, dst, orientation, y0, y1, kernel);
+        }
+    };
+
+    const int h = src.height();
+    const qint64 pixels = static_cast<qint64>(src.width()) * h;
+    const int bands = pixels >= PARALLEL_PIXEL_THRESHOLD
+                      ? qBound(1, QThread::idealThreadCount(), MAX_PARALLEL_BANDS) : 1;
+    if (bands <= 1) {
+        process(0, h);
+        return;
+    }
+
+    const int bandRows = ((h + bands - 1) / bands + TRANSPOSE_BLOCK - 1) / TRANSPOSE_BLOCK * TRANSPOSE_BLOCK;
+    QVector<QPair<int, int>> ranges;
+    for (int y = 0; y < h; y += bandRows) {
+        ranges.append(qMakePair(y, qMin(y + bandRows, h)));
+    }
+    LibTaskScheduler::instance()->parallelFor(ranges.size(), [&process, &ranges](int index) {
+        process(ranges.at(index).first, ranges.at(index).second);
+    });
+}
+
+/**
+ * @brief orientFallback
+ * 位深度小于8的图像(单色等)按像素寻址不便，使用Qt的正交变换处理
+ */
+QImage orientFallback(const QImage &image, int orientation)
+{
+    QTransform transform;
+    switch (orientation) {
+    case 2:
+        return image.mirrored(true, false);
+    case 3:
+        return image.mirrored(true, true);
+    case 4:
+        return image.mirrored(false, true);
+    case 5:
+        transform.rotate(90);
+        return image.transformed(transform, Qt::FastTransformation).mirrored(true, false);
+    case 6:
+        transform.rotate(90);
+        return image.transformed(transform, Qt::FastTransformation);
+    case 7:
+        transform.rotate(90);
+        return image.transformed(transform, Qt::FastTransformation).mirrored(false, true);
+    case 8:
+        transform.rotate(270);
+        return image.transformed(transform, Qt::FastTransformation);
+    default:
+        return image;
+    }
+}
+
+}
+
+UNIONIMAGESHARED_EXPORT bool isTransformKernelSupported(TransformKernel kernel)
+{
+    return kernel32(kernel) != nullptr;
+}
+
+UNIONIMAGESHARED_EXPORT QImage orientImage(const QImage &image, int orientation, TransformKernel kernel)
+{
+    if (image.isNull() || orientation <= 1 || orientation > 8) {
+        return image;
+    }
+
+    const Kernel32 *kernel32Impl = kernel32(kernel);
+    if (!kernel32Impl) {
+        qWarning() << "Unsupported transform kernel:" << kernel << ", use scalar kernel instead";
+        kernel32Impl = kernel32(TransformKernelScalar);
+    }
+
+    const bool transposed = isTransposed(orientation);
+    QImage dst(transposed ? image.height() : image.width(),
+               transposed ? image.width() : image.height(),
+               image.format());
+    if (dst.isNull()) {
+        qWarning() << "Failed to allocate image for orientation:" << orientation << image.size();
+        return QImage();
+    }
+
+    switch (image.depth()) {
+    case 8:
+        orientPixels<quint8>(image, dst, orientation, kernel32Impl);
+        break;
+    case 16:
+        orientPixels<quint16>(image, dst, orientation, kernel32Impl);
+        break;
+    case 24:
+        orientPixels<Pixel24>(image, dst, orientation, kernel32Impl);
+        break;
+    case 32:
+        orientPixels<quint32>(image, dst, orientation, kernel32Impl);
+        break;
+    case 64:
+        orientPixels<quint64>(image, dst, orientation, kernel32Impl);
+        break;
+    case 128:
+        orientPixels<Pixel128>(image, dst, orientation, kernel32Impl);
+        break;
+    default:
+        return orientFallback(image, orientation);
+    }
+
+    dst.setColorTable(image.colorTable());
+    dst.setDevicePixelRatio(image.devicePixelRatio());
+    dst.setDotsPerMeterX(transposed ? image.dotsPerMeterY() : image.dotsPerMeterX());
+    dst.setDotsPerMeterY(transposed ? image.dotsPerMeterX() : image.dotsPerMeterY());
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    dst.setColorSpace(image.colorSpace());
+#endif
+    return dst;
+}
+
+UNIONIMAGESHARED_EXPORT int angleToOrientation(int angle)
+{
+    if (angle % 90 != 0) {
+        return 1;
+    }
+    switch (((angle % 360) + 360) % 360) {
+    case 90:
+        return 6;
+    case 180:
+        return 3;
+    case 270:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+UNIONIMAGESHARED_EXPORT QImage rotateImageOrthogonal(const QImage &image, int angle)
+{
+    if (angle % 90 != 0) {
+        qWarning() << "Unsupported orthogonal rotation angle:" << angle;
+        return QImage();
+    }
+    return orientImage(image, angleToOrientation(angle));
+}
+
+UNIONIMAGESHARED_EXPORT int orientationAfterRotation(int orientation, int angle)
+{
+    if (orientation < 1 || orientation > 8) {
+        orientation = 1;
+    }
+    const int *m = ORIENTATION_MATRIX[orientation - 1];
+    const int *r = ORIENTATION_MATRIX[angleToOrientation(angle) - 1];
+    // 先校正方向再旋转: R * M
+    const int res[4] = {
+        r[0] * m[0] + r[1] * m[2], r[0] * m[1] + r[1] * m[3],
+        r[2] * m[0] + r[3] * m[2], r[2] * m[1] + r[3] * m[3],
+    };
+    for (int i = 0; i < 8; ++i) {
+        if (memcmp(ORIENTATION_MATRIX[i], res, sizeof(res)) == 0) {
+            return i + 1;
+        }
+    }
+    return 1;
+}
+
+UNIONIMAGESHARED_EXPORT QImage halveImage(const QImage &image)
+{
+    if (image.isNull()) {
+        return QImage();
+    }
+    // 预乘格式下各通道可直接取平均
+    const QImage::Format format = image.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied : QImage::Format_RGB32;
+    const QImage src = image.format() == format ? image : image.convertToFormat(format);
+    const int w = src.width();
+    const int h = src.height();
+    QImage dst(qMax(1, w / 2), qMax(1, h / 2), format);
+    if (dst.isNull()) {
+        qWarning() << "Failed to allocate halved image:" << image.size();
+        return QImage();
+    }
+
+    // 奇数边的最后一行/列并入最后一个输出像素，该处按3x2、2x3或3x3取平均
+    const auto average = [&src](int x0, int x1, int y0, int y1) {
+        quint32 sum[4] = {0, 0, 0, 0};
+        const quint32 count = static_cast<quint32>((x1 - x0) * (y1 - y0));
+        for (int y = y0; y < y1; ++y) {
+            const quint32 *row = reinterpret_cast<const quint32 *>(src.constScanLine(y));
+            for (int x = x0; x < x1; ++x) {
+                for (int c = 0; c < 4; ++c) {
+                    sum[c] += (row[x] >> (8 * c)) & 0xff;
+                }
+            }
+        }
+        quint32 result = 0;
+        for (int c = 0; c < 4; ++c) {
+            result |= ((sum[c] + count / 2) / count) << (8 * c);
+        }
+        return result;
+    };
+
+    const int dw = dst.width();
+    const int dh = dst.height();
+    // 宽为偶数时所有列都是2x2块，可以走快速路径
+    const int evenColumns = 0 == w % 2 ? dw : dw - 1;
+    for (int y = 0; y < dh; ++y) {
+        const int y0 = 2 * y;
+        const int y1 = y == dh - 1 ? h : y0 + 2;
+        quint32 *out = reinterpret_cast<quint32 *>(dst.scanLine(y));
+        if (y1 - y0 == 2) {
+            const quint32 *row0 = reinterpret_cast<const quint32 *>(src.constScanLine(y0));
+            const quint32 *row1 = reinterpret_cast<const quint32 *>(src.constScanLine(y0 + 1));
+            for (int x = 0; x < evenColumns; ++x) {
+                const quint32 p[4] = {row0[2 * x], row0[2 * x + 1], row1[2 * x], row1[2 * x + 1]};
+                // 两个通道一组并行累加，每个通道有8位余量，不会溢出
+                quint32 rb = 0x00020002;
+                quint32 ag = 0x00020002;
+                for (quint32 pixel : p) {
+                    rb += pixel & 0x00ff00ff;
+                    ag += (pixel >> 8) & 0x00ff00ff;
+                }
+                out[x] = ((rb >> 2) & 0x00ff00ff) | (((ag >> 2) & 0x00ff00ff) << 8);
+            }
+            if (evenColumns < dw) {
+                out[dw - 1] = average(2 * (dw - 1), w, y0, y1);
+            }
+        } else {
+            for (int x = 0; x < dw; ++x) {
+                out[x] = average(2 * x, x == dw - 1 ? w : 2 * x + 2, y0, y1);
+            }
+        }
+    }
+
+    dst.setDevicePixelRatio(image.devicePixelRatio());
+    return dst;
+}
+
+UNIONIMAGESHARED_EXPORT bool transformJpegFileLossless(const QString &path, int orientation, QString &errorMsg)
+{
+#ifdef USE_TURBOJPEG
+    if (orientation < 1 || orientation > 8) {
+        errorMsg = "invalid orientation";
+        return false;
+    }
+    // 与EXIF方向1~8一一对应的DCT域变换
+    static const int s_transformOps[8] = {
+        TJXOP_NONE, TJXOP_HFLIP, TJXOP_ROT180, TJXOP_VFLIP,
+        TJXOP_TRANSPOSE, TJXOP_ROT90, TJXOP_TRANSVERSE, TJXOP_ROT270
+    };
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        errorMsg = "open file failed, path:" + path;
+        return false;
+    }
+    const QByteArray source = file.readAll();
+    file.close();
+
+    tjhandle handle = tjInitTransform();
+    if (!handle) {
+        errorMsg = "init jpeg transform failed";
+        return false;
+    }
+
+    tjtransform transform;
+    memset(&transform, 0, sizeof(transform));
+    transform.op = s_transformOps[orientation - 1];
+    transform.options = TJXOPT_TRIM;
+
+    unsigned char *destBuf = nullptr;
+    unsigned long destSize = 0;
+    const int ret = tjTransform(handle, reinterpret_cast<const unsigned char *>(source.constData()),
+                                static_cast<unsigned long>(source.size()), 1, &destBuf, &destSize, &transform, 0);
+    if (ret != 0) {
+        errorMsg = QString("lossless jpeg transform failed: ") + tjGetErrorStr2(handle);
+        tjFree(destBuf);
+        tjDestroy(handle);
+        return false;
+    }
+    QByteArray result(reinterpret_cast<const char *>(destBuf), static_cast<int>(destSize));
+    tjFree(destBuf);
+    tjDestroy(handle);
+
+    // 标记段原样复制，像素已按方向校正，需要将方向改写为1
+    resetExifOrientation(result);
+
+    QSaveFile saveFile(path);
+    if (!saveFile.open(QIODevice::WriteOnly)
+            || saveFile.write(result) != result.size()
+            || !saveFile.commit()) {
+        errorMsg = "write file failed, path:" + path;
+        return false;
+    }
+    return true;
+#else
+    Q_UNUSED(path);
+    Q_UNUSED(orientation);
+    errorMsg = "lossless jpeg transform is not supported";
+    return false;
+#endif
+}
+
+};
@@ -0,0 +1,96 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef IMAGETRANSFORM_H
+#define IMAGETRANSFORM_H
+
+#include <QImage>
+
+#include "unionimage.h"
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief TransformKernel
+ * 正交变换使用的32位像素内核，默认按运行时CPU特性自动选择
+ */
+enum TransformKernel {
+    TransformKernelAuto = 0,
+    TransformKernelScalar,
+    TransformKernelSSE2,
+    TransformKernelAVX2,
+    TransformKernelNEON,
+};
+
+/**
+ * @brief isTransformKernelSupported
+ * @param[in]           kernel
+ * @return bool
+ * 当前平台及CPU是否支持指定的变换内核
+ */
+UNIONIMAGESHARED_EXPORT bool isTransformKernelSupported(TransformKernel kernel);
+
+/**
+ * @brief orientImage
+ * @param[in]           image
+ * @param[in]           orientation     EXIF方向(1~8)
+ * @param[in]           kernel          32位像素使用的内核，不支持时退回标量实现
+ * @return QImage
+ * 按EXIF方向对图片做正交变换(镜像/90度旋转/转置)，按像素直接搬移到目标图像，不做插值
+ * 旋转类方向使用分块转置以保持缓存局部性，32位像素块内再用SSE2/AVX2/NEON微内核转置，
+ * 大图按行带拆分到线程池并行处理，方向为1或无效时返回原图(共享数据)
+ */
+UNIONIMAGESHARED_EXPORT QImage orientImage(const QImage &image, int orientation,
+                                           TransformKernel kernel = TransformKernelAuto);
+
+/**
+ * @brief rotateImageOrthogonal
+ * @param[in]           image
+ * @param[in]           angle           顺时针旋转角度，需为90的倍数
+ * @return QImage
+ * 正交旋转图片，角度不为90的倍数时返回空图
+ */
+UNIONIMAGESHARED_EXPORT QImage rotateImageOrthogonal(const QImage &image, int angle);
+
+/**
+ * @brief orientationAfterRotation
+ * @param[in]           orientation     EXIF方向(1~8)
+ * @param[in]           angle           顺时针旋转角度，需为90的倍数
+ * @return int
+ * 计算先按orientation校正再顺时针旋转angle后等价的EXIF方向，用于合并为一次变换
+ */
+UNIONIMAGESHARED_EXPORT int orientationAfterRotation(int orientation, int angle);
+
+/**
+ * @brief angleToOrientation
+ * @param[in]           angle           顺时针旋转角度，需为90的倍数
+ * @return int
+ * 将顺时针旋转角度转换为等价的EXIF方向，角度不为90的倍数时返回1
+ */
+UNIONIMAGESHARED_EXPORT int angleToOrientation(int angle);
+
+/**
+ * @brief halveImage
+ * @param[in]           image
+ * @return QImage
+ * 2x2盒式滤波将图片宽高各缩小一半(不小于1)，用于生成缩小显示的多级图片，
+ * 结果为RGB32或ARGB32_Premultiplied格式，奇数边的最后一行/列并入最后一个输出像素一起取平均
+ */
+UNIONIMAGESHARED_EXPORT QImage halveImage(const QImage &image);
+
+/**
+ * @brief transformJpegFileLossless
+ * @param[in]           path
+ * @param[in]           orientation     需要应用到像素上的EXIF方向(1~8)
+ * @param[out]          errorMsg
+ * @return bool
+ * 在DCT域对JPEG文件做无损正交变换(同jpegtran -trim，裁去无法无损变换的边缘不完整MCU)，
+ * 保留EXIF/ICC等元数据段，并将EXIF方向改写为1
+ * 未启用libturbojpeg或变换失败时返回false，调用方需回退到解码后重新编码
+ */
+UNIONIMAGESHARED_EXPORT bool transformJpegFileLossless(const QString &path, int orientation, QString &errorMsg);
+
+};
+
+#endif // IMAGETRANSFORM_H
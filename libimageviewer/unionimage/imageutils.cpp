@@ -22,6 +22,7 @@
 #include <QPixmapCache>
 #include <QProcess>
 #include <QReadWriteLock>
+#include <QSaveFile>
 #include <QUrl>
 #include <QApplication>
 #include <QTemporaryDir>
@@ -38,46 +39,20 @@ const QImage scaleImage(const QString &path, const QSize &size)
         qWarning() << "Image format not supported for reading:" << path;
         return QImage();
     }
-    QImageReader reader(path);
-    reader.setAutoTransform(true);
-    if (! reader.canRead()) {
-        qWarning() << "Cannot read image:" << path;
+
+    // 按目标尺寸缩小解码，不支持缩小解码的格式在内存中缩放，不再经过临时文件中转
+    QImage tImg;
+    QString errMsg;
+    if (!LibUnionImage_NameSpace::loadStaticImageFromFile(path, tImg, errMsg, "", size)) {
+        qWarning() << "Failed to read scaled image:" << path << errMsg;
         return QImage();
     }
 
-    QSize tSize = reader.size();
-    if (! tSize.isValid()) {
-        qDebug() << "Image size not valid, trying to get from metadata";
-        QStringList rl = getAllMetaData(path).value("Dimension").split("x");
-        if (rl.length() == 2) {
-            tSize = QSize(QString(rl.first()).toInt(),
-                          QString(rl.last()).toInt());
-        }
-    }
-    tSize.scale(size, Qt::KeepAspectRatio);
-    reader.setScaledSize(tSize);
-    QImage tImg = reader.read();
-    // Some format does not support scaling
     if (tImg.width() > size.width() || tImg.height() > size.height()) {
-        if (tImg.isNull()) {
-            qWarning() << "Failed to read scaled image:" << path;
-            return QImage();
-        } else {
-            qDebug() << "Image format does not support scaling, converting to PNG";
-            // Save as supported format and scale it again
-            const QString tmp = QDir::tempPath() + "/scale_tmp_image.png";
-            QFile::remove(tmp);
-            if (tImg.save(tmp, "png", 50)) {
-                return scaleImage(tmp, size);
-            } else {
-                qWarning() << "Failed to save temporary PNG for scaling:" << path;
-                return QImage();
-            }
-        }
-    } else {
-        qDebug() << "Successfully scaled image:" << path;
-        return tImg;
+        tImg = tImg.scaled(size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
     }
+    qDebug() << "Successfully scaled image:" << path;
+    return tImg;
 }
 
 const QDateTime getCreateDateTime(const QString &path)
@@ -524,11 +499,11 @@ QMap<QString, QString> thumbnailAttribute(const QUrl  &url)
     QMap<QString, QString> set;
 
     if (url.isLocalFile()) {
-        const QString path = url.path();
+        const QString path = url.toLocalFile();
         QFileInfo info(path);
         set.insert("Thumb::Mimetype", QMimeDatabase().mimeTypeForFile(path).name());
         set.insert("Thumb::Size", QString::number(info.size()));
-        set.insert("Thumb::URI", url.toString());
+        set.insert("Thumb::URI", url.toString(QUrl::FullyEncoded));
         set.insert("Thumb::MTime", QString::number(info.lastModified().toSecsSinceEpoch()));
         set.insert("Software", "Deepin Image Viewer");
 
@@ -544,70 +519,125 @@ QMap<QString, QString> thumbnailAttribute(const QUrl  &url)
     return set;
 }
 
-const QString thumbnailCachePath()
+// 缩略图缓存目录及读写锁，目录只在第一次使用时确定
+static QReadWriteLock s_ThumbnailCachePathLock;
+static QString s_ThumbnailCachePath;
+
+/**
+   @brief 创建缩略图缓存目录下各尺寸的子目录
+ */
+static void makeThumbnailCacheDirs(const QString &path)
 {
-    qDebug() << "Getting thumbnail cache path";
-    QString cacheP;
+    QDir().mkpath(path + "/normal");
+    QDir().mkpath(path + "/large");
+    QDir().mkpath(path + "/fail");
+}
 
-    QStringList systemEnvs = QProcess::systemEnvironment();
-    for (QString it : systemEnvs) {
-        QStringList el = it.split("=");
-        if (el.length() == 2 && el.first() == "XDG_CACHE_HOME") {
-            cacheP = el.last();
-            break;
+/**
+   @brief 取得缩略图缓存目录，第一次调用时按XDG_CACHE_HOME确定路径并创建目录
+   @threadsafe
+ */
+const QString thumbnailCachePath()
+{
+    {
+        QReadLocker locker(&s_ThumbnailCachePathLock);
+        if (!s_ThumbnailCachePath.isEmpty()) {
+            return s_ThumbnailCachePath;
         }
     }
-    cacheP = cacheP.isEmpty() ? (QDir::homePath() + "/.cache") : cacheP;
 
-    // Check specific size dir
-    const QString thumbCacheP = cacheP + "/thumbnails";
-    QDir().mkpath(thumbCacheP + "/normal");
-    QDir().mkpath(thumbCacheP + "/large");
-    QDir().mkpath(thumbCacheP + "/fail");
+    QWriteLocker locker(&s_ThumbnailCachePathLock);
+    if (s_ThumbnailCachePath.isEmpty()) {
+        QString cacheP = QString::fromLocal8Bit(qgetenv("XDG_CACHE_HOME"));
+        cacheP = cacheP.isEmpty() ? (QDir::homePath() + "/.cache") : cacheP;
 
-    return thumbCacheP;
+        // Check specific size dir
+        const QString path = cacheP + "/thumbnails";
+        makeThumbnailCacheDirs(path);
+        qDebug() << "Thumbnail cache path:" << path;
+        s_ThumbnailCachePath = path;
+    }
+    return s_ThumbnailCachePath;
 }
 
-QMutex mutex;
-const QPixmap getThumbnail(const QString &path, bool cacheOnly)
+/**
+   @brief 替换缩略图缓存目录，传入空字符串时下次使用重新按XDG_CACHE_HOME确定，供测试隔离使用
+   @threadsafe
+ */
+void setThumbnailCachePath(const QString &path)
 {
-    qDebug() << "Getting thumbnail for:" << path << "cacheOnly:" << cacheOnly;
-    QMutexLocker locker(&mutex);
-    //优先读取自身缓存的图片
-//    if (dApp->m_imagemap.value(path).isNull()) {
-//        return dApp->m_imagemap.value(path);
-//    }
-    const QString cacheP = thumbnailCachePath();
-    const QUrl url = QUrl::fromLocalFile(path);
-    const QString md5s = toMd5(url.toString(QUrl::FullyEncoded).toLocal8Bit());
-    const QString encodePath = cacheP + "/large/" + md5s + ".png";
-    const QString failEncodePath = cacheP + "/fail/" + md5s + ".png";
-    if (QFileInfo(encodePath).exists()) {
-        return QPixmap(encodePath);
-    }
-    else if (QFileInfo(failEncodePath).exists()) {
-        qDebug() << "Fail-thumbnail exist, won't regenerate: " ;
-        return QPixmap();
-    } else {
-        // Try to generate thumbnail and load it later
-        if (! cacheOnly && generateThumbnail(path)) {
-            return QPixmap(encodePath);
-        } else {
-            return QPixmap();
-        }
+    QWriteLocker locker(&s_ThumbnailCachePathLock);
+    if (!path.isEmpty()) {
+        makeThumbnailCacheDirs(path);
     }
+    s_ThumbnailCachePath = path;
 }
 
-/*!
- * \brief generateThumbnail
- * Generate and save thumbnail for specific size
- * \return
+namespace {
+
+// 写缩略图的锁按文件名分片，读取无需加锁
+const int THUMBNAIL_WRITE_SHARDS = 16;
+
+// 缩略图文件名，按freedesktop规范为完整编码的URI的MD5
+QString thumbnailName(const QUrl &url)
+{
+    return QCryptographicHash::hash(url.toString(QUrl::FullyEncoded).toUtf8(), QCryptographicHash::Md5).toHex();
+}
+
+QMutex *thumbnailWriteLock(const QString &name)
+{
+    static QMutex locks[THUMBNAIL_WRITE_SHARDS];
+    return &locks[qHash(name) % THUMBNAIL_WRITE_SHARDS];
+}
+
+qint64 thumbnailMTime(const QString &path)
+{
+    return QFileInfo(path).lastModified().toSecsSinceEpoch();
+}
+
+/**
+ * @brief readThumbnailFile
+ * 按freedesktop缩略图规范校验Thumb::URI与Thumb::MTime，只读取PNG头部的文本块，校验通过后才解码像素
+ * 文件管理器等其他程序生成的缩略图同样适用，原图修改后的旧缩略图视为不存在
+ * @param[out]          image   为空指针时只做校验
  */
-bool generateThumbnail(const QString &path)
+bool readThumbnailFile(const QString &thumbnailFile, const QUrl &url, qint64 mtime, QImage *image)
+{
+    QImageReader reader(thumbnailFile, "png");
+    if (!reader.canRead()) {
+        return false;
+    }
+    const QString uri = reader.text("Thumb::URI");
+    const QString mtimeText = reader.text("Thumb::MTime");
+    if (QUrl(uri).toString(QUrl::FullyEncoded) != url.toString(QUrl::FullyEncoded)
+            || mtimeText.isEmpty() || mtimeText.toLongLong() != mtime) {
+        qDebug() << "Stale thumbnail ignored:" << thumbnailFile;
+        return false;
+    }
+    if (image) {
+        *image = reader.read();
+        return !image->isNull();
+    }
+    return true;
+}
+
+// 先写入临时文件再重命名，并发读取的一方不会读到写了一半的缩略图
+bool saveThumbnailFile(const QImage &image, const QString &thumbnailFile)
+{
+    QSaveFile file(thumbnailFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    if (!image.save(&file, "png", 50)) {
+        file.cancelWriting();
+        return false;
+    }
+    return file.commit();
+}
+
+// 调用者需持有该缩略图的分片写锁
+bool writeThumbnails(const QString &path, const QUrl &url, const QString &name)
 {
-    qDebug() << "Generating thumbnail for:" << path;
-    const QUrl url = QUrl::fromLocalFile(path);
-    const QString md5 = toMd5(url.toString(QUrl::FullyEncoded).toLocal8Bit());
     const auto attributes = thumbnailAttribute(url);
     const QString cacheP = thumbnailCachePath();
 
@@ -624,23 +654,26 @@ bool generateThumbnail(const QString &path)
     // Create filed thumbnail
     if (lImg.isNull() || nImg.isNull()) {
         qWarning() << "Failed to generate thumbnail images for:" << path;
-        const QString failedP = cacheP + "/fail/" + md5 + ".png";
+        const QString failedP = cacheP + "/fail/" + name + ".png";
         QImage img(1, 1, QImage::Format_ARGB32_Premultiplied);
+        img.fill(Qt::transparent);
         const auto keys = attributes.keys();
         for (QString key : keys) {
             img.setText(key, attributes[key]);
         }
 
+        // 记录失败，原图未修改前不再重复尝试解码
         qDebug() << "Saving failed thumbnail:" << failedP;
+        saveThumbnailFile(img, failedP);
         return false;
     } else {
         for (QString key : attributes.keys()) {
             lImg.setText(key, attributes[key]);
             nImg.setText(key, attributes[key]);
         }
-        const QString largeP = cacheP + "/large/" + md5 + ".png";
-        const QString normalP = cacheP + "/normal/" + md5 + ".png";
-        if (lImg.save(largeP, "png", 50) && nImg.save(normalP, "png", 50)) {
+        const QString largeP = cacheP + "/large/" + name + ".png";
+        const QString normalP = cacheP + "/normal/" + name + ".png";
+        if (saveThumbnailFile(lImg, largeP) && saveThumbnailFile(nImg, normalP)) {
             qDebug() << "Successfully generated thumbnails for:" << path;
             return true;
         } else {
@@ -650,11 +683,66 @@ bool generateThumbnail(const QString &path)
     }
 }
 
-const QString thumbnailPath(const QString &path, ThumbnailType type)
+}
+
+const QImage cachedThumbnail(const QString &path, ThumbnailType type)
+{
+    const QUrl url = QUrl::fromLocalFile(path);
+    QImage image;
+    if (readThumbnailFile(thumbnailPath(path, type), url, thumbnailMTime(path), &image)) {
+        return image;
+    }
+    return QImage();
+}
+
+const QPixmap getThumbnail(const QString &path, bool cacheOnly)
 {
+    qDebug() << "Getting thumbnail for:" << path << "cacheOnly:" << cacheOnly;
     const QString cacheP = thumbnailCachePath();
     const QUrl url = QUrl::fromLocalFile(path);
-    const QString md5s = toMd5(url.toString(QUrl::FullyEncoded).toLocal8Bit());
+    const QString md5s = thumbnailName(url);
+    const qint64 mtime = thumbnailMTime(path);
+    const QString encodePath = cacheP + "/large/" + md5s + ".png";
+    const QString failEncodePath = cacheP + "/fail/" + md5s + ".png";
+
+    QImage image;
+    if (readThumbnailFile(encodePath, url, mtime, &image)) {
+        return QPixmap::fromImage(image);
+    } else if (readThumbnailFile(failEncodePath, url, mtime, nullptr)) {
+        qDebug() << "Fail-thumbnail exist, won't regenerate: " ;
+        return QPixmap();
+    } else if (cacheOnly) {
+        return QPixmap();
+    }
+
+    // Try to generate thumbnail and load it later
+    QMutexLocker locker(thumbnailWriteLock(md5s));
+    // 等待锁期间其他线程可能已生成
+    if (!readThumbnailFile(encodePath, url, mtime, &image)
+            && writeThumbnails(path, url, md5s)) {
+        readThumbnailFile(encodePath, url, mtime, &image);
+    }
+    return image.isNull() ? QPixmap() : QPixmap::fromImage(image);
+}
+
+/*!
+ * \brief generateThumbnail
+ * Generate and save thumbnail for specific size
+ * \return
+ */
+bool generateThumbnail(const QString &path)
+{
+    qDebug() << "Generating thumbnail for:" << path;
+    const QUrl url = QUrl::fromLocalFile(path);
+    const QString md5 = thumbnailName(url);
+    QMutexLocker locker(thumbnailWriteLock(md5));
+    return writeThumbnails(path, url, md5);
+}
+
+const QString thumbnailPath(const QString &path, ThumbnailType type)
+{
+    const QString cacheP = thumbnailCachePath();
+    const QString md5s = thumbnailName(QUrl::fromLocalFile(path));
     QString tp;
     switch (type) {
     case ThumbNormal:
@@ -53,8 +53,12 @@ const QImage                        scaleImage(const QString &path,
 bool                                generateThumbnail(const QString &path);
 const QPixmap                       getThumbnail(const QString &path,
                                                  bool cacheOnly = false);
+// 读取freedesktop缓存中与原图匹配(Thumb::URI、Thumb::MTime)的缩略图，不加锁，不存在或已过期时返回空图
+const QImage                        cachedThumbnail(const QString &path, ThumbnailType type = ThumbLarge);
 void                                removeThumbnail(const QString &path);
 const QString                       thumbnailCachePath();
+// 替换缩略图缓存目录，空字符串恢复按XDG_CACHE_HOME确定的默认目录
+void                                setThumbnailCachePath(const QString &path);
 const QString                       thumbnailPath(const QString &path, ThumbnailType type = ThumbLarge);
 bool                                thumbnailExist(const QString &path, ThumbnailType type = ThumbLarge);
 
@@ -18,6 +18,7 @@
 #include "pluginbaseutils.h"
 #include "imageengine.h"
 #include "imageutils.h"
+#include "service/thumbnailpack.h"
 
 
 LibImgOperate::LibImgOperate(QObject *parent)
@@ -34,6 +35,8 @@ LibImgOperate::~LibImgOperate()
 void LibImgOperate::slotMakeImgThumbnail(QString thumbnailSavePath, QStringList paths, int makeCount, bool remake)
 {
     qDebug() << "Starting thumbnail generation for" << paths.size() << "images, makeCount:" << makeCount << "remake:" << remake;
+    // 缩略图统一保存在LibThumbnailPack的持久化存储中，不再按路径单独保存文件
+    Q_UNUSED(thumbnailSavePath);
     QString path;
     imageViewerSpace::ItemInfo itemInfo;
     QImage tImg;
@@ -52,35 +55,31 @@ void LibImgOperate::slotMakeImgThumbnail(QString thumbnailSavePath, QStringList
         itemInfo.pathType = getPathType(path);
         qDebug() << "Path type:" << itemInfo.pathType;
 
-        //获取原图分辨率
-        QImageReader imagreader(path);
-        itemInfo.imgOriginalWidth = imagreader.size().width();
-        itemInfo.imgOriginalHeight = imagreader.size().height();
-        qDebug() << "Original image size:" << itemInfo.imgOriginalWidth << "x" << itemInfo.imgOriginalHeight;
-
-        //缩略图保存路径
-        QString savePath = thumbnailSavePath + path;
-        //保存为jpg格式
-        savePath = thumbnailSavePath.mid(0, savePath.lastIndexOf('.')) + ImageEngine::instance()->makeMD5(path) + ".png";
-        QFileInfo file(savePath);
-        //缩略图已存在，执行下一个路径
-        if (file.exists() && !remake && itemInfo.imgOriginalWidth > 0 && itemInfo.imgOriginalHeight > 0) {
-            qDebug() << "Using existing thumbnail:" << savePath;
-            tImg = QImage(savePath);
-            itemInfo.image = tImg;
-            //获取图片类型
-            itemInfo.imageType = getImageType(path);
+        //缩略图已存在，执行下一个路径，未命中时保留已计算的文件身份供写入复用
+        LibUnionImage_NameSpace::FileIdentity identity;
+        if (!remake && LibThumbnailPack::instance()->find(path, itemInfo, &identity)
+                && itemInfo.imgOriginalWidth > 0 && itemInfo.imgOriginalHeight > 0) {
+            qDebug() << "Using existing thumbnail from pack:" << path;
             emit sigOneImgReady(path, itemInfo);
             continue;
         }
 
+        //获取原图分辨率
+        const LibUnionImage_NameSpace::ImageProbeInfo probeInfo = LibUnionImage_NameSpace::probeImage(path);
+        itemInfo.imgOriginalWidth = probeInfo.displaySize().width();
+        itemInfo.imgOriginalHeight = probeInfo.displaySize().height();
+        qDebug() << "Original image size:" << itemInfo.imgOriginalWidth << "x" << itemInfo.imgOriginalHeight;
+
         QString errMsg;
-        if (!LibUnionImage_NameSpace::loadStaticImageFromFile(path, tImg, errMsg)) {
+        // 按缩略图尺寸缩小解码，避免大图全分辨率解码
+        if (!LibUnionImage_NameSpace::loadStaticImageFromFile(path, tImg, errMsg, probeInfo, QSize(200, 200))) {
             qWarning() << "Failed to load image:" << path << "Error:" << errMsg;
             continue;
         }
-        itemInfo.imgOriginalWidth = tImg.width();
-        itemInfo.imgOriginalHeight = tImg.height();
+        if (!probeInfo.size.isValid()) {
+            itemInfo.imgOriginalWidth = tImg.width();
+            itemInfo.imgOriginalHeight = tImg.height();
+        }
         qDebug() << "Loaded image size:" << itemInfo.imgOriginalWidth << "x" << itemInfo.imgOriginalHeight;
 
         if (0 != tImg.height() && 0 != tImg.width() && (tImg.height() / tImg.width()) < 10 && (tImg.width() / tImg.height()) < 10) {
@@ -104,25 +103,18 @@ void LibImgOperate::slotMakeImgThumbnail(QString thumbnailSavePath, QStringList
             qDebug() << "Scaled thumbnail size:" << tImg.width() << "x" << tImg.height();
         }
 
-        //创建路径
-        QString dirPath = savePath.mid(0, savePath.lastIndexOf('/'));
-        qDebug() << "Creating directory for thumbnail:" << dirPath;
-        pluginUtils::base::mkMutiDir(dirPath);
-        
-        if (tImg.save(savePath)) {
-            qDebug() << "Successfully saved thumbnail:" << savePath;
-            itemInfo.image = tImg;
-        } else {
-            qWarning() << "Failed to save thumbnail:" << savePath;
-        }
-
+        itemInfo.image = tImg;
         if (itemInfo.image.isNull()) {
             qWarning() << "Generated thumbnail is null for:" << path;
             itemInfo.imageType = imageViewerSpace::ImageTypeDamaged;
         } else {
             //获取图片类型
-            itemInfo.imageType = getImageType(path);
+            itemInfo.imageType = probeInfo.imageType;
             qDebug() << "Image type:" << itemInfo.imageType;
+            // 缩略图写入持久化存储，下次启动直接读取
+            if (!LibThumbnailPack::instance()->insert(path, itemInfo, identity)) {
+                qWarning() << "Failed to save thumbnail to pack:" << path;
+            }
         }
         emit sigOneImgReady(path, itemInfo);
     }
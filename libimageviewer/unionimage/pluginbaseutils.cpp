@@ -4,6 +4,7 @@
 
 #include "pluginbaseutils.h"
 #include "unionimage.h"
+#include "snifferimageformat.h"
 #include "image-viewer_global.h"
 #include "service/commonservice.h"
 
@@ -205,25 +206,22 @@ bool checkMimeData(const QMimeData *mimeData)
             }
         } else {
             QFileInfo info(path);
-            QMimeDatabase db;
-            QMimeType mt = db.mimeTypeForFile(info.filePath(), QMimeDatabase::MatchContent);
-            QMimeType mt1 = db.mimeTypeForFile(info.filePath(), QMimeDatabase::MatchExtension);
             QString str = info.suffix().toLower();
-            qDebug() << "File suffix:" << str << "MIME type (content):" << mt.name() << "MIME type (extension):" << mt1.name();
-            
+            qDebug() << "File suffix:" << str;
+
             if (str.isEmpty()) {
-                if (mt.name().startsWith("image/") || mt.name().startsWith("video/x-mng")) {
-                    if (supportedImageFormats().contains(str, Qt::CaseInsensitive)) {
-                        qDebug() << "Empty suffix but supported format found";
-                        result = true;
-                        break;
-                    } else if (str.isEmpty()) {
-                        qDebug() << "Empty suffix but valid image MIME type";
-                        result = true;
-                        break;
-                    }
+                // 无后缀时读取文件头嗅探格式
+                const QString format = DetectImageFormat(info.filePath());
+                qDebug() << "Sniffed format:" << format;
+                if (!format.isEmpty()) {
+                    qDebug() << "Empty suffix but valid image format";
+                    result = true;
+                    break;
                 }
             } else {
+                QMimeDatabase db;
+                QMimeType mt1 = db.mimeTypeForFile(info.filePath(), QMimeDatabase::MatchExtension);
+                qDebug() << "MIME type (extension):" << mt1.name();
                 if (mt1.name().startsWith("image/") || mt1.name().startsWith("video/x-mng")) {
                     qDebug() << "Valid image format with extension";
                     result = true;
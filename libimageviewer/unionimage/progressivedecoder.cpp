@@ -0,0 +1,461 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "progressivedecoder.h"
+#include "imagetransform.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMap>
+#include <QPainter>
+#include <QDebug>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+#include <QColorSpace>
+#endif
+
+#include <csetjmp>
+#include <cstdio>
+#include <cstring>
+
+#ifdef USE_LIBJPEG
+#include <jpeglib.h>
+#endif
+
+#ifdef USE_LIBPNG
+#include <png.h>
+#endif
+
+namespace LibUnionImage_NameSpace {
+
+namespace {
+
+// 顺序解码时每解码若干行检查一次是否需要输出中间结果
+const int BAND_ROWS = 64;
+
+// 与Qt插件一致，图片内嵌ICC配置时设置对应的色彩空间
+void setIccProfile(QImage &image, const QByteArray &iccProfile)
+{
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    if (!iccProfile.isEmpty()) {
+        image.setColorSpace(QColorSpace::fromIccProfile(iccProfile));
+    }
+#else
+    Q_UNUSED(image)
+    Q_UNUSED(iccProfile)
+#endif
+}
+
+/**
+ * @brief The ProgressEmitter class
+ * 按最小间隔输出中间结果，只缩放已解码的行，代价与预览尺寸成正比
+ */
+class ProgressEmitter
+{
+public:
+    ProgressEmitter(const ProgressiveOptions &options, const ProgressiveCallback &callback, int orientation)
+        : m_options(options)
+        , m_callback(callback)
+        , m_orientation(orientation)
+    {
+        m_timer.start();
+    }
+
+    bool isDue() const
+    {
+        return m_timer.elapsed() >= m_options.updateInterval;
+    }
+
+    // 回调要求中止或取消标记被取消
+    bool isAborted() const
+    {
+        return m_aborted || isCancelled();
+    }
+
+    bool isCancelled() const
+    {
+        return isDecodeCancelled(m_options.cancelToken);
+    }
+
+    // canvas的前decodedRows行已解码，返回false表示调用方要求中止
+    bool update(const QImage &canvas, int decodedRows)
+    {
+        if (isAborted() || !m_callback || !isDue() || decodedRows <= 0) {
+            return !isAborted();
+        }
+
+        const QSize displaySize = m_orientation >= 5 ? canvas.size().transposed() : canvas.size();
+        QSize previewSize = displaySize;
+        if (m_options.previewSize.isValid()
+                && (displaySize.width() > m_options.previewSize.width() || displaySize.height() > m_options.previewSize.height())) {
+            previewSize = displaySize.scaled(m_options.previewSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+        }
+        if (m_orientation >= 5) {
+            previewSize.transpose();
+        }
+
+        QImage preview(previewSize, QImage::Format_ARGB32_Premultiplied);
+        preview.fill(Qt::transparent);
+        const int previewRows = qMin(previewSize.height(), qRound(qreal(decodedRows) * previewSize.height() / canvas.height()));
+        if (previewRows > 0) {
+            // 只包装已解码的行，不拷贝原图数据
+            const QImage decoded(canvas.constScanLine(0), canvas.width(), decodedRows, canvas.bytesPerLine(), canvas.format());
+            QPainter painter(&preview);
+            painter.drawImage(0, 0, decoded.scaled(previewSize.width(), previewRows, Qt::IgnoreAspectRatio, Qt::FastTransformation));
+        }
+
+        m_aborted = !m_callback(orientImage(preview, m_orientation));
+        m_timer.restart();
+        return !m_aborted;
+    }
+
+private:
+    ProgressiveOptions m_options;
+    ProgressiveCallback m_callback;
+    int m_orientation;
+    QElapsedTimer m_timer;
+    bool m_aborted = false;
+};
+
+#ifdef USE_LIBJPEG
+struct JpegErrorManager {
+    jpeg_error_mgr pub;
+    jmp_buf setjmpBuffer;
+};
+
+void jpegErrorExit(j_common_ptr cinfo)
+{
+    JpegErrorManager *manager = reinterpret_cast<JpegErrorManager *>(cinfo->err);
+    char buffer[JMSG_LENGTH_MAX];
+    (*cinfo->err->format_message)(cinfo, buffer);
+    qWarning() << "libjpeg error:" << buffer;
+    longjmp(manager->setjmpBuffer, 1);
+}
+
+void jpegOutputMessage(j_common_ptr)
+{
+}
+
+/**
+ * @brief readJpegIccProfile
+ * ICC配置按"ICC_PROFILE"标识的APP2段分块保存，按序号拼接，需在读取文件头前保存APP2段
+ */
+QByteArray readJpegIccProfile(jpeg_decompress_struct *cinfo)
+{
+    static const char ICC_SIGNATURE[] = "ICC_PROFILE";
+    const unsigned int headerSize = sizeof(ICC_SIGNATURE) + 2;
+    QMap<int, QByteArray> chunks;
+    for (jpeg_saved_marker_ptr marker = cinfo->marker_list; marker; marker = marker->next) {
+        if (marker->marker != JPEG_APP0 + 2 || marker->data_length <= headerSize
+                || memcmp(marker->data, ICC_SIGNATURE, sizeof(ICC_SIGNATURE)) != 0) {
+            continue;
+        }
+        chunks.insert(marker->data[sizeof(ICC_SIGNATURE)],
+                      QByteArray(reinterpret_cast<const char *>(marker->data + headerSize),
+                                 static_cast<int>(marker->data_length - headerSize)));
+    }
+    QByteArray profile;
+    for (const QByteArray &chunk : chunks) {
+        profile.append(chunk);
+    }
+    return profile;
+}
+
+void readJpegRows(jpeg_decompress_struct *cinfo, QImage &image, const ProgressEmitter &emitter)
+{
+    while (cinfo->output_scanline < cinfo->output_height) {
+        JSAMPROW row = image.scanLine(static_cast<int>(cinfo->output_scanline));
+        jpeg_read_scanlines(cinfo, &row, 1);
+        if (cinfo->output_scanline % BAND_ROWS == 0 && emitter.isAborted()) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief decodeJpeg
+ * 顺序JPEG按行带输出；渐进式JPEG使用缓冲图像模式，每到输出间隔时把已读入的扫描输出为一遍完整图像
+ * 图像在函数外构造，出错时longjmp不会跳过其析构
+ */
+bool decodeJpeg(FILE *file, QImage &image, QString &errorMsg, ProgressEmitter &emitter)
+{
+    jpeg_decompress_struct cinfo;
+    JpegErrorManager jerr;
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = jpegErrorExit;
+    jerr.pub.output_message = jpegOutputMessage;
+    if (setjmp(jerr.setjmpBuffer)) {
+        jpeg_destroy_decompress(&cinfo);
+        errorMsg = "decode jpeg failed";
+        return false;
+    }
+
+    jpeg_create_decompress(&cinfo);
+    jpeg_stdio_src(&cinfo, file);
+    jpeg_save_markers(&cinfo, JPEG_APP0 + 2, 0xFFFF);
+    jpeg_read_header(&cinfo, TRUE);
+
+    // 输出格式与Qt插件一致：灰度为Grayscale8，彩色为RGB32；CMYK等色彩空间交给Qt插件处理
+    QImage::Format format = QImage::Format_Invalid;
+    if (cinfo.jpeg_color_space == JCS_GRAYSCALE) {
+        cinfo.out_color_space = JCS_GRAYSCALE;
+        format = QImage::Format_Grayscale8;
+    } else if (cinfo.jpeg_color_space == JCS_YCbCr || cinfo.jpeg_color_space == JCS_RGB) {
+#ifdef JCS_EXTENSIONS
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        cinfo.out_color_space = JCS_EXT_BGRX;
+#else
+        cinfo.out_color_space = JCS_EXT_XRGB;
+#endif
+        format = QImage::Format_RGB32;
+#else
+        // 不支持扩展色彩空间时按RGB888解码，结束后再转换
+        cinfo.out_color_space = JCS_RGB;
+        format = QImage::Format_RGB888;
+#endif
+    } else {
+        jpeg_destroy_decompress(&cinfo);
+        errorMsg = "unsupported jpeg color space";
+        return false;
+    }
+
+    const bool progressive = jpeg_has_multiple_scans(&cinfo);
+    cinfo.buffered_image = progressive ? TRUE : FALSE;
+    jpeg_start_decompress(&cinfo);
+    image = QImage(static_cast<int>(cinfo.output_width), static_cast<int>(cinfo.output_height), format);
+    if (image.isNull()) {
+        jpeg_destroy_decompress(&cinfo);
+        errorMsg = "failed to allocate image";
+        return false;
+    }
+
+    const int height = static_cast<int>(cinfo.output_height);
+    if (!progressive) {
+        while (cinfo.output_scanline < cinfo.output_height) {
+            JSAMPROW row = image.scanLine(static_cast<int>(cinfo.output_scanline));
+            jpeg_read_scanlines(&cinfo, &row, 1);
+            if (cinfo.output_scanline % BAND_ROWS == 0 && !emitter.update(image, static_cast<int>(cinfo.output_scanline))) {
+                break;
+            }
+        }
+    } else {
+        bool finalPass = false;
+        while (!finalPass && !emitter.isAborted()) {
+            int status = 0;
+            do {
+                status = jpeg_consume_input(&cinfo);
+            } while (status != JPEG_SCAN_COMPLETED && status != JPEG_REACHED_EOI && status != JPEG_SUSPENDED);
+            finalPass = jpeg_input_complete(&cinfo);
+            // 每遍输出都要做完整的反变换，未到输出间隔的扫描只读入不输出
+            if (!finalPass && !emitter.isDue()) {
+                continue;
+            }
+            jpeg_start_output(&cinfo, cinfo.input_scan_number);
+            readJpegRows(&cinfo, image, emitter);
+            if (emitter.isAborted()) {
+                break;
+            }
+            jpeg_finish_output(&cinfo);
+            if (!finalPass) {
+                emitter.update(image, height);
+            }
+        }
+    }
+
+    const QByteArray iccProfile = emitter.isAborted() ? QByteArray() : readJpegIccProfile(&cinfo);
+    if (emitter.isAborted()) {
+        jpeg_abort_decompress(&cinfo);
+    } else {
+        jpeg_finish_decompress(&cinfo);
+    }
+    jpeg_destroy_decompress(&cinfo);
+    if (emitter.isAborted()) {
+        return false;
+    }
+    if (image.format() != QImage::Format_Grayscale8 && image.format() != QImage::Format_RGB32) {
+        image = image.convertToFormat(QImage::Format_RGB32);
+    }
+    setIccProfile(image, iccProfile);
+    return true;
+}
+#endif
+
+#ifdef USE_LIBPNG
+/**
+ * @brief decodePng
+ * 非隔行PNG按行带输出；隔行PNG每遍以块填充(rectangle)方式写入，每遍结束时输出
+ * 只处理8位RGB/RGBA和不透明的8位灰度图，输出格式与Qt插件一致(RGB32/ARGB32/Grayscale8)
+ * 16位、调色板、低位深或带透明的灰度图，以及只有gAMA/cHRM色彩信息的图片返回false交给Qt插件
+ */
+bool decodePng(FILE *file, QImage &image, QString &errorMsg, ProgressEmitter &emitter)
+{
+    png_structp png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    png_infop info = png ? png_create_info_struct(png) : nullptr;
+    if (!info) {
+        png_destroy_read_struct(&png, nullptr, nullptr);
+        errorMsg = "failed to create png reader";
+        return false;
+    }
+    if (setjmp(png_jmpbuf(png))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        errorMsg = "decode png failed";
+        return false;
+    }
+
+    png_init_io(png, file);
+    png_read_info(png, info);
+    const png_byte colorType = png_get_color_type(png, info);
+    const bool hasTrns = png_get_valid(png, info, PNG_INFO_tRNS);
+    const bool gray = PNG_COLOR_TYPE_GRAY == colorType;
+    if (8 != png_get_bit_depth(png, info) || (gray && hasTrns)
+            || (!gray && PNG_COLOR_TYPE_RGB != colorType && PNG_COLOR_TYPE_RGB_ALPHA != colorType)) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        errorMsg = "png pixel format handled by qt";
+        return false;
+    }
+
+    // 色彩空间与Qt插件一致：优先使用ICC配置，其次为sRGB标记，只有gAMA/cHRM时交给Qt插件计算
+    QByteArray iccProfile;
+    png_charp iccName = nullptr;
+    int compression = 0;
+    png_bytep iccData = nullptr;
+    png_uint_32 iccLength = 0;
+    int intent = 0;
+    if (png_get_iCCP(png, info, &iccName, &compression, &iccData, &iccLength)) {
+        iccProfile = QByteArray(reinterpret_cast<const char *>(iccData), static_cast<int>(iccLength));
+    }
+    const bool srgb = png_get_sRGB(png, info, &intent);
+    if (iccProfile.isEmpty() && !srgb
+            && (png_get_valid(png, info, PNG_INFO_gAMA) || png_get_valid(png, info, PNG_INFO_cHRM))) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        errorMsg = "png color space handled by qt";
+        return false;
+    }
+
+    QImage::Format format = QImage::Format_Grayscale8;
+    if (!gray) {
+        const bool hasAlpha = (colorType & PNG_COLOR_MASK_ALPHA) || hasTrns;
+        if (hasTrns) {
+            png_set_tRNS_to_alpha(png);
+        }
+        // RGB32/ARGB32按32位整数存储，小端序下字节顺序为BGRA
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        png_set_bgr(png);
+        if (!hasAlpha) {
+            png_set_filler(png, 0xff, PNG_FILLER_AFTER);
+        }
+#else
+        if (hasAlpha) {
+            png_set_swap_alpha(png);
+        } else {
+            png_set_filler(png, 0xff, PNG_FILLER_BEFORE);
+        }
+#endif
+        format = hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+    }
+    const int passes = png_set_interlace_handling(png);
+    png_read_update_info(png, info);
+
+    image = QImage(static_cast<int>(png_get_image_width(png, info)), static_cast<int>(png_get_image_height(png, info)),
+                   format);
+    if (image.isNull()) {
+        png_destroy_read_struct(&png, &info, nullptr);
+        errorMsg = "failed to allocate image";
+        return false;
+    }
+
+    const int height = image.height();
+    if (passes <= 1) {
+        for (int y = 0; y < height; ++y) {
+            png_read_row(png, image.scanLine(y), nullptr);
+            if ((y + 1) % BAND_ROWS == 0 && !emitter.update(image, y + 1)) {
+                break;
+            }
+        }
+    } else {
+        for (int pass = 0; pass < passes && !emitter.isAborted(); ++pass) {
+            for (int y = 0; y < height; ++y) {
+                png_read_row(png, nullptr, image.scanLine(y));
+                if ((y + 1) % BAND_ROWS == 0 && emitter.isAborted()) {
+                    break;
+                }
+            }
+            if (pass + 1 < passes) {
+                emitter.update(image, height);
+            }
+        }
+    }
+
+    if (!emitter.isAborted()) {
+        png_read_end(png, nullptr);
+    }
+    png_destroy_read_struct(&png, &info, nullptr);
+    if (emitter.isAborted()) {
+        return false;
+    }
+    if (iccProfile.isEmpty() && srgb) {
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        image.setColorSpace(QColorSpace::SRgb);
+#endif
+    }
+    setIccProfile(image, iccProfile);
+    return true;
+}
+#endif
+
+}
+
+UNIONIMAGESHARED_EXPORT bool loadStaticImageProgressive(const QString &path, QImage &res, QString &errorMsg,
+                                                        const ProgressiveOptions &options,
+                                                        const ProgressiveCallback &callback)
+{
+    const ImageProbeInfo probeInfo = probeImage(path);
+    const QString format = probeInfo.readFormat().toUpper();
+    const qint64 pixels = static_cast<qint64>(probeInfo.size.width()) * probeInfo.size.height();
+    // 既不需要中间结果也不需要中途取消时直接整体解码
+    if ((!callback && !options.cancelToken) || pixels < options.minPixels || probeInfo.frameCount > 1) {
+        return loadStaticImageFromFile(path, res, errorMsg, probeInfo, QSize(), options.cancelToken);
+    }
+
+    typedef bool (*Decoder)(FILE *, QImage &, QString &, ProgressEmitter &);
+    Decoder decoder = nullptr;
+#ifdef USE_LIBJPEG
+    if (format == "JPG" || format == "JPEG") {
+        decoder = decodeJpeg;
+    }
+#endif
+#ifdef USE_LIBPNG
+    if (format == "PNG") {
+        decoder = decodePng;
+    }
+#endif
+    if (!decoder) {
+        return loadStaticImageFromFile(path, res, errorMsg, probeInfo, QSize(), options.cancelToken);
+    }
+
+    FILE *file = fopen(QFile::encodeName(path).constData(), "rb");
+    if (!file) {
+        errorMsg = "open file failed, path:" + path;
+        return false;
+    }
+    ProgressEmitter emitter(options, callback, probeInfo.orientation);
+    QImage image;
+    const bool ok = decoder(file, image, errorMsg, emitter);
+    fclose(file);
+
+    if (emitter.isAborted()) {
+        errorMsg = emitter.isCancelled() ? "decode cancelled" : "progressive decode aborted";
+        return false;
+    }
+    if (!ok) {
+        qWarning() << "Progressive decode failed, fall back to full decode:" << path << errorMsg;
+        return loadStaticImageFromFile(path, res, errorMsg, probeInfo, QSize(), options.cancelToken);
+    }
+
+    res = orientImage(image, probeInfo.orientation);
+    errorMsg = "use progressive decode";
+    qDebug() << "Decoded image progressively:" << path << res.size();
+    return true;
+}
+
+};
@@ -0,0 +1,52 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef PROGRESSIVEDECODER_H
+#define PROGRESSIVEDECODER_H
+
+#include <QImage>
+#include <QSize>
+#include <QString>
+
+#include <functional>
+
+#include "unionimage.h"
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief ProgressiveCallback
+ * 渐进解码的中间结果回调，在解码线程中同步调用
+ * preview为按方向校正并缩放到预览尺寸的当前解码结果，尚未解码的区域为透明
+ * 返回false时中止解码
+ */
+typedef std::function<bool(const QImage &preview)> ProgressiveCallback;
+
+struct ProgressiveOptions {
+    QSize previewSize;          // 中间结果的最大尺寸，无效时使用原图尺寸
+    int updateInterval = 150;   // 两次回调的最小间隔(毫秒)，限制刷新频率
+    DecodeCancelTokenPtr cancelToken;   // 在扫描行批次之间检查，取消后返回false
+    qint64 minPixels = 16LL * 1024 * 1024;     // 超过该像素数的图片才逐步解码，小图整体解码更快
+};
+
+/**
+ * @brief loadStaticImageProgressive
+ * @param[in]           path
+ * @param[out]          res
+ * @param[out]          errorMsg
+ * @param[in]           options
+ * @param[in]           callback
+ * @return bool
+ * 大尺寸的PNG/JPEG按扫描行带或渐进式JPEG的扫描遍逐步解码，期间通过callback输出中间结果
+ * callback为空时不输出中间结果，只在扫描行批次之间检查取消标记
+ * 隔行PNG按Adam7遍输出，每遍以块填充未解码的像素；其他格式及小图直接使用loadStaticImageFromFile
+ * 最终结果的像素格式和色彩空间(内嵌ICC配置)与Qt插件一致，16位、调色板PNG及CMYK JPEG等直接使用Qt插件解码
+ */
+UNIONIMAGESHARED_EXPORT bool loadStaticImageProgressive(const QString &path, QImage &res, QString &errorMsg,
+                                                        const ProgressiveOptions &options,
+                                                        const ProgressiveCallback &callback);
+
+};
+
+#endif // PROGRESSIVEDECODER_H
@@ -7,118 +7,302 @@
 #include <QDebug>
 #include <QFile>
 
+#include <cstring>
+
 // For more information about image file extension, see:
 // https://en.wikipedia.org/wiki/Image_file_formats
-QString DetectImageFormat(const QString &filepath)
+// https://en.wikipedia.org/wiki/List_of_file_signatures
+namespace {
+
+struct MagicPart {
+    int offset;
+    const char *bytes;
+    int length;
+};
+
+struct MagicSignature {
+    MagicPart parts[2];
+    const char *format;
+};
+
+// sizeof keeps embedded '\0' bytes in the signature.
+#define MAGIC(offset, bytes) {offset, bytes, static_cast<int>(sizeof(bytes) - 1)}
+#define NO_MAGIC {0, nullptr, 0}
+
+// Fixed-offset signatures, checked in order. More specific signatures
+// (tiff based raw formats) must come before the generic ones.
+const MagicSignature SIGNATURES[] = {
+    {{MAGIC(0, "\x89PNG\r\n\x1a\n"), NO_MAGIC}, "png"},
+    {{MAGIC(0, "\xff\xd8\xff"), NO_MAGIC}, "jpg"},
+    {{MAGIC(0, "GIF87a"), NO_MAGIC}, "gif"},
+    {{MAGIC(0, "GIF89a"), NO_MAGIC}, "gif"},
+    {{MAGIC(0, "RIFF"), MAGIC(8, "WEBP")}, "webp"},
+    {{MAGIC(0, "\x8aMNG\r\n\x1a\n"), NO_MAGIC}, "mng"},
+    {{MAGIC(0, "II*\0"), MAGIC(8, "CR\x02")}, "cr2"},
+    {{MAGIC(0, "IIRO"), NO_MAGIC}, "orf"},
+    {{MAGIC(0, "IIRS"), NO_MAGIC}, "orf"},
+    {{MAGIC(0, "MMOR"), NO_MAGIC}, "orf"},
+    {{MAGIC(0, "II\x1a\0\0\0HEAPCCDR"), NO_MAGIC}, "crw"},
+    {{MAGIC(0, "II*\0"), NO_MAGIC}, "tiff"},
+    {{MAGIC(0, "MM\0*"), NO_MAGIC}, "tiff"},
+    {{MAGIC(0, "II+\0"), NO_MAGIC}, "tiff"},
+    {{MAGIC(0, "MM\0+"), NO_MAGIC}, "tiff"},
+    {{MAGIC(0, "FUJIFILMCCD-RAW"), NO_MAGIC}, "raf"},
+    {{MAGIC(0, "\0MRM"), NO_MAGIC}, "mrw"},
+    {{MAGIC(0, "FOVb"), NO_MAGIC}, "x3f"},
+    {{MAGIC(0, "\0\0\0\x0cjP  \r\n\x87\n"), NO_MAGIC}, "jp2"},
+    {{MAGIC(0, "\xff\x4f\xff\x51"), NO_MAGIC}, "j2k"},
+    {{MAGIC(0, "8BPS"), NO_MAGIC}, "psd"},
+    {{MAGIC(0, "icns"), NO_MAGIC}, "icns"},
+    {{MAGIC(0, "\0\0\x01\0"), NO_MAGIC}, "ico"},
+    {{MAGIC(0, "DDS "), NO_MAGIC}, "dds"},
+    {{MAGIC(0, "#?RADIANCE"), NO_MAGIC}, "hdr"},
+    {{MAGIC(0, "#?RGBE"), NO_MAGIC}, "hdr"},
+    {{MAGIC(0, "\x53\x80\xf6\x34"), NO_MAGIC}, "pic"},
+    {{MAGIC(0, "FORM"), MAGIC(8, "ILBM")}, "iff"},
+    {{MAGIC(0, "FORM"), MAGIC(8, "PBM ")}, "iff"},
+    {{MAGIC(0, "\xab\x01"), NO_MAGIC}, "viff"},
+    {{MAGIC(0, "%!PS-Adobe-"), NO_MAGIC}, "eps"},
+    {{MAGIC(0, "\xc5\xd0\xd3\xc6"), NO_MAGIC}, "eps"},
+    {{MAGIC(0, "\xd7\xcd\xc6\x9a"), NO_MAGIC}, "wmf"},
+    {{MAGIC(0, "\x01\0\x09\0\0\x03"), NO_MAGIC}, "wmf"},
+    {{MAGIC(0, "/* XPM */"), NO_MAGIC}, "xpm"},
+    {{MAGIC(0, "BM"), NO_MAGIC}, "bmp"},
+};
+
+#undef MAGIC
+#undef NO_MAGIC
+
+bool matchPart(const uchar *data, int size, const MagicPart &part)
 {
-    qDebug() << "Starting image format detection for:" << filepath;
-    QFile file(filepath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        qWarning() << "Failed to open file for format detection:" << filepath;
-        return "";
-    }
+    return part.length == 0
+           || (part.offset + part.length <= size
+               && memcmp(data + part.offset, part.bytes, static_cast<size_t>(part.length)) == 0);
+}
 
-    const QByteArray data = file.read(1024);
-    qDebug() << "Read" << data.size() << "bytes for format detection";
+quint32 readBigEndian32(const uchar *data)
+{
+    return (static_cast<quint32>(data[0]) << 24) | (static_cast<quint32>(data[1]) << 16)
+           | (static_cast<quint32>(data[2]) << 8) | static_cast<quint32>(data[3]);
+}
 
-    // Check bmp file.
-    if (data.startsWith("BM")) {
-        qDebug() << "Detected BMP format";
-        return "bmp";
-    }
+bool isBrand(const uchar *brand, const char *name)
+{
+    return memcmp(brand, name, 4) == 0;
+}
 
-    // Check dds file.
-    if (data.startsWith("DDS")) {
-        qDebug() << "Detected DDS format";
-        return "dds";
-    }
+bool isHeicBrand(const uchar *brand)
+{
+    return isBrand(brand, "heic") || isBrand(brand, "heix") || isBrand(brand, "heim")
+           || isBrand(brand, "heis") || isBrand(brand, "hevc") || isBrand(brand, "hevx");
+}
 
-    // Check gif file.
-    if (data.startsWith("GIF8")) {
-        qDebug() << "Detected GIF format";
-        return "gif";
-    }
+bool isAvifBrand(const uchar *brand)
+{
+    return isBrand(brand, "avif") || isBrand(brand, "avis");
+}
 
-    // Check Max OS icons file.
-    if (data.startsWith("icns")) {
-        qDebug() << "Detected ICNS format";
-        return "icns";
+// ISO base media file format: the "ftyp" box lists the major brand and the
+// compatible brands. HEIF containers use the generic "mif1"/"msf1" major
+// brand, so the compatible brands decide between avif and heic.
+const char *sniffIsoBmff(const uchar *data, int size)
+{
+    if (size < 16 || memcmp(data + 4, "ftyp", 4) != 0) {
+        return nullptr;
     }
-
-    // Check jpeg file.
-    if (data.startsWith("\xff\xd8")) {
-        qDebug() << "Detected JPEG format";
-        return "jpg";
+    const quint32 boxSize = readBigEndian32(data);
+    if (boxSize < 16) {
+        return nullptr;
     }
 
-    // Check mng file.
-    if (data.startsWith("\x8a\x4d\x4e\x47\x0d\x0a\x1a\x0a")) {
-        qDebug() << "Detected MNG format";
-        return "mng";
+    const uchar *major = data + 8;
+    if (isAvifBrand(major)) {
+        return "avif";
+    }
+    if (isHeicBrand(major)) {
+        return "heic";
+    }
+    if (isBrand(major, "j2ki")) {
+        return "hej2";
+    }
+    if (isBrand(major, "jp2 ")) {
+        return "jp2";
     }
 
-    // Check net pbm file (BitMap).
-    if (data.startsWith("P1") || data.startsWith("P4")) {
-        qDebug() << "Detected PBM format";
-        return "pbm";
+    const bool heifContainer = isBrand(major, "mif1") || isBrand(major, "msf1");
+    const int end = static_cast<int>(qMin<quint32>(boxSize, static_cast<quint32>(size)));
+    bool heic = false;
+    // 跳过minor_version，之后每4字节为一个兼容品牌
+    for (int offset = 16; offset + 4 <= end; offset += 4) {
+        const uchar *brand = data + offset;
+        if (isAvifBrand(brand)) {
+            return "avif";
+        }
+        heic = heic || isHeicBrand(brand);
     }
+    if (heic) {
+        return "heic";
+    }
+    return heifContainer ? "heif" : nullptr;
+}
+
+bool isSpace(uchar c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
 
-    // Check pgm file (GrayMap).
-    if (data.startsWith("P2") || data.startsWith("P5")) {
-        qDebug() << "Detected PGM format";
+// Netpbm: "P1" ~ "P6" followed by whitespace.
+const char *sniffNetpbm(const uchar *data, int size)
+{
+    if (size < 3 || data[0] != 'P' || !isSpace(data[2])) {
+        return nullptr;
+    }
+    switch (data[1]) {
+    case '1':
+    case '4':
+        return "pbm";
+    case '2':
+    case '5':
         return "pgm";
+    case '3':
+    case '6':
+        return "ppm";
+    default:
+        return nullptr;
     }
+}
 
-    // Check ppm file (PixMap).
-    if (data.startsWith("P3") || data.startsWith("P6")) {
-        qDebug() << "Detected PPM format";
-        return "ppm";
+bool containsText(const uchar *data, int size, const char *text)
+{
+    const int length = static_cast<int>(strlen(text));
+    for (int i = 0; i + length <= size; ++i) {
+        if (memcmp(data + i, text, static_cast<size_t>(length)) == 0) {
+            return true;
+        }
     }
+    return false;
+}
 
-    // Check png file.
-    if (data.startsWith("\x89PNG\x0d\x0a\x1a\x0a")) {
-        qDebug() << "Detected PNG format";
-        return "png";
+// Text formats: svg (optionally after an xml prologue) and xbm.
+const char *sniffText(const uchar *data, int size)
+{
+    int start = 0;
+    if (size >= 3 && memcmp(data, "\xef\xbb\xbf", 3) == 0) {
+        start = 3;
+    }
+    while (start < size && isSpace(data[start])) {
+        ++start;
     }
+    const uchar *text = data + start;
+    const int length = size - start;
 
-    // Check svg file.
-    if (data.indexOf("<svg") > -1) {
-        qDebug() << "Detected SVG format";
+    if (length >= 4 && memcmp(text, "<svg", 4) == 0) {
         return "svg";
     }
+    if (length >= 2 && text[0] == '<' && (text[1] == '?' || text[1] == '!')
+            && containsText(text, length, "<svg")) {
+        return "svg";
+    }
+    if (length >= 8 && memcmp(text, "#define ", 8) == 0 && containsText(text, length, "_width ")) {
+        return "xbm";
+    }
+    return nullptr;
+}
+
+// TGA has no magic number at the beginning of the file, validate the
+// header fields instead. Checked last to avoid false positives.
+const char *sniffTga(const uchar *data, int size)
+{
+    if (size < 18) {
+        return nullptr;
+    }
+    const uchar colorMapType = data[1];
+    const uchar imageType = data[2];
+    const uchar colorMapDepth = data[7];
+    const int width = data[12] | (data[13] << 8);
+    const int height = data[14] | (data[15] << 8);
+    const uchar pixelDepth = data[16];
+    const uchar descriptor = data[17];
+
+    const bool colorMapped = (imageType == 1 || imageType == 9);
+    const bool trueColor = (imageType == 2 || imageType == 3 || imageType == 10 || imageType == 11);
+    if (colorMapType > 1 || (!colorMapped && !trueColor) || (colorMapped != (colorMapType == 1))) {
+        return nullptr;
+    }
+    if (colorMapped && colorMapDepth != 15 && colorMapDepth != 16 && colorMapDepth != 24 && colorMapDepth != 32) {
+        return nullptr;
+    }
+    if (pixelDepth != 8 && pixelDepth != 15 && pixelDepth != 16 && pixelDepth != 24 && pixelDepth != 32) {
+        return nullptr;
+    }
+    if (width == 0 || height == 0 || (descriptor & 0xc0) != 0) {
+        return nullptr;
+    }
+    return "tga";
+}
+
+typedef const char *(*FormatSniffer)(const uchar *data, int size);
 
-    // TODO(xushaohua): tga file is not supported yet.
-    qDebug() << "TGA format detection not implemented yet";
+// Formats that can not be described with fixed-offset signatures.
+const FormatSniffer SNIFFERS[] = {
+    sniffIsoBmff,
+    sniffNetpbm,
+    sniffText,
+    sniffTga,
+};
 
-    // Check tiff file.
-    if (data.startsWith("MM\x00\x2a") || data.startsWith("II\x2a\x00")) {
-        // big-endian, little-endian.
-        qDebug() << "Detected TIFF format";
-        return "tiff";
+const char *sniffFormat(const uchar *data, int size)
+{
+    for (const MagicSignature &signature : SIGNATURES) {
+        if (matchPart(data, size, signature.parts[0]) && matchPart(data, size, signature.parts[1])) {
+            return signature.format;
+        }
+    }
+    for (FormatSniffer sniffer : SNIFFERS) {
+        if (const char *format = sniffer(data, size)) {
+            return format;
+        }
     }
+    return nullptr;
+}
+
+// An xml prologue or comment may push "<svg" beyond the binary header.
+bool needsMarkupData(const QByteArray &data)
+{
+    const QByteArray text = data.trimmed();
+    return text.startsWith("<?") || text.startsWith("<!") || text.startsWith("\xef\xbb\xbf");
+}
+
+}
 
-    // TODO(xushaohua): Support wbmp file.
-    qDebug() << "WBMP format detection not implemented yet";
+QString DetectImageFormatFromData(const QByteArray &data)
+{
+    return QString::fromLatin1(sniffFormat(reinterpret_cast<const uchar *>(data.constData()), data.size()));
+}
 
-    // Check webp file.
-    if (data.startsWith("RIFFr\x00\x00\x00WEBPVP")) {
-        qDebug() << "Detected WebP format";
-        return "webp";
+QString DetectImageFormat(QIODevice *device)
+{
+    if (!device || !device->isReadable()) {
+        return "";
     }
 
-    // Check xbm file.
-    if (data.indexOf("#define max_width ") > -1 &&
-            data.indexOf("#define max_height ") > -1) {
-        qDebug() << "Detected XBM format";
-        return "xbm";
+    // peek不移动读取位置，调用方可继续在同一设备上解码
+    QByteArray data = device->peek(SNIFF_HEADER_SIZE);
+    QString format = DetectImageFormatFromData(data);
+    if (format.isEmpty() && needsMarkupData(data)) {
+        data = device->peek(SNIFF_MARKUP_SIZE);
+        format = DetectImageFormatFromData(data);
     }
+    return format;
+}
 
-    // Check xpm file.
-    if (data.startsWith("/* XPM */")) {
-        qDebug() << "Detected XPM format";
-        return "xpm";
+QString DetectImageFormat(const QString &filepath)
+{
+    QFile file(filepath);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open file for format detection:" << filepath;
+        return "";
     }
 
-    qDebug() << "No supported image format detected";
-    return "";
+    return DetectImageFormat(&file);
 }
@@ -5,10 +5,26 @@
 #ifndef SNIFFERIMAGEFORMAT_H
 #define SNIFFERIMAGEFORMAT_H
 
+#include <QByteArray>
 #include <QString>
 
+class QIODevice;
+
+// All binary signatures are located in the first SNIFF_HEADER_SIZE bytes.
+const int SNIFF_HEADER_SIZE = 32;
+// XML based formats (svg) may need a longer prefix to skip the prologue.
+const int SNIFF_MARKUP_SIZE = 1024;
+
 // Sniff image format based on its content.
-// Returns an empty string if failed.
+// Returns a lower-case format name or an empty string if failed.
 QString DetectImageFormat(const QString &filepath);
 
+// Sniff image format from an opened device without moving its position.
+QString DetectImageFormat(QIODevice *device);
+
+// Sniff image format from the leading bytes of the file.
+// Binary formats need SNIFF_HEADER_SIZE bytes, svg after an xml prologue
+// is only recognized when "<svg" is inside the given data.
+QString DetectImageFormatFromData(const QByteArray &data);
+
 #endif // SNIFFERIMAGEFORMAT_H
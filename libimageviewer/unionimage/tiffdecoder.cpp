@@ -0,0 +1,307 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "tiffdecoder.h"
+#include "fileidentity.h"
+#include "imagetransform.h"
+#include "service/taskscheduler.h"
+
+#include <QAtomicInt>
+#include <QDateTime>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QPair>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QThread>
+#include <QVector>
+#include <QDebug>
+
+#include <tiffio.h>
+
+namespace LibUnionImage_NameSpace {
+
+namespace {
+
+// 超过该像素数的图像按行带并行解码
+const qint64 PARALLEL_PIXEL_THRESHOLD = 1024 * 1024;
+// 并行解码的最大线程数，每个线程持有一个文件句柄
+const int MAX_DECODE_THREADS = 8;
+// 每解码约该行数检查一次取消标记，实际批次按条带/分块高度对齐
+const quint32 CANCEL_CHECK_ROWS = 256;
+
+// 缓存文件头标识 "TIFC" 及版本，格式变化时递增版本使旧缓存失效
+const quint32 CACHE_MAGIC = 0x54494643;
+const quint32 CACHE_VERSION = 1;
+// 缓存目录容量上限
+const qint64 CACHE_MAX_BYTES = 512LL * 1024 * 1024;
+// 单张图片超过容量上限的该比例时不写入缓存，避免写入后立即连同其他条目一起被淘汰
+const qint64 CACHE_MAX_ENTRY_PERCENT = 25;
+
+struct CacheHeader {
+    quint32 magic;
+    quint32 version;
+    qint32 width;
+    qint32 height;
+    qint32 format;
+    qint32 bytesPerLine;
+};
+
+struct TiffLayout {
+    quint32 width = 0;
+    quint32 height = 0;
+    quint32 blockHeight = 0;    // 条带行数或分块高度，行带按此对齐避免重复解码
+    int orientation = 1;
+};
+
+TIFF *openTiff(const QString &path)
+{
+    return TIFFOpen(QFile::encodeName(path).constData(), "r");
+}
+
+bool readLayout(TIFF *tif, TiffLayout &layout, QString &errorMsg)
+{
+    char emsg[1024] = {0};
+    if (!TIFFRGBAImageOK(tif, emsg)) {
+        errorMsg = QString("unsupported tiff: ") + emsg;
+        return false;
+    }
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+    TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+    if (width == 0 || height == 0) {
+        errorMsg = "invalid tiff size";
+        return false;
+    }
+
+    uint32_t blockHeight = 0;
+    if (TIFFIsTiled(tif)) {
+        TIFFGetField(tif, TIFFTAG_TILELENGTH, &blockHeight);
+    } else {
+        TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &blockHeight);
+    }
+    uint16_t orientation = ORIENTATION_TOPLEFT;
+    TIFFGetFieldDefaulted(tif, TIFFTAG_ORIENTATION, &orientation);
+
+    layout.width = width;
+    layout.height = height;
+    layout.blockHeight = qBound<quint32>(1, blockHeight, height);
+    // TIFF方向标签取值与EXIF方向一致
+    layout.orientation = (orientation >= 1 && orientation <= 8) ? orientation : 1;
+    return true;
+}
+
+/**
+ * @brief decodeRows
+ * 使用独立句柄将[row0, row1)行解码到raster(紧密排列的RGBA行)，像素保持文件中的存储顺序
+ * 按batchRows行分批解码，批次之间检查取消标记
+ */
+bool decodeRows(const QString &path, uchar *raster, quint32 row0, quint32 row1, quint32 batchRows,
+                const DecodeCancelTokenPtr &cancelToken)
+{
+    TIFF *tif = openTiff(path);
+    if (!tif) {
+        return false;
+    }
+
+    bool ok = false;
+    char emsg[1024] = {0};
+    TIFFRGBAImage img;
+    if (TIFFRGBAImageBegin(&img, tif, 0, emsg)) {
+        // 请求方向与文件方向一致时libtiff不做翻转，方向统一在解码后校正
+        img.req_orientation = img.orientation;
+        img.col_offset = 0;
+        ok = true;
+        for (quint32 row = row0; ok && row < row1; row += batchRows) {
+            if (isDecodeCancelled(cancelToken)) {
+                ok = false;
+                break;
+            }
+            img.row_offset = static_cast<int>(row);
+            uchar *dest = raster + static_cast<qsizetype>(row - row0) * img.width * 4;
+            ok = TIFFRGBAImageGet(&img, reinterpret_cast<uint32_t *>(dest), img.width, qMin(batchRows, row1 - row)) != 0;
+        }
+        TIFFRGBAImageEnd(&img);
+    } else {
+        qWarning() << "Failed to begin tiff decode:" << emsg;
+    }
+    TIFFClose(tif);
+    return ok;
+}
+
+QString cacheKey(const QString &path)
+{
+    const FileIdentity identity = fileIdentity(path);
+    return identity.isValid() ? identity.toString() + ".raw" : QString();
+}
+
+bool readCache(const QString &cacheFile, QImage &res)
+{
+    QFile file(cacheFile);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+
+    CacheHeader header;
+    if (file.read(reinterpret_cast<char *>(&header), sizeof(header)) != sizeof(header)
+            || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION
+            || header.format <= QImage::Format_Invalid || header.format >= QImage::NImageFormats) {
+        return false;
+    }
+
+    QImage image(header.width, header.height, static_cast<QImage::Format>(header.format));
+    if (image.isNull() || image.bytesPerLine() != header.bytesPerLine) {
+        return false;
+    }
+    const qint64 size = static_cast<qint64>(image.bytesPerLine()) * image.height();
+    if (file.read(reinterpret_cast<char *>(image.bits()), size) != size) {
+        return false;
+    }
+    file.close();
+
+    // 以修改时间记录最近使用时间，用于淘汰
+    QFile::setFileTime(cacheFile, QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+    res = image;
+    return true;
+}
+
+/**
+ * @brief trimCache
+ * 缓存总大小超过上限时，按最近使用时间从旧到新删除
+ */
+void trimCache(const QString &cacheDir)
+{
+    const QFileInfoList entries = QDir(cacheDir).entryInfoList(QStringList() << "*.raw", QDir::Files, QDir::Time);
+    qint64 total = 0;
+    for (const QFileInfo &entry : entries) {
+        total += entry.size();
+        if (total > CACHE_MAX_BYTES) {
+            QFile::remove(entry.absoluteFilePath());
+        }
+    }
+}
+
+void writeCache(const QString &cacheFile, const QImage &image)
+{
+    QSaveFile file(cacheFile);
+    if (!file.open(QIODevice::WriteOnly)) {
+        qWarning() << "Failed to open tiff cache file:" << cacheFile;
+        return;
+    }
+
+    CacheHeader header;
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.width = image.width();
+    header.height = image.height();
+    header.format = image.format();
+    header.bytesPerLine = image.bytesPerLine();
+    const qint64 size = static_cast<qint64>(image.bytesPerLine()) * image.height();
+    if (file.write(reinterpret_cast<const char *>(&header), sizeof(header)) != sizeof(header)
+            || file.write(reinterpret_cast<const char *>(image.constBits()), size) != size
+            || !file.commit()) {
+        qWarning() << "Failed to write tiff cache file:" << cacheFile;
+        return;
+    }
+    trimCache(QFileInfo(cacheFile).absolutePath());
+}
+
+}
+
+UNIONIMAGESHARED_EXPORT bool decodeTiffImage(const QString &path, QImage &res, QString &errorMsg, const DecodeCancelTokenPtr &cancelToken)
+{
+    TiffLayout layout;
+    TIFF *tif = openTiff(path);
+    if (!tif) {
+        errorMsg = "open tiff failed, path:" + path;
+        return false;
+    }
+    const bool layoutOk = readLayout(tif, layout, errorMsg);
+    TIFFClose(tif);
+    if (!layoutOk) {
+        return false;
+    }
+
+    // libtiff输出RGBA字节序且已预乘透明度
+    QImage image(static_cast<int>(layout.width), static_cast<int>(layout.height), QImage::Format_RGBA8888_Premultiplied);
+    if (image.isNull()) {
+        errorMsg = QString("failed to allocate image %1x%2").arg(layout.width).arg(layout.height);
+        return false;
+    }
+
+    // 行带按条带/分块高度对齐，每个条带只解码一次
+    const qint64 pixels = static_cast<qint64>(layout.width) * layout.height;
+    const quint32 blocks = (layout.height + layout.blockHeight - 1) / layout.blockHeight;
+    const int bands = pixels >= PARALLEL_PIXEL_THRESHOLD
+                      ? static_cast<int>(qMin<quint32>(blocks, static_cast<quint32>(qBound(1, QThread::idealThreadCount(), MAX_DECODE_THREADS))))
+                      : 1;
+    const quint32 blocksPerBand = (blocks + bands - 1) / bands;
+    QVector<QPair<quint32, quint32>> ranges;
+    for (quint32 block = 0; block < blocks; block += blocksPerBand) {
+        ranges.append(qMakePair(block * layout.blockHeight,
+                                qMin((block + blocksPerBand) * layout.blockHeight, layout.height)));
+    }
+
+    // 32位格式每行恰好为width个像素，与libtiff输出的行距一致
+    uchar *bits = image.bits();
+    const qsizetype stride = image.bytesPerLine();
+    const quint32 batchRows = qMax<quint32>(1, CANCEL_CHECK_ROWS / layout.blockHeight) * layout.blockHeight;
+    QAtomicInt failed(0);
+    auto decodeRange = [&](const QPair<quint32, quint32> &range) {
+        if (!decodeRows(path, bits + range.first * stride, range.first, range.second, batchRows, cancelToken)) {
+            failed.storeRelease(1);
+        }
+    };
+    if (ranges.size() > 1) {
+        LibTaskScheduler::instance()->parallelFor(ranges.size(), [&decodeRange, &ranges](int index) {
+            decodeRange(ranges.at(index));
+        });
+    } else {
+        decodeRange(ranges.first());
+    }
+    if (isDecodeCancelled(cancelToken)) {
+        errorMsg = "decode cancelled";
+        return false;
+    }
+    if (failed.loadAcquire()) {
+        errorMsg = "decode tiff failed, path:" + path;
+        return false;
+    }
+
+    res = orientImage(image, layout.orientation);
+    qDebug() << "Decoded tiff with libtiff:" << path << res.size() << "bands:" << ranges.size();
+    return true;
+}
+
+UNIONIMAGESHARED_EXPORT QString tiffCachePath()
+{
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+           + "/deepin/deepin-image-viewer/tiff";
+}
+
+UNIONIMAGESHARED_EXPORT bool loadTiffImageCached(const QString &path, QImage &res, QString &errorMsg, const DecodeCancelTokenPtr &cancelToken)
+{
+    const QString key = cacheKey(path);
+    const QString cacheDir = tiffCachePath();
+    const QString cacheFile = cacheDir + QDir::separator() + key;
+    if (!key.isEmpty() && readCache(cacheFile, res)) {
+        qDebug() << "Using cached tiff image:" << cacheFile;
+        return true;
+    }
+
+    if (!decodeTiffImage(path, res, errorMsg, cancelToken)) {
+        return false;
+    }
+    if (res.sizeInBytes() > CACHE_MAX_BYTES * CACHE_MAX_ENTRY_PERCENT / 100) {
+        qDebug() << "Tiff image too large to cache:" << path << res.sizeInBytes();
+    } else if (!key.isEmpty() && QDir().mkpath(cacheDir)) {
+        writeCache(cacheFile, res);
+    }
+    return true;
+}
+
+};
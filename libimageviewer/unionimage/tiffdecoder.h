@@ -0,0 +1,51 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TIFFDECODER_H
+#define TIFFDECODER_H
+
+#include <QImage>
+#include <QString>
+
+#include "unionimage.h"
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief decodeTiffImage
+ * @param[in]           path
+ * @param[out]          res
+ * @param[out]          errorMsg
+ * @param[in]           cancelToken
+ * @return bool
+ * 使用libtiff在进程内解码TIFF的第一页，用于Qt插件无法读取的旧式压缩(如OJPEG)等情况
+ * 条带/分块按行带拆分到线程池并行解码，每个线程使用独立的文件句柄，并按TIFF方向标签校正
+ * 各行带分批解码，批次之间检查cancelToken
+ */
+UNIONIMAGESHARED_EXPORT bool decodeTiffImage(const QString &path, QImage &res, QString &errorMsg,
+                                             const DecodeCancelTokenPtr &cancelToken = DecodeCancelTokenPtr());
+
+/**
+ * @brief loadTiffImageCached
+ * @param[in]           path
+ * @param[out]          res
+ * @param[out]          errorMsg
+ * @param[in]           cancelToken
+ * @return bool
+ * 优先读取持久化的解码缓存，未命中时调用decodeTiffImage并写入缓存
+ * 缓存以设备号、inode、文件大小和修改时间为键，跨会话保留，超出容量时淘汰最久未使用的条目
+ */
+UNIONIMAGESHARED_EXPORT bool loadTiffImageCached(const QString &path, QImage &res, QString &errorMsg,
+                                                 const DecodeCancelTokenPtr &cancelToken = DecodeCancelTokenPtr());
+
+/**
+ * @brief tiffCachePath
+ * @return QString
+ * 持久化TIFF解码缓存目录($XDG_CACHE_HOME/deepin/deepin-image-viewer/tiff)
+ */
+UNIONIMAGESHARED_EXPORT QString tiffCachePath();
+
+};
+
+#endif // TIFFDECODER_H
@@ -0,0 +1,345 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "tiledimagesource.h"
+#include "imagetransform.h"
+#include "service/taskscheduler.h"
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QImageReader>
+#include <QPair>
+#include <QTransform>
+#include <QVector>
+#include <QDebug>
+
+#include <cmath>
+#include <cstring>
+#include <tiffio.h>
+
+namespace LibUnionImage_NameSpace {
+
+namespace {
+
+// 超过该像素数(约10000x10000)的图片使用区域解码
+const qint64 HUGE_IMAGE_PIXELS = 10000LL * 10000;
+// TIFF缩放解码时每个行带的最大原始数据量，限制峰值内存
+const qint64 MAX_BAND_BYTES = 32LL * 1024 * 1024;
+// 内存源最小一级的长边不小于该值，更低的分辨率由预览图提供
+const int MIN_MEMORY_LEVEL_EXTENT = 1024;
+
+/**
+ * @brief orientationTransform
+ * 文件存储坐标到按方向校正后的显示坐标的变换
+ */
+QTransform orientationTransform(int orientation, const QSize &storedSize)
+{
+    const qreal w = storedSize.width();
+    const qreal h = storedSize.height();
+    switch (orientation) {
+    case 2:
+        return QTransform(-1, 0, 0, 1, w, 0);
+    case 3:
+        return QTransform(-1, 0, 0, -1, w, h);
+    case 4:
+        return QTransform(1, 0, 0, -1, 0, h);
+    case 5:
+        return QTransform(0, 1, 1, 0, 0, 0);
+    case 6:
+        return QTransform(0, 1, -1, 0, h, 0);
+    case 7:
+        return QTransform(0, -1, -1, 0, h, w);
+    case 8:
+        return QTransform(0, -1, 1, 0, 0, w);
+    default:
+        return QTransform();
+    }
+}
+
+TIFF *openTiff(const QString &path)
+{
+    return TIFFOpen(QFile::encodeName(path).constData(), "r");
+}
+
+// 条带行数或分块高度，行带按此对齐避免重复解码
+quint32 readTiffBlockHeight(const QString &path)
+{
+    TIFF *tif = openTiff(path);
+    if (!tif) {
+        return 1;
+    }
+    uint32_t blockHeight = 0;
+    if (TIFFIsTiled(tif)) {
+        TIFFGetField(tif, TIFFTAG_TILELENGTH, &blockHeight);
+    } else {
+        TIFFGetFieldDefaulted(tif, TIFFTAG_ROWSPERSTRIP, &blockHeight);
+    }
+    TIFFClose(tif);
+    return qMax<quint32>(1, blockHeight);
+}
+
+/**
+ * @brief decodeTiffRect
+ * 使用独立句柄以原始分辨率解码存储坐标中的区域，libtiff输出RGBA字节序且已预乘透明度
+ */
+QImage decodeTiffRect(const QString &path, const QRect &rect)
+{
+    TIFF *tif = openTiff(path);
+    if (!tif) {
+        return QImage();
+    }
+
+    QImage image;
+    char emsg[1024] = {0};
+    TIFFRGBAImage img;
+    if (TIFFRGBAImageBegin(&img, tif, 0, emsg)) {
+        image = QImage(rect.size(), QImage::Format_RGBA8888_Premultiplied);
+        // 请求方向与文件方向一致时libtiff不做翻转，方向统一在解码后校正
+        img.req_orientation = img.orientation;
+        img.row_offset = rect.y();
+        img.col_offset = rect.x();
+        if (image.isNull()
+                || !TIFFRGBAImageGet(&img, reinterpret_cast<uint32_t *>(image.bits()),
+                                     static_cast<uint32_t>(rect.width()), static_cast<uint32_t>(rect.height()))) {
+            image = QImage();
+        }
+        TIFFRGBAImageEnd(&img);
+    } else {
+        qWarning() << "Failed to begin tiff region decode:" << emsg;
+    }
+    TIFFClose(tif);
+    return image;
+}
+
+/**
+ * @brief decodeTiffScaled
+ * 将存储坐标中的区域按行带解码并逐带缩放到输出尺寸，原始分辨率的数据只保留一个行带
+ * 行带按条带/分块高度对齐，parallel为真时行带分发到线程池并行解码
+ */
+QImage decodeTiffScaled(const QString &path, const QRect &rect, const QSize &outSize, quint32 blockHeight, bool parallel)
+{
+    if (outSize == rect.size()) {
+        return decodeTiffRect(path, rect);
+    }
+
+    QImage result(outSize, QImage::Format_RGBA8888_Premultiplied);
+    if (result.isNull()) {
+        return QImage();
+    }
+
+    const qreal ratio = qreal(outSize.height()) / rect.height();
+    // 每个行带至少对应若干输出行，避免逐行缩放带来的接缝
+    const int minRows = static_cast<int>(std::ceil(4 / ratio));
+    const int maxRows = static_cast<int>(qMax<qint64>(1, MAX_BAND_BYTES / (4LL * rect.width())));
+    const quint32 rows = static_cast<quint32>(qMax(minRows, qMin(maxRows, rect.height())));
+    const int bandRows = static_cast<int>((rows + blockHeight - 1) / blockHeight * blockHeight);
+
+    QVector<QPair<int, int>> ranges;
+    for (int row = 0; row < rect.height(); row += bandRows) {
+        ranges.append(qMakePair(row, qMin(row + bandRows, rect.height())));
+    }
+
+    uchar *bits = result.bits();
+    const qsizetype stride = result.bytesPerLine();
+    QAtomicInt failed(0);
+    auto decodeRange = [&](const QPair<int, int> &range) {
+        const int out0 = qRound(range.first * ratio);
+        const int out1 = qRound(range.second * ratio);
+        if (out1 <= out0 || failed.loadAcquire()) {
+            return;
+        }
+        const QImage band = decodeTiffRect(path, QRect(rect.x(), rect.y() + range.first,
+                                                       rect.width(), range.second - range.first));
+        if (band.isNull()) {
+            failed.storeRelease(1);
+            return;
+        }
+        // 输出行区间互不重叠，各线程直接写入结果图
+        const QImage scaled = band.scaled(outSize.width(), out1 - out0, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        for (int y = 0; y < scaled.height(); ++y) {
+            memcpy(bits + (out0 + y) * stride, scaled.constScanLine(y), static_cast<size_t>(scaled.bytesPerLine()));
+        }
+    };
+    if (parallel && ranges.size() > 1) {
+        LibTaskScheduler::instance()->parallelFor(ranges.size(), [&decodeRange, &ranges](int index) {
+            decodeRange(ranges.at(index));
+        });
+    } else {
+        for (const QPair<int, int> &range : ranges) {
+            decodeRange(range);
+        }
+    }
+    return failed.loadAcquire() ? QImage() : result;
+}
+
+}
+
+QSharedPointer<TiledImageSource> TiledImageSource::create(const ImageProbeInfo &probeInfo)
+{
+    if (!probeInfo.size.isValid() || probeInfo.isAnimated()) {
+        return QSharedPointer<TiledImageSource>();
+    }
+
+    const QString format = probeInfo.readFormat().toUpper();
+    if (format == "TIF" || format == "TIFF") {
+        TIFF *tif = openTiff(probeInfo.path);
+        if (!tif) {
+            return QSharedPointer<TiledImageSource>();
+        }
+        char emsg[1024] = {0};
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint16_t orientation = ORIENTATION_TOPLEFT;
+        const bool ok = TIFFRGBAImageOK(tif, emsg);
+        TIFFGetField(tif, TIFFTAG_IMAGEWIDTH, &width);
+        TIFFGetField(tif, TIFFTAG_IMAGELENGTH, &height);
+        TIFFGetFieldDefaulted(tif, TIFFTAG_ORIENTATION, &orientation);
+        TIFFClose(tif);
+        if (!ok || width == 0 || height == 0) {
+            qWarning() << "Tiff does not support region decode:" << probeInfo.path << emsg;
+            return QSharedPointer<TiledImageSource>();
+        }
+        // TIFF方向标签取值与EXIF方向一致
+        return QSharedPointer<TiledImageSource>(new TiledImageSource(
+                                                    probeInfo.path, BackendLibTiff, QByteArray("tiff"),
+                                                    QSize(static_cast<int>(width), static_cast<int>(height)),
+                                                    (orientation >= 1 && orientation <= 8) ? orientation : 1));
+    }
+
+    QImageReader reader(probeInfo.path, format.toLatin1());
+    if (!reader.supportsOption(QImageIOHandler::ClipRect)) {
+        return QSharedPointer<TiledImageSource>();
+    }
+    return QSharedPointer<TiledImageSource>(new TiledImageSource(probeInfo.path, BackendImageReader, format.toLatin1(),
+                                                                 probeInfo.size, probeInfo.orientation));
+}
+
+QSharedPointer<TiledImageSource> TiledImageSource::fromImage(const QImage &image, const QString &path)
+{
+    if (image.isNull()) {
+        return QSharedPointer<TiledImageSource>();
+    }
+    QSharedPointer<TiledImageSource> source(new TiledImageSource(path, BackendMemory, QByteArray(), image.size(), 1));
+    source->m_levels.append(image);
+    while (qMax(source->m_levels.last().width(), source->m_levels.last().height()) / 2 >= MIN_MEMORY_LEVEL_EXTENT) {
+        const QImage level = halveImage(source->m_levels.last());
+        if (level.isNull()) {
+            break;
+        }
+        source->m_levels.append(level);
+    }
+    return source;
+}
+
+bool TiledImageSource::isHugeImage(const QSize &size)
+{
+    return size.isValid() && static_cast<qint64>(size.width()) * size.height() > HUGE_IMAGE_PIXELS;
+}
+
+TiledImageSource::TiledImageSource(const QString &path, Backend backend, const QByteArray &format,
+                                   const QSize &storedSize, int orientation)
+    : m_path(path)
+    , m_backend(backend)
+    , m_format(format)
+    , m_storedSize(storedSize)
+    , m_orientation(orientation)
+{
+    qDebug() << "Created tiled image source:" << path << "size:" << storedSize << "orientation:" << orientation;
+}
+
+QString TiledImageSource::path() const
+{
+    return m_path;
+}
+
+TiledImageSource::Backend TiledImageSource::backend() const
+{
+    return m_backend;
+}
+
+QSize TiledImageSource::size() const
+{
+    return m_orientation >= 5 ? m_storedSize.transposed() : m_storedSize;
+}
+
+QImage TiledImageSource::image() const
+{
+    return m_levels.isEmpty() ? QImage() : m_levels.first();
+}
+
+QImage TiledImageSource::readRegion(const QRect &rect, const QSize &scaledSize) const
+{
+    const QRect region = rect & QRect(QPoint(0, 0), size());
+    if (region.isEmpty()) {
+        return QImage();
+    }
+
+    // 显示坐标映射回存储坐标，解码后再按方向校正
+    const QRect storedRect = orientationTransform(m_orientation, m_storedSize).inverted().mapRect(QRectF(region)).toAlignedRect()
+                             & QRect(QPoint(0, 0), m_storedSize);
+    QSize storedScaledSize = scaledSize.isValid() ? scaledSize : region.size();
+    if (m_orientation >= 5) {
+        storedScaledSize.transpose();
+    }
+
+    const QImage image = readStoredRegion(storedRect, storedScaledSize);
+    if (image.isNull()) {
+        qWarning() << "Failed to read image region:" << m_path << rect;
+        return QImage();
+    }
+    return orientImage(image, m_orientation);
+}
+
+QImage TiledImageSource::readPreview(const QSize &maxSize) const
+{
+    const QSize previewSize = size().scaled(maxSize, Qt::KeepAspectRatio).expandedTo(QSize(1, 1));
+    if (m_backend == BackendLibTiff) {
+        QSize storedPreviewSize = previewSize;
+        if (m_orientation >= 5) {
+            storedPreviewSize.transpose();
+        }
+        // 预览需要读取全部数据，行带并行解码
+        const QImage image = decodeTiffScaled(m_path, QRect(QPoint(0, 0), m_storedSize), storedPreviewSize,
+                                              readTiffBlockHeight(m_path), true);
+        return image.isNull() ? QImage() : orientImage(image, m_orientation);
+    }
+    return readRegion(QRect(QPoint(0, 0), size()), previewSize);
+}
+
+QImage TiledImageSource::readStoredRegion(const QRect &rect, const QSize &scaledSize) const
+{
+    if (m_backend == BackendLibTiff) {
+        return decodeTiffScaled(m_path, rect, scaledSize, readTiffBlockHeight(m_path), false);
+    }
+
+    if (m_backend == BackendMemory) {
+        // 取分辨率不低于输出尺寸的最小一级裁剪，只需缩放剩余的比例
+        int level = 0;
+        while (level + 1 < m_levels.size()
+                && rect.width() >> (level + 1) >= scaledSize.width()
+                && rect.height() >> (level + 1) >= scaledSize.height()) {
+            ++level;
+        }
+        const QImage &source = m_levels.at(level);
+        const QRect levelRect = QRect(rect.x() >> level, rect.y() >> level,
+                                      qMax(1, rect.width() >> level), qMax(1, rect.height() >> level))
+                                & source.rect();
+        const QImage image = source.copy(levelRect);
+        return image.size() == scaledSize ? image : image.scaled(scaledSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+
+    QImageReader reader(m_path, m_format);
+    reader.setAutoTransform(false);
+    reader.setClipRect(rect);
+    if (scaledSize != rect.size()) {
+        reader.setScaledSize(scaledSize);
+    }
+    QImage image = reader.read();
+    if (image.isNull()) {
+        qWarning() << "QImageReader region decode failed:" << reader.errorString();
+    }
+    return image;
+}
+
+};
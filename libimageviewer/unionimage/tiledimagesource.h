@@ -0,0 +1,103 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TILEDIMAGESOURCE_H
+#define TILEDIMAGESOURCE_H
+
+#include <QImage>
+#include <QMetaType>
+#include <QRect>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+
+#include "unionimage.h"
+
+namespace LibUnionImage_NameSpace {
+
+/**
+ * @brief The TiledImageSource class
+ * 超大图片的区域解码源，只解码指定区域并缩放到需要的分辨率，不在内存中保留整张原图
+ * JPEG等支持裁剪的格式使用QImageReader的ClipRect/ScaledSize(JPEG可在DCT域缩放)
+ * TIFF使用libtiff按行偏移/列偏移读取，分块TIFF只读取与区域相交的分块
+ * 已解码的超宽/超高图片使用内存源，按级保存逐级减半的图片，分块直接从对应级别裁剪
+ * 接口中的坐标均为按方向校正后的显示坐标，所有接口可在多个线程中同时调用，每次解码使用独立的文件句柄
+ */
+class UNIONIMAGESHARED_EXPORT TiledImageSource
+{
+public:
+    enum Backend {
+        BackendImageReader = 0,     // QImageReader裁剪解码
+        BackendLibTiff,             // libtiff区域解码
+        BackendMemory               // 已解码的内存图片
+    };
+
+    /**
+     * @brief create
+     * @param[in]           probeInfo
+     * @return QSharedPointer<TiledImageSource>
+     * 根据探测信息创建区域解码源，格式不支持区域解码时返回空指针
+     */
+    static QSharedPointer<TiledImageSource> create(const ImageProbeInfo &probeInfo);
+
+    /**
+     * @brief fromImage
+     * @param[in]           image
+     * @param[in]           path
+     * @return QSharedPointer<TiledImageSource>
+     * 以已解码的图片创建内存源，同时生成逐级减半的图片，耗时较长，应在后台线程调用
+     */
+    static QSharedPointer<TiledImageSource> fromImage(const QImage &image, const QString &path = QString());
+
+    /**
+     * @brief isHugeImage
+     * @param[in]           size
+     * @return bool
+     * 像素数超过阈值的图片整图解码代价过高，应使用区域解码
+     */
+    static bool isHugeImage(const QSize &size);
+
+    QString path() const;
+    Backend backend() const;
+    // 按方向校正后的原图尺寸
+    QSize size() const;
+    // 内存源的完整图片，其他来源返回空图
+    QImage image() const;
+
+    /**
+     * @brief readRegion
+     * @param[in]           rect        原图中的区域(显示坐标)
+     * @param[in]           scaledSize  输出尺寸，无效时按原始分辨率输出
+     * @return QImage
+     * 解码指定区域并缩放到输出尺寸，失败时返回空图
+     */
+    QImage readRegion(const QRect &rect, const QSize &scaledSize = QSize()) const;
+
+    /**
+     * @brief readPreview
+     * @param[in]           maxSize
+     * @return QImage
+     * 解码整张图片的缩略预览，保持比例缩放到maxSize以内
+     */
+    QImage readPreview(const QSize &maxSize) const;
+
+private:
+    TiledImageSource(const QString &path, Backend backend, const QByteArray &format,
+                     const QSize &storedSize, int orientation);
+
+    QImage readStoredRegion(const QRect &rect, const QSize &scaledSize) const;
+
+    QString m_path;
+    Backend m_backend;
+    QByteArray m_format;
+    QSize m_storedSize;     // 文件中存储的尺寸
+    int m_orientation;      // EXIF/TIFF方向
+    QVector<QImage> m_levels;   // 内存源第i项为原图缩小2^i倍的图片
+};
+
+};
+
+Q_DECLARE_METATYPE(QSharedPointer<LibUnionImage_NameSpace::TiledImageSource>)
+
+#endif // TILEDIMAGESOURCE_H
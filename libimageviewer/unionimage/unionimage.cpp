@@ -20,12 +20,14 @@
 #include <QtSvg/QSvgRenderer>
 #include <QDir>
 #include <QDebug>
-#include <QUuid>
+#include <QFile>
+#include <QSaveFile>
 
 #include "unionimage/imageutils.h"
-extern "C" {
-#include "3rdparty/tiff-tools/converttiff.h"
-}
+#include "unionimage/imageexif.h"
+#include "unionimage/imagetransform.h"
+#include "unionimage/snifferimageformat.h"
+#include "unionimage/tiffdecoder.h"
 
 #include <cstring>
 
@@ -222,14 +224,12 @@ UNIONIMAGESHARED_EXPORT const QString getFileFormat(const QString &path)
 
 UNIONIMAGESHARED_EXPORT bool canSave(const QString &path)
 {
-    QImageReader r(path);
-    if (r.imageCount() > 1) {
+    QFileInfo info(path);
+    if (!union_image_private.m_canSave.contains(info.suffix().toUpper())) {
         return false;
     }
-    QFileInfo info(path);
-    if (union_image_private.m_canSave.contains(info.suffix().toUpper()))
-        return true;
-    return false;
+    // 多帧图片不允许保存
+    return probeImage(path).frameCount <= 1;
 }
 
 UNIONIMAGESHARED_EXPORT QString unionImageVersion()
@@ -241,92 +241,256 @@ UNIONIMAGESHARED_EXPORT QString unionImageVersion()
     return ver;
 }
 
-QString PrivateDetectImageFormat(const QString &filepath);
-UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage &res, QString &errorMsg, const QString &format_bar)
+/**
+ * @brief transformationToOrientation
+ * @param transformation
+ * @return int
+ * 将QImageReader读取的变换信息转换为EXIF方向值
+ */
+static int transformationToOrientation(QImageIOHandler::Transformations transformation)
 {
-    qDebug() << "Loading static image from file:" << path;
-    QFileInfo file_info(path);
-    if (file_info.size() == 0) {
-        qWarning() << "Empty file:" << path;
-        res = QImage();
-        errorMsg = "error file!";
-        return false;
+    switch (static_cast<int>(transformation)) {
+    case QImageIOHandler::TransformationMirror:
+        return 2;
+    case QImageIOHandler::TransformationRotate180:
+        return 3;
+    case QImageIOHandler::TransformationFlip:
+        return 4;
+    case QImageIOHandler::TransformationFlipAndRotate90:
+        return 5;
+    case QImageIOHandler::TransformationRotate90:
+        return 6;
+    case QImageIOHandler::TransformationMirrorAndRotate90:
+        return 7;
+    case QImageIOHandler::TransformationRotate270:
+        return 8;
+    default:
+        return 1;
+    }
+}
+
+QString ImageProbeInfo::readFormat() const
+{
+    if (format.isEmpty() || union_image_private.m_qtSupported.contains(suffix)) {
+        return suffix;
+    }
+    return format;
+}
+
+/**
+ * @brief probeDevice
+ * @param device        已打开的文件设备
+ * @param info          需已填充path和suffix
+ * 预读文件头检测真实格式，并在同一设备上读取尺寸、帧数和方向，不解码像素数据
+ */
+static void probeDevice(QIODevice *device, ImageProbeInfo &info)
+{
+    info.fileSize = device->size();
+    // peek不移动读取位置，后续QImageReader复用同一设备
+    info.format = DetectImageFormat(device).toUpper();
+
+    // JPEG/TIFF类文件直接解析文件头中的EXIF方向，其余格式使用Qt插件提供的变换信息
+    ExifData exif;
+    const bool hasExif = readExifData(device, exif);
+    device->seek(0);
+
+    QImageReader reader(device, info.readFormat().toLower().toLatin1());
+    info.size = reader.size();
+    info.frameCount = reader.imageCount();
+    info.orientation = hasExif ? exif.orientation : transformationToOrientation(reader.transformation());
+
+    //解决bug57394 【专业版1031】【看图】【5.6.3.74】【修改引入】pic格式图片变为翻页状态，不为动图且首张显示序号为0
+    // 分类按真实格式判断，后缀错误的动图仍识别为动图
+    const QString fmt = info.format.isEmpty() ? info.suffix : info.format;
+    if (info.format == "SVG"
+            || (info.format.isEmpty() && info.suffix == "SVG" && QSvgRenderer().load(info.path))) {
+        info.imageType = imageViewerSpace::ImageTypeSvg;
+    } else if (fmt == "MNG"
+               || ((fmt == "GIF" || fmt == "WEBP") && info.frameCount > 1)) {
+        info.imageType = imageViewerSpace::ImageTypeDynamic;
+    } else if (info.frameCount > 1) {
+        info.imageType = imageViewerSpace::ImageTypeMulti;
+    } else if (!info.format.isEmpty()
+               || info.size.isValid()
+               || union_image_private.m_qtSupported.contains(info.suffix)) {
+        info.imageType = imageViewerSpace::ImageTypeStatic;
     }
+}
 
-    QMap<QString, QString> dataMap = getAllMetaData(path);
-    QString file_suffix_upper = dataMap.value("FileFormat").toUpper();
-    qDebug() << "File format:" << file_suffix_upper;
+UNIONIMAGESHARED_EXPORT ImageProbeInfo probeImage(const QString &path)
+{
+    ImageProbeInfo info;
+    info.path = path;
+    info.suffix = QFileInfo(path).suffix().toUpper();
+    if (path.isEmpty()) {
+        return info;
+    }
 
-    QByteArray temp_path;
-    temp_path.append(path.toUtf8());
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        qWarning() << "Failed to open file for probing:" << path;
+        return info;
+    }
+    probeDevice(&file, info);
+    qDebug() << "Probed image:" << path << "format:" << info.format << "size:" << info.size
+             << "frames:" << info.frameCount << "type:" << info.imageType;
+    return info;
+}
 
-    QString file_suffix_lower = file_suffix_upper.toLower();
+// 解码被取消时的错误信息
+const QString DECODE_CANCELLED = "decode cancelled";
 
-    if (union_image_private.m_qtSupported.contains(file_suffix_upper)) {
-        QImageReader reader;
+/**
+ * @brief scaledDecodeSize
+ * @return QSize        无需缩小解码时返回无效尺寸
+ * 计算缩小解码使用的尺寸，保持宽高比且不小于targetSize，不放大
+ * JPEG按libjpeg支持的1/2、1/4、1/8比例取整，使解码过程直接输出缩小后的图像
+ */
+static QSize scaledDecodeSize(const ImageProbeInfo &info, const QString &format, const QSize &targetSize)
+{
+    if (!targetSize.isValid() || !info.size.isValid()) {
+        return QSize();
+    }
+    // 缩放尺寸作用于旋转前的存储尺寸，EXIF方向为5~8时宽高互换
+    const QSize target = info.orientation >= 5 ? targetSize.transposed() : targetSize;
+    const QSize scaled = info.size.scaled(target, Qt::KeepAspectRatioByExpanding);
+    if (scaled.width() >= info.size.width() || scaled.height() >= info.size.height()) {
+        return QSize();
+    }
+
+    if (format == "JPG" || format == "JPEG" || format == "JPE") {
+        for (int denom = 8; denom > 1; denom /= 2) {
+            const QSize dctSize(info.size.width() / denom, info.size.height() / denom);
+            if (dctSize.width() >= scaled.width() && dctSize.height() >= scaled.height()) {
+                return dctSize;
+            }
+        }
+        return QSize();
+    }
+    return scaled;
+}
+
+/**
+ * @brief jumpToBestImage
+ * ICO/ICNS包含多个尺寸的图标，选择不小于targetSize的最小项，均小于时选择最大项
+ */
+static void jumpToBestImage(QImageReader &reader, const QSize &targetSize)
+{
+    const int count = reader.imageCount();
+    if (count <= 1) {
+        return;
+    }
+
+    int bestIndex = -1;
+    qint64 bestArea = 0;
+    int largestIndex = 0;
+    qint64 largestArea = 0;
+    for (int i = 0; i < count; ++i) {
+        if (!reader.jumpToImage(i)) {
+            continue;
+        }
+        const QSize size = reader.size();
+        const qint64 area = static_cast<qint64>(size.width()) * size.height();
+        if (area > largestArea) {
+            largestArea = area;
+            largestIndex = i;
+        }
+        if (size.width() >= targetSize.width() && size.height() >= targetSize.height()
+                && (bestIndex < 0 || area < bestArea)) {
+            bestArea = area;
+            bestIndex = i;
+        }
+    }
+    reader.jumpToImage(bestIndex >= 0 ? bestIndex : largestIndex);
+}
+
+/**
+ * @brief shrinkToTargetSize
+ * 不支持缩小解码的读取方式，解码后缩小到不小于targetSize
+ */
+static QImage shrinkToTargetSize(const QImage &image, const QSize &targetSize)
+{
+    if (!targetSize.isValid() || image.isNull()) {
+        return image;
+    }
+    const QSize scaled = image.size().scaled(targetSize, Qt::KeepAspectRatioByExpanding);
+    if (scaled.width() >= image.width() || scaled.height() >= image.height()) {
+        return image;
+    }
+    return image.scaled(scaled, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+}
+
+/**
+ * @brief loadStaticImageFromDevice
+ * 从已打开并完成探测的设备中解码图片，失败时依次尝试内容识别、QImage直接读取和TIF转换
+ */
+static bool loadStaticImageFromDevice(QIODevice *device, const ImageProbeInfo &info, QImage &res, QString &errorMsg, const QString &format_bar, const QSize &targetSize,
+                                      const DecodeCancelTokenPtr &cancelToken)
+{
+    const QString &path = info.path;
+    const QString &file_suffix_upper = info.suffix;
+    qDebug() << "File format:" << file_suffix_upper << "detected format:" << info.format;
+
+    if (union_image_private.m_qtSupported.contains(file_suffix_upper)
+            || union_image_private.m_qtSupported.contains(info.format)) {
+        QImageReader reader(device);
         QImage res_qt;
-        reader.setFileName(path);
         if (format_bar.isEmpty()) {
-            reader.setFormat(file_suffix_lower.toLatin1());
+            reader.setFormat(info.readFormat().toLower().toLatin1());
         } else {
             reader.setFormat(format_bar.toLatin1());
         }
         reader.setAutoTransform(true);
-        
-        if (reader.imageCount() > 0 || file_suffix_upper != "ICNS") {
+
+        if (targetSize.isValid()) {
+            const QString readFormat = QString::fromLatin1(reader.format()).toUpper();
+            if (readFormat == "ICO" || readFormat == "ICNS") {
+                jumpToBestImage(reader, targetSize);
+            } else {
+                const QSize decodeSize = scaledDecodeSize(info, readFormat, targetSize);
+                if (decodeSize.isValid()) {
+                    reader.setScaledSize(decodeSize);
+                }
+            }
+        }
+
+        if (info.frameCount > 0 || file_suffix_upper != "ICNS") {
+            // Qt插件的解码无法中断，只在开始前检查取消标记
+            if (isDecodeCancelled(cancelToken)) {
+                errorMsg = DECODE_CANCELLED;
+                res = QImage();
+                return false;
+            }
             res_qt = reader.read();
-            if (res_qt.isNull()) {
+            if (res_qt.isNull() && !isDecodeCancelled(cancelToken)) {
                 qWarning() << "Failed to read image with QImageReader, trying alternative method";
                 //try old loading method
-                QString format = PrivateDetectImageFormat(path);
-                QImageReader readerF(path, format.toLatin1());
+                device->seek(0);
+                QImageReader readerF(device);
                 QImage try_res;
                 readerF.setAutoTransform(true);
                 if (readerF.canRead()) {
                     try_res = readerF.read();
                 } else {
-                    errorMsg = "can't read image:" + readerF.errorString() + format;
+                    errorMsg = "can't read image:" + readerF.errorString() + info.format;
                     qWarning() << errorMsg;
                     try_res = QImage(path);
                 }
 
-                // 单独处理TIF格式情况
-                if (try_res.isNull() && (file_suffix_upper == "TIF" || file_suffix_upper == "TIFF")) {
-                    // 读取失败，tif需要单独处理，尝试通过转换函数处理
-                    qDebug() << "Processing TIFF format with special handling";
-                    QFileInfo imageFile(path);
-                    QString cacheFile = Libutils::image::getCacheImagePath() + QDir::separator() + imageFile.fileName();
-                    // 判断是否存在缓存图片数据
-                    if (Libutils::image::checkCacheImage(imageFile.fileName())) {
-                        qDebug() << "Using cached TIFF image";
-                        try_res = QImage(cacheFile);
-                    } else {
-                        // 由于多线程调用，可能同时访问文件，使用临时文件处理，防止部分线程读取未转码完成的图片文件
-                        QString tempFile = Libutils::image::getCacheImagePath() + QDir::separator()
-                                + QUuid::createUuid().toString() + imageFile.fileName();
-                        qDebug() << "Converting TIFF image:" << imageFile.absoluteFilePath() << "to" << tempFile;
-
-                        // 转换图像编码格式
-                        int nRet = convertOldStyleImage(imageFile.absoluteFilePath().toUtf8().data(), tempFile.toUtf8().data());
-                        // 转换成功标识
-                        static const int s_nFlagSucc = 0;
-                        if (s_nFlagSucc == nRet) {
-                            if (QFile::exists(tempFile)) {
-                                try_res = QImage(tempFile);
-
-                                // 判断缓存文件是否已存在，保存缓存数据
-                                if (QFile::exists(cacheFile)) {
-                                    QFile::remove(tempFile);
-                                } else {
-                                    QFile::rename(tempFile, cacheFile);
-                                }
-                            }
-                        } else {
-                            qWarning() << "Failed to convert TIFF image, error code:" << nRet;
-                        }
+                // 单独处理TIF格式情况，旧式压缩等Qt插件无法读取时使用libtiff在进程内解码
+                if (try_res.isNull() && (file_suffix_upper == "TIF" || file_suffix_upper == "TIFF" || info.format == "TIFF")) {
+                    qDebug() << "Processing TIFF format with libtiff";
+                    QString tiffError;
+                    if (!loadTiffImageCached(path, try_res, tiffError, cancelToken)) {
+                        qWarning() << "Failed to decode TIFF image:" << tiffError;
                     }
                 }
 
+                if (try_res.isNull() && isDecodeCancelled(cancelToken)) {
+                    errorMsg = DECODE_CANCELLED;
+                    res = QImage();
+                    return false;
+                }
                 if (try_res.isNull()) {
                     errorMsg = "load image by qt failed, use format:" + reader.format() + " ,path:" + path;
                     qWarning() << errorMsg;
@@ -334,11 +498,11 @@ UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage
                     return false;
                 }
                 errorMsg = "use old method to load QImage";
-                res = try_res;
+                res = shrinkToTargetSize(try_res, targetSize);
                 return true;
             }
             errorMsg = "use QImage";
-            res = res_qt;
+            res = shrinkToTargetSize(res_qt, targetSize);
         } else {
             qWarning() << "No images found in file:" << path;
             res = QImage();
@@ -350,100 +514,51 @@ UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage
     return false;
 }
 
-UNIONIMAGESHARED_EXPORT QString detectImageFormat(const QString &path)
+/**
+ * @brief loadStaticImageFromPath
+ * 打开一次文件，探测信息为空时在同一设备上完成探测，随后回到文件头解码
+ */
+static bool loadStaticImageFromPath(const QString &path, QImage &res, QString &errorMsg, const QString &format_bar, const ImageProbeInfo *probeInfo, const QSize &targetSize,
+                                    const DecodeCancelTokenPtr &cancelToken)
 {
-    QFileInfo file_info(path);
-    QString file_suffix_upper = file_info.suffix().toUpper();
-    QString res = file_suffix_upper;
-    if (res.isEmpty()) {
-        QFile file(path);
-        if (!file.open(QIODevice::ReadOnly)) {
-            return "";
-        }
-
-        //    const QByteArray data = file.read(1024);
-        const QByteArray data = file.read(64);
-
-        // Check bmp file.
-        if (data.startsWith("BM")) {
-            return "BMP";
-        }
-
-        // Check dds file.
-        if (data.startsWith("DDS")) {
-            return "DDS";
-        }
-
-        // Check gif file.
-        if (data.startsWith("GIF8")) {
-            return "GIF";
-        }
-
-        // Check Max OS icons file.
-        if (data.startsWith("icns")) {
-            return "ICNS";
-        }
-
-        // Check jpeg file.
-        if (data.startsWith("\xff\xd8")) {
-            return "JPG";
-        }
-
-        // Check mng file.
-        if (data.startsWith("\x8a\x4d\x4e\x47\x0d\x0a\x1a\x0a")) {
-            return "MNG";
-        }
-
-        // Check net pbm file (BitMap).
-        if (data.startsWith("P1") || data.startsWith("P4")) {
-            return "PBM";
-        }
-
-        // Check pgm file (GrayMap).
-        if (data.startsWith("P2") || data.startsWith("P5")) {
-            return "PGM";
-        }
-
-        // Check ppm file (PixMap).
-        if (data.startsWith("P3") || data.startsWith("P6")) {
-            return "PPM";
-        }
-
-        // Check png file.
-        if (data.startsWith("\x89PNG\x0d\x0a\x1a\x0a")) {
-            return "PNG";
-        }
-
-        // Check svg file.
-        if (data.indexOf("<svg") > -1) {
-            return "SVG";
-        }
-
-        // TODO(xushaohua): tga file is not supported yet.
+    qDebug() << "Loading static image from file:" << path;
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly) || file.size() == 0) {
+        qWarning() << "Empty file:" << path;
+        res = QImage();
+        errorMsg = "error file!";
+        return false;
+    }
 
-        // Check tiff file.
-        if (data.startsWith("MM\x00\x2a") || data.startsWith("II\x2a\x00")) {
-            // big-endian, little-endian.
-            return "TIFF";
-        }
+    if (probeInfo && !probeInfo->path.isEmpty()) {
+        return loadStaticImageFromDevice(&file, *probeInfo, res, errorMsg, format_bar, targetSize, cancelToken);
+    }
 
-        // TODO(xushaohua): Support wbmp file.
+    ImageProbeInfo info;
+    info.path = path;
+    info.suffix = QFileInfo(path).suffix().toUpper();
+    probeDevice(&file, info);
+    file.seek(0);
+    return loadStaticImageFromDevice(&file, info, res, errorMsg, format_bar, targetSize, cancelToken);
+}
 
-        // Check webp file.
-        if (data.startsWith("RIFFr\x00\x00\x00WEBPVP")) {
-            return "WEBP";
-        }
+UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage &res, QString &errorMsg, const QString &format_bar, const QSize &targetSize)
+{
+    return loadStaticImageFromPath(path, res, errorMsg, format_bar, nullptr, targetSize, DecodeCancelTokenPtr());
+}
 
-        // Check xbm file.
-        if (data.indexOf("#define max_width ") > -1 && data.indexOf("#define max_height ") > -1) {
-            return "XBM";
-        }
+UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage &res, QString &errorMsg, const ImageProbeInfo &probeInfo, const QSize &targetSize,
+                                                     const DecodeCancelTokenPtr &cancelToken)
+{
+    return loadStaticImageFromPath(path, res, errorMsg, QString(), &probeInfo, targetSize, cancelToken);
+}
 
-        // Check xpm file.
-        if (data.startsWith("/* XPM */")) {
-            return "XPM";
-        }
-        return "";
+UNIONIMAGESHARED_EXPORT QString detectImageFormat(const QString &path)
+{
+    QFileInfo file_info(path);
+    QString res = file_info.suffix().toUpper();
+    if (res.isEmpty()) {
+        return DetectImageFormat(path).toUpper();
     }
     return res;
 }
@@ -456,60 +571,32 @@ UNIONIMAGESHARED_EXPORT bool isNoneQImage(const QImage &qi)
 UNIONIMAGESHARED_EXPORT bool rotateImage(int angel, QImage &image)
 {
     qDebug() << "Rotating image by" << angel << "degrees";
-    if (angel % 90 != 0) {
-        qWarning() << "Unsupported rotation angle:" << angel;
-        return false;
-    }
     if (image.isNull()) {
         qWarning() << "Cannot rotate null image";
         return false;
     }
-    QImage image_copy(image);
-    if (!image_copy.isNull()) {
+    // 90度倍数的旋转为像素搬移，无需插值，其余角度仍按QTransform插值旋转
+    QImage rotated;
+    if (angel % 90 == 0) {
+        rotated = rotateImageOrthogonal(image, angel);
+    } else {
         QTransform rotatematrix;
         rotatematrix.rotate(angel);
-        image = image_copy.transformed(rotatematrix, Qt::SmoothTransformation);
+        rotated = image.transformed(rotatematrix, Qt::SmoothTransformation);
+    }
+    if (!rotated.isNull()) {
+        image = rotated;
         qDebug() << "Image rotated successfully";
         return true;
     }
-    qWarning() << "Failed to create image copy for rotation";
+    qWarning() << "Failed to create image for rotation";
     return false;
 }
 
 QImage adjustImageToRealPosition(const QImage &image, int orientation)
 {
-    QImage result = image;
-
-    switch (orientation) {
-    case 1:   //不做操作
-    default:
-        break;
-    case 2:   //水平翻转
-        result = result.mirrored(true, false);
-        break;
-    case 3:   //180度翻转
-        rotateImage(180, result);
-        break;
-    case 4:   //垂直翻转
-        result = result.mirrored(false, true);
-        break;
-    case 5:   //顺时针90度+水平翻转
-        rotateImage(90, result);
-        result = result.mirrored(true, false);
-        break;
-    case 6:   //顺时针90度
-        rotateImage(90, result);
-        break;
-    case 7:   //顺时针90度+垂直翻转
-        rotateImage(90, result);
-        result = result.mirrored(false, true);
-        break;
-    case 8:   //逆时针90度
-        rotateImage(-90, result);
-        break;
-    };
-
-    return result;
+    //按EXIF方向一次变换到目标图像，不再先旋转再镜像
+    return orientImage(image, orientation);
 }
 
 UNIONIMAGESHARED_EXPORT bool rotateImageFIle(int angel, const QString &path, QString &erroMsg)
@@ -531,8 +618,15 @@ UNIONIMAGESHARED_EXPORT bool rotateImageFIle(int angel, const QString &path, QSt
             qWarning() << erroMsg;
             return false;
         }
+        //先写入临时文件再替换，写入过程中其他读取者看到的始终是完整文件
+        QSaveFile saveFile(path);
+        if (!saveFile.open(QIODevice::WriteOnly)) {
+            erroMsg = "rotate open file failed, path:" + path;
+            qWarning() << erroMsg;
+            return false;
+        }
         QSvgGenerator generator;
-        generator.setFileName(path);
+        generator.setOutputDevice(&saveFile);
         generator.setViewBox(QRect(0, 0, image_copy.width(), image_copy.height()));
         QPainter rotatePainter;
         rotatePainter.begin(&generator);
@@ -554,21 +648,32 @@ UNIONIMAGESHARED_EXPORT bool rotateImageFIle(int angel, const QString &path, QSt
         rotatePainter.resetTransform();
         generator.setSize(QSize(image_copy.width(), image_copy.height()));
         rotatePainter.end();
+        if (!saveFile.commit()) {
+            erroMsg = "rotate save svg failed, path:" + path;
+            qWarning() << erroMsg;
+            return false;
+        }
         qDebug() << "SVG rotation completed successfully";
         return true;
+    } else if ((format == "JPG" || format == "JPEG")
+               && transformJpegFileLossless(path, orientationAfterRotation(getOrientation(path), angel), erroMsg)) {
+        //JPEG在DCT域无损旋转，保留EXIF等元数据，失败时回退到解码后重新编码
+        qDebug() << "Lossless JPEG rotation completed successfully";
+        return true;
     } else if (union_image_private.m_qtrotate.contains(format)) {
         //由于Qt内部不会去读图片的EXIF信息来判断当前的图像矩阵的真实位置，同时回写数据的时候会丢失全部的EXIF数据
         qDebug() << "Processing standard image rotation";
         int orientation = getOrientation(path);
         QImage image_copy(path);
-        image_copy = adjustImageToRealPosition(image_copy, orientation);
+        // 方向校正与旋转合并为一次正交变换
+        image_copy = adjustImageToRealPosition(image_copy, orientationAfterRotation(orientation, angel));
         if (!image_copy.isNull()) {
-            QTransform rotatematrix;
-            rotatematrix.rotate(angel);
-            image_copy = image_copy.transformed(rotatematrix, Qt::SmoothTransformation);
 
             // 调整图片质量，不再默认使用满质量 SAVE_QUAITY_VALUE
-            if (image_copy.save(path, format.toLatin1().data(), -1)) {
+            // 先写入临时文件再替换，写入中断或失败时原文件保持不变
+            QSaveFile saveFile(path);
+            if (saveFile.open(QIODevice::WriteOnly) && image_copy.save(&saveFile, format.toLatin1().data(), -1)
+                    && saveFile.commit()) {
                 qDebug() << "Image rotation and save completed successfully";
                 return true;
             }
@@ -667,6 +772,13 @@ UNIONIMAGESHARED_EXPORT bool isImageSupportRotate(const QString &path)
 UNIONIMAGESHARED_EXPORT int getOrientation(const QString &path)
 {
     int result = 1;   //1代表不做操作，维持原样
+    ExifData exif;
+    if (readExifData(path, exif)) {
+        result = exif.orientation;
+    } else {
+        QImageReader reader(path);
+        result = transformationToOrientation(reader.transformation());
+    }
     return result;
 }
 UNIONIMAGESHARED_EXPORT bool creatNewImage(QImage &res, int width, int height, int depth, SupportType type)
@@ -684,50 +796,8 @@ UNIONIMAGESHARED_EXPORT bool creatNewImage(QImage &res, int width, int height, i
 imageViewerSpace::ImageType getImageType(const QString &imagepath)
 {
     qDebug() << "Getting image type for:" << imagepath;
-    imageViewerSpace::ImageType type = imageViewerSpace::ImageType::ImageTypeBlank;
-    //新增获取图片是属于静态图还是动态图还是多页图
-    if (!imagepath.isEmpty()) {
-        QFileInfo fi(imagepath);
-        QString strType = fi.suffix().toLower();
-        qDebug() << "File suffix:" << strType;
-
-        //解决bug57394 【专业版1031】【看图】【5.6.3.74】【修改引入】pic格式图片变为翻页状态，不为动图且首张显示序号为0
-        QMimeDatabase db;
-        QMimeType mt = db.mimeTypeForFile(imagepath, QMimeDatabase::MatchContent);
-        QMimeType mt1 = db.mimeTypeForFile(imagepath, QMimeDatabase::MatchExtension);
-        QString path1 = mt.name();
-        QString path2 = mt1.name();
-        qDebug() << "MIME types - Content:" << path1 << "Extension:" << path2;
-
-        int nSize = -1;
-        QImageReader imgreader(imagepath);
-        nSize = imgreader.imageCount();
-        qDebug() << "Image count:" << nSize;
-
-        if (strType == "svg" && QSvgRenderer().load(imagepath)) {
-            type = imageViewerSpace::ImageTypeSvg;
-            qDebug() << "Detected SVG image type";
-        } else if ((strType == "mng")
-                   || ((strType == "gif") && nSize > 1)
-                   || (strType == "webp" && nSize > 1)
-                   || ((mt.name().startsWith("image/gif")) && nSize > 1)
-                   || ((mt1.name().startsWith("image/gif")) && nSize > 1)
-                   || ((mt.name().startsWith("video/x-mng")))
-                   || ((mt1.name().startsWith("video/x-mng")))) {
-            type = imageViewerSpace::ImageTypeDynamic;
-            qDebug() << "Detected dynamic image type";
-        } else if (nSize > 1) {
-            type = imageViewerSpace::ImageTypeMulti;
-            qDebug() << "Detected multi-page image type";
-        } else if (mt.name().startsWith("image/")
-                   || mt.name().startsWith("video/x-mng")
-                   || mt1.name().startsWith("image/")
-                   || mt1.name().startsWith("video/x-mng")) {
-            type = imageViewerSpace::ImageTypeStatic;
-            qDebug() << "Detected static image type";
-        }
-    }
-    return type;
+    //新增获取图片是属于静态图还是动态图还是多页图，只打开一次文件读取文件头
+    return probeImage(imagepath).imageType;
 }
 
 imageViewerSpace::PathType getPathType(const QString &imagepath)
@@ -751,95 +821,4 @@ imageViewerSpace::PathType getPathType(const QString &imagepath)
     return type;
 }
 
-QString PrivateDetectImageFormat(const QString &filepath)
-{
-    QFile file(filepath);
-    if (!file.open(QIODevice::ReadOnly)) {
-        return "";
-    }
-
-    const QByteArray data = file.read(1024);
-
-    // Check bmp file.
-    if (data.startsWith("BM")) {
-        return "bmp";
-    }
-
-    // Check dds file.
-    if (data.startsWith("DDS")) {
-        return "dds";
-    }
-
-    // Check gif file.
-    if (data.startsWith("GIF8")) {
-        return "gif";
-    }
-
-    // Check Max OS icons file.
-    if (data.startsWith("icns")) {
-        return "icns";
-    }
-
-    // Check jpeg file.
-    if (data.startsWith("\xff\xd8")) {
-        return "jpg";
-    }
-
-    // Check mng file.
-    if (data.startsWith("\x8a\x4d\x4e\x47\x0d\x0a\x1a\x0a")) {
-        return "mng";
-    }
-
-    // Check net pbm file (BitMap).
-    if (data.startsWith("P1") || data.startsWith("P4")) {
-        return "pbm";
-    }
-
-    // Check pgm file (GrayMap).
-    if (data.startsWith("P2") || data.startsWith("P5")) {
-        return "pgm";
-    }
-
-    // Check ppm file (PixMap).
-    if (data.startsWith("P3") || data.startsWith("P6")) {
-        return "ppm";
-    }
-
-    // Check png file.
-    if (data.startsWith("\x89PNG\x0d\x0a\x1a\x0a")) {
-        return "png";
-    }
-
-    // Check svg file.
-    if (data.indexOf("<svg") > -1) {
-        return "svg";
-    }
-
-    // TODO(xushaohua): tga file is not supported yet.
-
-    // Check tiff file.
-    if (data.startsWith("MM\x00\x2a") || data.startsWith("II\x2a\x00")) {
-        // big-endian, little-endian.
-        return "tiff";
-    }
-
-    // TODO(xushaohua): Support wbmp file.
-
-    // Check webp file.
-    if (data.startsWith("RIFFr\x00\x00\x00WEBPVP")) {
-        return "webp";
-    }
-
-    // Check xbm file.
-    if (data.indexOf("#define max_width ") > -1 && data.indexOf("#define max_height ") > -1) {
-        return "xbm";
-    }
-
-    // Check xpm file.
-    if (data.startsWith("/* XPM */")) {
-        return "xpm";
-    }
-    return "";
-}
-
 };
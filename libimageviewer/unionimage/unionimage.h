@@ -20,6 +20,8 @@
 #include <QFileInfo>
 #include <QStringList>
 #include <QMap>
+#include <QAtomicInt>
+#include <QSharedPointer>
 
 #include "image-viewer_global.h"
 
@@ -41,6 +43,52 @@ enum SupportType {
     RGBAF       = 12    // 128-bit RGBA float image     : 4 x 32-bit IEEE floating point
 };
 
+/**
+ * @brief ImageProbeInfo
+ * 图片探测信息，由 probeImage() 打开一次文件并读取文件头后返回
+ */
+struct UNIONIMAGESHARED_EXPORT ImageProbeInfo {
+    QString path;                   // 文件路径
+    QString suffix;                 // 文件后缀(大写)
+    QString format;                 // 根据文件内容检测的真实格式(大写)，无法检测时为空
+    QSize size;                     // 原图尺寸，无法读取时无效
+    int frameCount = 0;             // 帧数/页数
+    int orientation = 1;            // EXIF方向，1代表不做操作
+    qint64 fileSize = 0;            // 文件大小
+    imageViewerSpace::ImageType imageType = imageViewerSpace::ImageTypeBlank;  // 静态/动态/多页/SVG 分类
+
+    // 用于 QImageReader 的格式，后缀为支持的格式时使用后缀，后缀缺失或不支持时使用真实格式
+    // RAW格式(NEF、DNG、CR2等)内容检测为TIFF，按TIFF解码只能得到内嵌的小预览图
+    QString readFormat() const;
+    // 按EXIF方向校正后的显示尺寸
+    QSize displaySize() const { return orientation >= 5 ? size.transposed() : size; }
+    bool isAnimated() const { return imageViewerSpace::ImageTypeDynamic == imageType; }
+    bool isMultiPage() const { return imageViewerSpace::ImageTypeMulti == imageType; }
+    bool isSvg() const { return imageViewerSpace::ImageTypeSvg == imageType; }
+};
+
+/**
+ * @brief The DecodeCancelToken class
+ * 解码任务的取消标记，发起方可在任意线程调用cancel()
+ * 解码过程在扫描行批次之间检查，取消后尽快返回失败，无法中断的解码在开始前检查
+ */
+class DecodeCancelToken
+{
+public:
+    void cancel() { m_cancelled.storeRelease(1); }
+    bool isCancelled() const { return m_cancelled.loadAcquire() != 0; }
+
+private:
+    QAtomicInt m_cancelled;
+};
+typedef QSharedPointer<DecodeCancelToken> DecodeCancelTokenPtr;
+
+// 空标记视为不取消
+inline bool isDecodeCancelled(const DecodeCancelTokenPtr &token)
+{
+    return token && token->isCancelled();
+}
+
 UNIONIMAGESHARED_EXPORT QString unionImageVersion();
 
 /**
@@ -75,14 +123,41 @@ UNIONIMAGESHARED_EXPORT bool creatNewImage(QImage &res, int width = 0, int heigh
  * @param[in]           path
  * @param[out]          res
  * @param[out]          errorMsg
+ * @param[in]           format_bar
+ * @param[in]           targetSize
  * @return bool
  * @author DJH
  * 从文件载入图片
  * 载入成功返回true，图片数据返回到res
  * 载入失败返回false，如果需要可以读取errorMsg返回错误信息
  * 载入动态图片时，只会返回动态图片的第一帧，如果需要动图请使用UUnionMovieImage
+ * targetSize有效时按缩小尺寸解码，结果保持宽高比且不小于targetSize(原图更小时不放大)，
+ * JPEG使用DCT缩放，ICO/ICNS选择最接近的图标项
+ */
+UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage &res, QString &errorMsg, const QString &format_bar = "", const QSize &targetSize = QSize());
+
+/**
+ * @brief loadStaticImageFromFile
+ * @param[in]           path
+ * @param[out]          res
+ * @param[out]          errorMsg
+ * @param[in]           probeInfo
+ * @param[in]           targetSize
+ * @param[in]           cancelToken
+ * @return bool
+ * 使用已有的探测信息 probeInfo 载入图片，不再重复读取文件头，targetSize含义同上
+ * cancelToken被取消时返回false，errorMsg为"decode cancelled"
+ */
+UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage &res, QString &errorMsg, const ImageProbeInfo &probeInfo, const QSize &targetSize = QSize(),
+                                                     const DecodeCancelTokenPtr &cancelToken = DecodeCancelTokenPtr());
+
+/**
+ * @brief probeImage
+ * @param[in]           path
+ * @return ImageProbeInfo
+ * 打开一次文件，通过一次少量读取获得图片的真实格式、尺寸、帧数、类型和方向
  */
-UNIONIMAGESHARED_EXPORT bool loadStaticImageFromFile(const QString &path, QImage &res, QString &errorMsg, const QString &format_bar = "");
+UNIONIMAGESHARED_EXPORT ImageProbeInfo probeImage(const QString &path);
 
 /**
  * @brief detectImageFormat
@@ -107,7 +182,7 @@ UNIONIMAGESHARED_EXPORT bool isNoneQImage(const QImage &qi);
  * @param[out]          image
  * @return bool
  * @author DJH
- * 在内存中旋转图片
+ * 在内存中旋转图片，90度倍数时直接搬移像素，其余角度插值旋转
  */
 UNIONIMAGESHARED_EXPORT bool rotateImage(int angel, QImage &image);
 
@@ -1,16 +1,28 @@
 HEADERS += \
     $$PWD/baseutils.h \
+    $$PWD/fileidentity.h \
+    $$PWD/imageexif.h \
+    $$PWD/imagetransform.h \
     $$PWD/imageutils_libexif.h \
     $$PWD/imageutils.h \
     $$PWD/imgoperate.h \
     $$PWD/pluginbaseutils.h \
+    $$PWD/progressivedecoder.h \
     $$PWD/snifferimageformat.h \
+    $$PWD/tiffdecoder.h \
+    $$PWD/tiledimagesource.h \
     $$PWD/unionimage.h
 
 SOURCES += \
     $$PWD/baseutils.cpp \
+    $$PWD/fileidentity.cpp \
+    $$PWD/imageexif.cpp \
+    $$PWD/imagetransform.cpp \
     $$PWD/imageutils.cpp \
     $$PWD/imgoperate.cpp \
     $$PWD/pluginbaseutils.cpp \
+    $$PWD/progressivedecoder.cpp \
     $$PWD/snifferimageformat.cpp \
+    $$PWD/tiffdecoder.cpp \
+    $$PWD/tiledimagesource.cpp \
     $$PWD/unionimage.cpp
@@ -180,6 +180,9 @@ imageViewerSpace::ItemInfo LibImgViewDelegate::itemData(const QModelIndex &index
 {
     imageViewerSpace::ItemInfo data = index.data(Qt::DisplayRole).value<imageViewerSpace::ItemInfo>();
     data.isSelected = index.data(Qt::UserRole).toBool();
+    if (data.image.isNull()) {
+        data.image = LibImageDataService::instance()->getThumnailImageByPath(data.path);
+    }
     return data;
 }
 
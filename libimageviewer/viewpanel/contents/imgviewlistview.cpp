@@ -20,6 +20,7 @@
 #include "unionimage/unionimage.h"
 #include "imageengine.h"
 #include "service/commonservice.h"
+#include "service/imagedataservice.h"
 #include "accessibility/ac-desktop-define.h"
 
 LibImgViewListView::LibImgViewListView(QWidget *parent)
@@ -63,6 +64,8 @@ void LibImgViewListView::setAllFile(QList<imageViewerSpace::ItemInfo> itemInfos,
     int count = itemInfos.size();
     for (int i = 0; i < count; i++) {
         imageViewerSpace::ItemInfo info = itemInfos.at(i);
+        // 缩略图由LibThumbnailStore统一缓存，绘制时按路径读取，model中不重复保存
+        info.image = QImage();
         if (info.path == path) {
             info.imgWidth = ITEM_CURRENT_WH;
             info.imgHeight = ITEM_CURRENT_WH;
@@ -265,6 +268,24 @@ int LibImgViewListView::getRowWidth()
     return 2 * (count + 1) + ITEM_NORMAL_WIDTH * count + ITEM_CURRENT_WH - ITEM_NORMAL_WIDTH;
 }
 
+int LibImgViewListView::getRowAtX(int x)
+{
+    const int count = m_model->rowCount();
+    if (count <= 0) {
+        return -1;
+    }
+    // 除当前项外各项宽度相同，直接计算行号，无需逐项查找
+    const int step = ITEM_NORMAL_WIDTH + ITEM_SPACING;
+    int row = x / step;
+    if (m_currentRow >= 0 && m_currentRow < row) {
+        const int currentX = getCurrentItemX();
+        row = x < currentX + ITEM_CURRENT_WH + ITEM_SPACING
+              ? m_currentRow
+              : m_currentRow + 1 + (x - currentX - ITEM_CURRENT_WH - ITEM_SPACING) / step;
+    }
+    return qBound(0, row, count - 1);
+}
+
 void LibImgViewListView::slotOneImgReady(QString path, imageViewerSpace::ItemInfo pix)
 {
     qDebug() << "Image ready for path:" << path;
@@ -274,6 +295,7 @@ void LibImgViewListView::slotOneImgReady(QString path, imageViewerSpace::ItemInf
         if (data.path == path) {
             pix.imgWidth = data.imgWidth;
             pix.imgHeight = data.imgHeight;
+            pix.image = QImage();
 
             // 更新文件信息
             QVariant meta;
@@ -310,11 +332,12 @@ void LibImgViewListView::slotCurrentImgFlush(QPixmap pix, const QSize &originalS
         data.imageType = LibUnionImage_NameSpace::getImageType(data.path);
     }
 
+    LibCommonService::instance()->slotSetImgInfoByPath(data.path, data);
+
+    data.image = QImage();
     QVariant meta;
     meta.setValue(data);
     m_model->setData(currentIndex, meta, Qt::DisplayRole);
-
-    LibCommonService::instance()->slotSetImgInfoByPath(data.path, data);
     this->update(currentIndex);
     this->viewport()->update();
 }
@@ -387,7 +410,7 @@ void LibImgViewListView::loadFiftyRight()
         count++;
         QModelIndex indexImg = m_model->index(i, 0);
         imageViewerSpace::ItemInfo infoImg = indexImg.data(Qt::DisplayRole).value<imageViewerSpace::ItemInfo>();
-        if (infoImg.image.isNull()) {
+        if (!LibImageDataService::instance()->imageIsLoaded(infoImg.path)) {
             qDebug() << "Loading thumbnail for image at index:" << i;
         }
         if (count == 50) {
@@ -60,6 +60,9 @@ public:
     //获得当前item的x位置
     int getRowWidth();
 
+    //获得列表中x位置所在的行
+    int getRowAtX(int x);
+
 //protected:
 //    void mousePressEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
 //    void mouseMoveEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
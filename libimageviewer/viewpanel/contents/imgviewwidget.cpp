@@ -43,6 +43,7 @@ MyImageListWidget::MyImageListWidget(QWidget *parent)
     m_listview = new LibImgViewListView(this);
     m_listview->setObjectName("ImgViewListView");
     m_listview->viewport()->installEventFilter(this);
+    m_listview->installEventFilter(this);
     // 设置一个可以放置的高度
     m_listview->viewport()->setFixedHeight(90);
     qDebug() << "ListView initialized with fixed height:" << m_listview->viewport()->height();
@@ -68,6 +69,14 @@ MyImageListWidget::MyImageListWidget(QWidget *parent)
 
 bool MyImageListWidget::eventFilter(QObject *obj, QEvent *e)
 {
+    // 列表在本控件内移动显示，位置或大小变化时可见范围随之变化
+    if (obj == m_listview) {
+        if (e->type() == QEvent::Move || e->type() == QEvent::Resize) {
+            updateVisibleRange();
+        }
+        return QWidget::eventFilter(obj, e);
+    }
+
     if (e->type() == QEvent::Leave) {
         qDebug() << "Mouse leave event on object:" << obj;
     }
@@ -206,6 +215,7 @@ void MyImageListWidget::resizeEvent(QResizeEvent *event)
 {
     // resize之后需要重新找到中心点
     moveCenterWidget();
+    updateVisibleRange();
     Q_UNUSED(event);
 }
 MyImageListWidget::~MyImageListWidget()
@@ -248,6 +258,7 @@ imageViewerSpace::ItemInfo MyImageListWidget::getCurrentImgInfo()
     {
         QModelIndex indexImg = m_listview->m_model->index(m_listview->m_currentRow, 0);
         infoImg = indexImg.data(Qt::DisplayRole).value<imageViewerSpace::ItemInfo>();
+        infoImg.image = LibImageDataService::instance()->getThumnailImageByPath(infoImg.path);
     }
     return infoImg;
 }
@@ -467,6 +478,17 @@ void MyImageListWidget::moveCenterWidget()
     m_listview->move(m_listview->x() + moveX, m_listview->y());
 }
 
+void MyImageListWidget::updateVisibleRange()
+{
+    if (m_listview->m_model->rowCount() <= 0) {
+        return;
+    }
+    // 本控件的显示范围换算到列表坐标
+    const int left = qMax(0, -m_listview->x());
+    const int right = qMax(left, width() - m_listview->x());
+    LibImageDataService::instance()->setVisibleRange(m_listview->getRowAtX(left), m_listview->getRowAtX(right));
+}
+
 void MyImageListWidget::onScrollBarValueChanged(int value)
 {
     QModelIndex index = m_listview->indexAt(QPoint((m_listview->width() - 15), 10));
@@ -66,6 +66,8 @@ signals:
     void openImg(int index, QString path);
 private:
     void resetSelectImg();
+    //将列表在本控件中显示的范围同步给缩略图读取
+    void updateVisibleRange();
 protected:
     bool eventFilter(QObject *obj, QEvent *e) Q_DECL_OVERRIDE;
     void mousePressEvent(QMouseEvent *event) Q_DECL_OVERRIDE;
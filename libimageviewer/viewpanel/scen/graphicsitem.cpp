@@ -3,14 +3,28 @@
 // SPDX-License-Identifier: GPL-3.0-or-later
 
 #include "graphicsitem.h"
+#include "tileloader.h"
+#include "service/taskscheduler.h"
+#include "unionimage/imagetransform.h"
 
 #include <QDebug>
 #include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QWidget>
 
 #include <DGuiApplicationHelper>
 
 DGUI_USE_NAMESPACE
 
+namespace {
+
+// 长边不小于该值的图片才生成多级图片
+const int MIPMAP_MIN_SIZE = 2048;
+// 多级图片的最小一级长边不小于该值
+const int MIPMAP_SMALLEST_SIZE = 512;
+
+}
+
 LibGraphicsMovieItem::LibGraphicsMovieItem(const QString &fileName, const QString &suffix, QGraphicsItem *parent)
     : QGraphicsPixmapItem(fileName, parent)
 {
@@ -82,47 +96,343 @@ LibGraphicsPixmapItem::~LibGraphicsPixmapItem()
 {
     qDebug() << "Destroying LibGraphicsPixmapItem";
     prepareGeometryChange();
+    delete m_tileLoader;
+    m_tileLoader = nullptr;
+    if (m_mipmapWatcher) {
+        m_mipmapWatcher->cancel();
+        delete m_mipmapWatcher;
+        m_mipmapWatcher = nullptr;
+    }
+    if (m_refineWatcher) {
+        m_refineWatcher->cancel();
+        delete m_refineWatcher;
+        m_refineWatcher = nullptr;
+    }
 }
 
 void LibGraphicsPixmapItem::setPixmap(const QPixmap &pixmap)
 {
     qDebug() << "Setting new pixmap with size:" << pixmap.size();
-    cachePixmap = qMakePair(cachePixmap.first, pixmap);
+    clearTiledSource();
+    cachePixmap = qMakePair(QTransform(), QPixmap());
+    if (m_refineWatcher) {
+        m_refineWatcher->cancel();
+    }
     QGraphicsPixmapItem::setPixmap(pixmap);
+    resetMipmaps();
+}
+
+void LibGraphicsPixmapItem::resetMipmaps()
+{
+    m_mipmaps.clear();
+    m_mipmapsRequested = false;
+    if (m_mipmapWatcher) {
+        m_mipmapWatcher->cancel();
+    }
+}
+
+void LibGraphicsPixmapItem::buildMipmaps()
+{
+    // 每张图片只生成一次，分块模式的预览图随后会切换为分块绘制，不生成
+    if (m_mipmapsRequested || m_tileLoader) {
+        return;
+    }
+    m_mipmapsRequested = true;
+
+    const QPixmap source = pixmap();
+    if (qMax(source.width(), source.height()) < MIPMAP_MIN_SIZE) {
+        return;
+    }
+
+    if (!m_mipmapWatcher) {
+        m_mipmapWatcher = new QFutureWatcher<QVector<QImage>>();
+        QObject::connect(m_mipmapWatcher, &QFutureWatcherBase::finished, [this]() {
+            if (m_mipmapWatcher->isCanceled()) {
+                return;
+            }
+            const QVector<QImage> levels = m_mipmapWatcher->result();
+            // 生成期间图片已被替换时丢弃
+            if (levels.isEmpty() || levels.first().size() != QSize(qMax(1, pixmap().width() / 2), qMax(1, pixmap().height() / 2))) {
+                return;
+            }
+            m_mipmaps.clear();
+            for (const QImage &level : levels) {
+                m_mipmaps.append(QPixmap::fromImage(level));
+            }
+            cachePixmap = qMakePair(QTransform(), QPixmap());
+            qDebug() << "Mipmaps ready, levels:" << m_mipmaps.size();
+            update();
+        });
+    }
+
+    const QImage image = source.toImage();
+    m_mipmapWatcher->setFuture(LibTaskScheduler::instance()->run(LibTaskScheduler::VisibleImage, [image]() {
+        QVector<QImage> levels;
+        QImage level = image;
+        while (qMax(level.width(), level.height()) / 2 >= MIPMAP_SMALLEST_SIZE) {
+            level = LibUnionImage_NameSpace::halveImage(level);
+            if (level.isNull()) {
+                break;
+            }
+            levels.append(level);
+        }
+        return levels;
+    }));
+}
+
+QPixmap LibGraphicsPixmapItem::mipmapForScale(qreal scale, int &level) const
+{
+    level = 0;
+    while (level < m_mipmaps.size() && scale <= 1.0 / (2 << level)) {
+        ++level;
+    }
+    return level == 0 ? pixmap() : m_mipmaps.at(level - 1);
+}
+
+void LibGraphicsPixmapItem::setTiledSource(const QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> &source)
+{
+    clearTiledSource();
+    if (source.isNull()) {
+        return;
+    }
+
+    qDebug() << "Entering tiled mode, image size:" << source->size() << "preview size:" << pixmap().size();
+    prepareGeometryChange();
+    //分块模式不使用多级图片
+    resetMipmaps();
+    m_tileLoader = new LibTileLoader(source);
+    QObject::connect(m_tileLoader, &LibTileLoader::tileReady, [this](const QRect &sourceRect) {
+        //原图坐标换算为图元坐标后只刷新该分块
+        const QRectF bounds = boundingRect();
+        const qreal ratio = bounds.width() / imageSize().width();
+        update(QRectF(bounds.x() + sourceRect.x() * ratio, bounds.y() + sourceRect.y() * ratio,
+                      sourceRect.width() * ratio, sourceRect.height() * ratio));
+    });
+}
+
+bool LibGraphicsPixmapItem::isTiled() const
+{
+    return m_tileLoader != nullptr;
+}
+
+QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> LibGraphicsPixmapItem::tiledSource() const
+{
+    return m_tileLoader ? m_tileLoader->source() : QSharedPointer<LibUnionImage_NameSpace::TiledImageSource>();
+}
+
+QSize LibGraphicsPixmapItem::imageSize() const
+{
+    return m_tileLoader ? m_tileLoader->source()->size() : pixmap().size();
+}
+
+QRectF LibGraphicsPixmapItem::boundingRect() const
+{
+    if (!m_tileLoader) {
+        return QGraphicsPixmapItem::boundingRect();
+    }
+    //分块模式下图元大小为原图大小，预览图拉伸绘制
+    return QRectF(offset(), QSizeF(m_tileLoader->source()->size()) / pixmap().devicePixelRatioF());
+}
+
+QPainterPath LibGraphicsPixmapItem::shape() const
+{
+    if (!m_tileLoader) {
+        return QGraphicsPixmapItem::shape();
+    }
+    QPainterPath path;
+    path.addRect(boundingRect());
+    return path;
+}
+
+bool LibGraphicsPixmapItem::contains(const QPointF &point) const
+{
+    return m_tileLoader ? boundingRect().contains(point) : QGraphicsPixmapItem::contains(point);
+}
+
+void LibGraphicsPixmapItem::clearTiledSource()
+{
+    if (!m_tileLoader) {
+        return;
+    }
+    qDebug() << "Leaving tiled mode";
+    prepareGeometryChange();
+    delete m_tileLoader;
+    m_tileLoader = nullptr;
+}
+
+void LibGraphicsPixmapItem::paintTiles(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
+{
+    const QRectF bounds = boundingRect();
+    const QSize size = m_tileLoader->source()->size();
+    painter->setRenderHint(QPainter::SmoothPixmapTransform, (transformationMode() == Qt::SmoothTransformation));
+    //预览图铺满整张图片作为底图，分块未就绪时显示预览
+    painter->drawPixmap(bounds, pixmap(), QRectF(pixmap().rect()));
+
+    //原图像素到设备像素的缩放比，不超过预览图的精度时无需分块
+    const qreal imageRatio = size.width() / bounds.width();
+    const qreal scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform())
+                        * painter->device()->devicePixelRatioF() / imageRatio;
+    const qreal previewScale = qreal(pixmap().width()) / size.width();
+    if (scale <= previewScale) {
+        m_tileLoader->setWantedTiles(QList<quint64>());
+        return;
+    }
+
+    //选择分辨率不低于显示所需的最粗一级分块
+    int level = 0;
+    while (level < m_tileLoader->maxLevel() && scale <= 1.0 / (2 << level)) {
+        ++level;
+    }
+
+    //按视口可见区域选择分块，局部刷新时的exposedRect不能代表需要的分块
+    QRectF visible = option->exposedRect;
+    if (widget) {
+        visible = painter->worldTransform().inverted().mapRect(QRectF(widget->rect()));
+    }
+    visible &= bounds;
+    const QRect sourceRect = QRectF((visible.x() - bounds.x()) * imageRatio, (visible.y() - bounds.y()) * imageRatio,
+                                    visible.width() * imageRatio, visible.height() * imageRatio).toAlignedRect()
+                             & QRect(QPoint(0, 0), size);
+    if (sourceRect.isEmpty()) {
+        m_tileLoader->setWantedTiles(QList<quint64>());
+        return;
+    }
+
+    const int span = m_tileLoader->tileSize() << level;
+    const int x0 = sourceRect.left() / span;
+    const int x1 = sourceRect.right() / span;
+    const int y0 = sourceRect.top() / span;
+    const int y1 = sourceRect.bottom() / span;
+    const int maxX = (size.width() - 1) / span;
+    const int maxY = (size.height() - 1) / span;
+
+    QList<quint64> wanted;
+    for (int y = y0; y <= y1; ++y) {
+        for (int x = x0; x <= x1; ++x) {
+            const QPixmap tile = m_tileLoader->tile(level, x, y);
+            if (tile.isNull()) {
+                wanted.append(LibTileLoader::tileKey(level, x, y));
+                continue;
+            }
+            const QRect rect = m_tileLoader->tileSourceRect(level, x, y);
+            painter->drawPixmap(QRectF(bounds.x() + rect.x() / imageRatio, bounds.y() + rect.y() / imageRatio,
+                                       rect.width() / imageRatio, rect.height() / imageRatio),
+                                tile, QRectF(tile.rect()));
+        }
+    }
+
+    //预取可见区域外一圈分块，平移时减少空白
+    for (int y = qMax(0, y0 - 1); y <= qMin(maxY, y1 + 1); ++y) {
+        for (int x = qMax(0, x0 - 1); x <= qMin(maxX, x1 + 1); ++x) {
+            const bool inside = x >= x0 && x <= x1 && y >= y0 && y <= y1;
+            if (!inside && m_tileLoader->tile(level, x, y).isNull()) {
+                wanted.append(LibTileLoader::tileKey(level, x, y));
+            }
+        }
+    }
+    m_tileLoader->setWantedTiles(wanted);
+}
+
+void LibGraphicsPixmapItem::setZooming(bool zooming)
+{
+    if (m_zooming == zooming) {
+        return;
+    }
+    m_zooming = zooming;
+    //结束交互后重绘，绘制时按最终缩放比请求精细缩放
+    if (!m_zooming) {
+        update();
+    }
+}
+
+bool LibGraphicsPixmapItem::isZooming() const
+{
+    return m_zooming;
+}
+
+void LibGraphicsPixmapItem::requestRefinement(const QPixmap &levelPixmap, int level, const QTransform &transform)
+{
+    if (m_refineWatcher && m_refineWatcher->isRunning() && m_refineTransform == transform) {
+        return;
+    }
+
+    if (!m_refineWatcher) {
+        m_refineWatcher = new QFutureWatcher<QImage>();
+        QObject::connect(m_refineWatcher, &QFutureWatcherBase::finished, [this]() {
+            if (m_refineWatcher->isCanceled()) {
+                return;
+            }
+            const QImage image = m_refineWatcher->result();
+            if (image.isNull()) {
+                return;
+            }
+            //整体替换缓存，下次绘制直接使用
+            cachePixmap = qMakePair(m_refineTransform, QPixmap::fromImage(image));
+            update();
+        });
+    } else {
+        m_refineWatcher->cancel();
+    }
+
+    m_refineTransform = transform;
+    const qreal levelScale = 1 << level;
+    //先放大回原图尺寸再应用绘制时的缩放和旋转
+    const QTransform levelTransform = QTransform::fromScale(levelScale, levelScale) * transform;
+    const QImage source = levelPixmap.toImage();
+    const Qt::TransformationMode mode = transformationMode();
+    m_refineWatcher->setFuture(LibTaskScheduler::instance()->run(LibTaskScheduler::VisibleImage, [source, levelTransform, mode]() {
+        return source.transformed(levelTransform, mode);
+    }));
 }
 
 void LibGraphicsPixmapItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget)
 {
-    const QTransform ts = painter->transform();
+    if (m_tileLoader) {
+        paintTiles(painter, option, widget);
+        return;
+    }
 
-    if (ts.type() == QTransform::TxScale && ts.m11() < 1) {
-        QPixmap currentPixmap = pixmap();
-        if (currentPixmap.width() < 10000 && currentPixmap.height() < 10000) {
-            qDebug() << "Painting scaled pixmap, scale factor:" << ts.m11();
-            painter->setRenderHint(QPainter::SmoothPixmapTransform, (transformationMode() == Qt::SmoothTransformation));
+    const QTransform ts = painter->transform();
+    //去掉平移的部分，图元旋转90度的倍数时同样适用
+    const QTransform linear(ts.m11(), ts.m12(), ts.m21(), ts.m22(), 0, 0);
+    const bool orthogonal = (ts.type() == QTransform::TxScale || ts.type() == QTransform::TxRotate)
+                            && (qFuzzyIsNull(ts.m12()) || qFuzzyIsNull(ts.m11()));
+    const qreal scale = qMax(qAbs(ts.m11()), qAbs(ts.m12()));
 
+    if (orthogonal && scale < 1) {
+        //第一次缩小显示时才生成多级图片，从最接近的一级缩放，每级只需缩放不超过一半
+        buildMipmaps();
+        int level = 0;
+        QPixmap currentPixmap = mipmapForScale(scale, level);
+        if (level > 0 || (currentPixmap.width() < 10000 && currentPixmap.height() < 10000)) {
             Q_UNUSED(option);
             Q_UNUSED(widget);
+            const QRectF itemRect(offset(), QSizeF(pixmap().size()) / pixmap().devicePixelRatioF());
 
-            QPixmap pixmap;
-
-            if (qIsNull(cachePixmap.first - ts.m11())) {
-                qDebug() << "Using cached pixmap";
-                pixmap = cachePixmap.second;
-            } else {
-                qDebug() << "Transforming pixmap for new scale";
-                pixmap = currentPixmap.transformed(painter->transform(), transformationMode());
-                cachePixmap = qMakePair(ts.m11(), pixmap);
+            if (cachePixmap.first == linear && !cachePixmap.second.isNull()) {
+                painter->setRenderHint(QPainter::SmoothPixmapTransform, (transformationMode() == Qt::SmoothTransformation));
+                QPixmap pixmap = cachePixmap.second;
+                pixmap.setDevicePixelRatio(painter->device()->devicePixelRatioF());
+                painter->resetTransform();
+                painter->drawPixmap(ts.mapRect(itemRect).topLeft(), pixmap);
+                painter->setTransform(ts);
+                return;
             }
 
-            pixmap.setDevicePixelRatio(painter->device()->devicePixelRatioF());
-            painter->resetTransform();
-            painter->drawPixmap(offset() + QPointF(ts.dx(), ts.dy()), pixmap);
-            painter->setTransform(ts);
+            //精细缩放的结果未就绪时以快速过滤绘制最接近的一级，缩放交互结束后由后台生成精细结果
+            if (!m_zooming && transformationMode() == Qt::SmoothTransformation) {
+                requestRefinement(currentPixmap, level, linear);
+            }
+            painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+            painter->drawPixmap(itemRect, currentPixmap, QRectF(currentPixmap.rect()));
         } else {
             qWarning() << "Pixmap too large for optimized painting, using default paint method";
             QGraphicsPixmapItem::paint(painter, option, widget);
         }
+    } else if (m_zooming) {
+        //缩放交互中放大显示不做平滑插值
+        painter->setRenderHint(QPainter::SmoothPixmapTransform, false);
+        painter->drawPixmap(offset(), pixmap());
     } else {
         QGraphicsPixmapItem::paint(painter, option, widget);
     }
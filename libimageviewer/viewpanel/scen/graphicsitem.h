@@ -6,9 +6,17 @@
 #define GRAPHICSMOVIEITEM_H
 
 #include <QGraphicsPixmapItem>
+#include <QFutureWatcher>
 #include <QPointer>
 #include <QMovie>
+#include <QSharedPointer>
+#include <QTransform>
+#include <QVector>
 class QMovie;
+class LibTileLoader;
+namespace LibUnionImage_NameSpace {
+class TiledImageSource;
+}
 class LibGraphicsMovieItem : public QGraphicsPixmapItem, QObject
 {
 public:
@@ -28,14 +36,50 @@ public:
     explicit LibGraphicsPixmapItem(const QPixmap &pixmap);
     ~LibGraphicsPixmapItem() override;
 
+    //设置图片会退出分块模式
     void setPixmap(const QPixmap &pixmap);
 
+    //超大图片的分块模式，当前图片作为预览铺满整张原图，放大时按需异步解码可见分块
+    void setTiledSource(const QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> &source);
+    bool isTiled() const;
+    QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> tiledSource() const;
+    //原图尺寸(像素)，非分块模式下为当前图片尺寸
+    QSize imageSize() const;
+
+    //缩放交互期间以快速过滤绘制，结束后在后台生成精细缩放的结果
+    void setZooming(bool zooming);
+    bool isZooming() const;
+
+    QRectF boundingRect() const override;
+    QPainterPath shape() const override;
+    bool contains(const QPointF &point) const override;
+
 protected:
     //自绘函数
     void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget) override;
 
 private:
-    QPair<qreal, QPixmap> cachePixmap;
+    void paintTiles(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget);
+    void clearTiledSource();
+    //第一次缩小绘制时在后台生成逐级减半的多级图片，缩小显示时从最接近的一级缩放
+    void buildMipmaps();
+    //更换图片或进入分块模式时丢弃多级图片并取消生成
+    void resetMipmaps();
+    //返回缩放比不小于scale的最小一级，level为级数，0为原图
+    QPixmap mipmapForScale(qreal scale, int &level) const;
+    //在后台将第level级图片按绘制时的变换平滑缩放，完成后替换缓存
+    void requestRefinement(const QPixmap &levelPixmap, int level, const QTransform &transform);
+
+    //键为绘制时去掉平移的变换
+    QPair<QTransform, QPixmap> cachePixmap;
+    LibTileLoader *m_tileLoader = nullptr;
+    //第i项为原图缩小2^(i+1)倍的图片
+    QVector<QPixmap> m_mipmaps;
+    QFutureWatcher<QVector<QImage>> *m_mipmapWatcher = nullptr;
+    bool m_mipmapsRequested = false;
+    QFutureWatcher<QImage> *m_refineWatcher = nullptr;
+    QTransform m_refineTransform;
+    bool m_zooming = false;
 };
 
 class LibGraphicsMaskItem : public QGraphicsRectItem
@@ -15,7 +15,6 @@
 #include <QGraphicsPixmapItem>
 #include <QGraphicsProxyWidget>
 #include <QPaintEvent>
-#include <QtConcurrent>
 #include <QHBoxLayout>
 #include <qmath.h>
 #include <QScrollBar>
@@ -24,6 +23,8 @@
 #include <QtGlobal>
 #include <QShortcut>
 #include <QApplication>
+#include <QScreen>
+#include <QWindow>
 #include <QNetworkAccessManager>
 #include <QNetworkReply>
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
@@ -38,6 +39,9 @@
 #include "unionimage/baseutils.h"
 #include "unionimage/imageutils.h"
 #include "unionimage/unionimage.h"
+#include "unionimage/imagetransform.h"
+#include "unionimage/tiledimagesource.h"
+#include "unionimage/progressivedecoder.h"
 #include "accessibility/ac-desktop-define.h"
 #include "../contents/morepicfloatwidget.h"
 #include "imageengine.h"
@@ -50,6 +54,9 @@
 
 #include <sys/inotify.h>
 #include "service/commonservice.h"
+#include "service/decodedimagecache.h"
+#include "service/imageprefetcher.h"
+#include "service/taskscheduler.h"
 
 DWIDGET_USE_NAMESPACE
 
@@ -66,15 +73,123 @@ const qreal MIN_SCALE_FACTOR = 0.02;
 const qreal MAX_SCALE_FACTOR = 2.0;
 qreal MIN_SCALE_FACTOR = 0.0;
 #endif
+// 超大图片分块模式下预览图的最大边长
+const int TILED_PREVIEW_SIZE = 2048;
+// 任一边超过该值的已解码图片按内存分块显示，避免整张转为QPixmap
+const int MEMORY_TILED_MIN_EXTENT = 10000;
+// 渐进解码时刷新显示的最小间隔(毫秒)
+const int PROGRESSIVE_UPDATE_INTERVAL = 150;
+// ftp下载期间检查取消标记的间隔(毫秒)
+const int CANCEL_CHECK_INTERVAL = 100;
+// 旋转后生成缩略图时先缩小到的短边长度，避免旋转原图
+const int ROTATED_PREVIEW_SIDE = 400;
+// 缩放停止多久后生成精细缩放的结果(毫秒)
+const int ZOOM_SETTLE_INTERVAL = 100;
+// 无法获取屏幕刷新率时合并输入的帧间隔(毫秒)
+const int DEFAULT_FRAME_INTERVAL = 16;
 
-QVariantList cachePixmap(const QString &path)
+/**
+ * @brief rotatePixmap
+ * 90度倍数的旋转按像素搬移，其余角度使用QTransform插值
+ */
+QPixmap rotatePixmap(const QPixmap &pixmap, int angle, Qt::TransformationMode mode)
+{
+    if (angle % 90 == 0) {
+        return QPixmap::fromImage(LibUnionImage_NameSpace::rotateImageOrthogonal(pixmap.toImage(), angle));
+    }
+    QTransform rotate;
+    rotate.rotate(angle);
+    return pixmap.transformed(rotate, mode);
+}
+
+/**
+ * @brief rotatedPreview
+ * 先缩小再旋转，用于图元旋转后生成缩略图
+ */
+QPixmap rotatedPreview(const QPixmap &pixmap, int angle)
+{
+    QPixmap preview = pixmap;
+    if (qMin(pixmap.width(), pixmap.height()) > ROTATED_PREVIEW_SIDE) {
+        preview = pixmap.scaled(QSize(ROTATED_PREVIEW_SIDE, ROTATED_PREVIEW_SIDE), Qt::KeepAspectRatioByExpanding, Qt::FastTransformation);
+    }
+    return angle % 360 ? rotatePixmap(preview, angle, Qt::FastTransformation) : preview;
+}
+
+/**
+ * @brief appendMemoryTiled
+ * 超宽或超高的已解码图片整张转为QPixmap开销大且可能超出X11的尺寸限制，
+ * 改为输出预览图和内存分块源，在后台线程中生成各级图片
+ * 解码缓存中已有分块源时直接复用，否则生成后附加到缓存条目，再次查看时不重新生成各级图片
+ */
+bool appendMemoryTiled(QVariantList &vl, const QString &path, const QImage &image,
+                       QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> source = QSharedPointer<LibUnionImage_NameSpace::TiledImageSource>())
+{
+    if (qMax(image.width(), image.height()) <= MEMORY_TILED_MIN_EXTENT) {
+        return false;
+    }
+    if (source.isNull()) {
+        source = LibUnionImage_NameSpace::TiledImageSource::fromImage(image, path);
+        LibDecodedImageCache::instance()->setTiledSource(path, source);
+    }
+    const QImage preview = source ? source->readPreview(QSize(TILED_PREVIEW_SIZE, TILED_PREVIEW_SIZE)) : QImage();
+    if (preview.isNull()) {
+        return false;
+    }
+    qDebug() << "Using memory tiled mode for:" << path << image.size();
+    vl << QVariant(QPixmap::fromImage(preview)) << QVariant::fromValue(source);
+    return true;
+}
+
+QVariantList cachePixmap(const QString &path, const LibUnionImage_NameSpace::ProgressiveOptions &options,
+                         const LibUnionImage_NameSpace::ProgressiveCallback &callback)
 {
+    QVariantList vl;
+    vl << QVariant(path);
+    // 已被新的加载请求取代，结果只含路径，不会被使用
+    if (LibUnionImage_NameSpace::isDecodeCancelled(options.cancelToken)) {
+        return vl;
+    }
+
+    // 最近查看过的图片直接使用解码缓存
+    QImage cachedImage;
+    QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> cachedSource;
+    if (LibDecodedImageCache::instance()->find(path, cachedImage, &cachedSource)) {
+        qDebug() << "Using cached decoded image:" << path;
+        if (!appendMemoryTiled(vl, path, cachedImage, cachedSource)) {
+            vl << QVariant(QPixmap::fromImage(cachedImage));
+        }
+        return vl;
+    }
+
+    // 超大图片只解码预览图，放大时由图元按需解码可见分块
+    const LibUnionImage_NameSpace::ImageProbeInfo probeInfo = LibUnionImage_NameSpace::probeImage(path);
+    if (LibUnionImage_NameSpace::TiledImageSource::isHugeImage(probeInfo.displaySize())) {
+        QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> source = LibUnionImage_NameSpace::TiledImageSource::create(probeInfo);
+        if (source) {
+            const QImage preview = source->readPreview(QSize(TILED_PREVIEW_SIZE, TILED_PREVIEW_SIZE));
+            if (!preview.isNull()) {
+                qDebug() << "Using tiled mode for huge image:" << path << source->size();
+                vl << QVariant(QPixmap::fromImage(preview)) << QVariant::fromValue(source);
+                return vl;
+            }
+        }
+    }
+
     QImage tImg;
     QString errMsg;
     QSize size;
     Q_UNUSED(size);
 //    UnionImage_NameSpace::loadStaticImageFromFile(path, tImg, size, errMsg);
-    LibUnionImage_NameSpace::loadStaticImageFromFile(path, tImg, errMsg);
+    // 大图解码期间通过callback输出中间结果
+    if (LibUnionImage_NameSpace::loadStaticImageProgressive(path, tImg, errMsg, options, callback)) {
+        LibDecodedImageCache::instance()->insert(path, tImg);
+        if (appendMemoryTiled(vl, path, tImg)) {
+            return vl;
+        }
+    } else if (LibUnionImage_NameSpace::isDecodeCancelled(options.cancelToken)) {
+        qDebug() << "Decode cancelled:" << path;
+        return vl;
+    }
     QPixmap p = QPixmap::fromImage(tImg);
     if (QFileInfo(path).exists() && p.isNull()) {
         //判定为损坏图片
@@ -93,14 +208,26 @@ QVariantList cachePixmap(const QString &path)
                 int nIdex = path.indexOf("ftp:host=");
                 QString urlAddr = path.mid(nIdex).replace("ftp:host=", "ftp://");
                 QNetworkRequest request(urlAddr);
-                manager.get(request);
+                QNetworkReply *reply = manager.get(request);
+                // 下载期间定时检查取消标记，取消时中止下载，finished信号会结束事件循环
+                QTimer cancelTimer;
+                QObject::connect(&cancelTimer, &QTimer::timeout, [&]() {
+                    if (LibUnionImage_NameSpace::isDecodeCancelled(options.cancelToken)) {
+                        cancelTimer.stop();
+                        reply->abort();
+                    }
+                });
+                cancelTimer.start(CANCEL_CHECK_INTERVAL);
                 loop.exec();
+                if (LibUnionImage_NameSpace::isDecodeCancelled(options.cancelToken)) {
+                    qDebug() << "Ftp download cancelled:" << path;
+                    return vl;
+                }
             }
         }
         qDebug() << errMsg;
     }
-    QVariantList vl;
-    vl << QVariant(path) << QVariant(p);
+    vl << QVariant(p);
     return vl;
 }
 
@@ -108,7 +235,6 @@ QVariantList cachePixmap(const QString &path)
 LibImageGraphicsView::LibImageGraphicsView(QWidget *parent)
     : QGraphicsView(parent)
     , m_renderer(Native)
-    , m_pool(new QThreadPool(this))
 //    , m_svgItem(nullptr)
     , m_movieItem(nullptr)
     , m_pixmapItem(nullptr)
@@ -139,7 +265,6 @@ LibImageGraphicsView::LibImageGraphicsView(QWidget *parent)
 
     connect(&m_watcher, &QFutureWatcherBase::finished, this, &LibImageGraphicsView::onCacheFinish);
 //    connect(dApp->viewerTheme, &ViewerThemeManager::viewerThemeChanged, this, &ImageView::onThemeChanged);
-    m_pool->setMaxThreadCount(1);
     m_loadTimer = new QTimer(this);
     m_loadTimer->setSingleShot(true);
     m_loadTimer->setInterval(300);
@@ -153,6 +278,22 @@ LibImageGraphicsView::LibImageGraphicsView(QWidget *parent)
     connect(m_imgFileWatcher, &QFileSystemWatcher::fileChanged, this, &LibImageGraphicsView::onImgFileChanged);
     m_isChangedTimer = new QTimer(this);
     QObject::connect(m_isChangedTimer, &QTimer::timeout, this, &LibImageGraphicsView::onIsChangedTimerTimeout);
+
+    //缩放停止一段时间后再生成精细缩放的结果，交互过程中只做快速绘制
+    m_zoomSettleTimer = new QTimer(this);
+    m_zoomSettleTimer->setSingleShot(true);
+    m_zoomSettleTimer->setInterval(ZOOM_SETTLE_INTERVAL);
+    QObject::connect(m_zoomSettleTimer, &QTimer::timeout, this, [this]() {
+        if (m_pixmapItem) {
+            m_pixmapItem->setZooming(false);
+        }
+    });
+
+    //滚轮、触控板和捏合输入按帧合并
+    m_frameTimer = new QTimer(this);
+    m_frameTimer->setSingleShot(true);
+    m_frameTimer->setTimerType(Qt::PreciseTimer);
+    QObject::connect(m_frameTimer, &QTimer::timeout, this, &LibImageGraphicsView::applyPendingInput);
     qDebug() << "File watchers initialized";
 
     // MTP文件加载完成通知, 使用 QueuedConnection 确保不在 setImage 时触发，保证先后顺序。
@@ -232,6 +373,11 @@ void LibImageGraphicsView::setWindowIsFullScreen(bool bRet)
 LibImageGraphicsView::~LibImageGraphicsView()
 {
     qDebug() << "Destroying LibImageGraphicsView";
+    if (m_decodeToken) {
+        m_decodeToken->cancel();
+    }
+    //同步写完所有旋转结果并完成通知，视图销毁后后台任务的完成信号不会再处理
+    flushRotation();
     if (m_imgFileWatcher) {
 //        m_imgFileWatcher->clear();
 //        m_imgFileWatcher->quit();
@@ -259,8 +405,6 @@ LibImageGraphicsView::~LibImageGraphicsView()
         delete m_imgSvgItem;
         m_imgSvgItem = nullptr;
     }
-    //保存旋转状态
-    slotRotatePixCurrent();
     qDebug() << "LibImageGraphicsView destroyed";
 }
 
@@ -279,6 +423,8 @@ void LibImageGraphicsView::setImage(const QString &path, const QImage &image)
     qDebug() << "Setting image:" << path;
     // m_spinner 生命周期由 scene() 管理
     hideSpinner();
+    //切换图片时丢弃尚未执行的缩放
+    m_pendingZoomFactor = 1.0;
 
     //默认多页图的按钮显示为false
     if (m_morePicFloatWidget) {
@@ -448,8 +594,10 @@ void LibImageGraphicsView::setImage(const QString &path, const QImage &image)
             // 使用 MTP 代理文件，需等待代理文件创建完成 createProxyFileFinished() ，
             // 或其他AI模型处理等延迟处理，完成后调用 onLoadTimerTimeout()
             //第一次打开直接启动,不使用延时300ms
+            //已预取或正在预取的图片无需等待，同样直接启动
             if (!delayLoad) {
-                if (m_isFistOpen) {
+                if (m_isFistOpen || LibDecodedImageCache::instance()->contains(path)
+                        || LibImagePrefetcher::instance()->isDecoding(path)) {
                     onLoadTimerTimeout();
                     m_isFistOpen = false;
                 } else {
@@ -541,7 +689,11 @@ void LibImageGraphicsView::setScaleValue(qreal v)
         m_isFitWindow = false;
     }
 
-    //执行缩放
+    //执行缩放，交互期间图元以快速过滤绘制
+    if (m_pixmapItem) {
+        m_pixmapItem->setZooming(true);
+        m_zoomSettleTimer->start();
+    }
     m_scal *= scaleFactor;
     scale(scaleFactor, scaleFactor);
     qDebug() << "New scale value:" << m_scal;
@@ -565,9 +717,10 @@ void LibImageGraphicsView::autoFit()
     //确认场景加载出来后，才能调用场景内的item
 //    if (!scene()->isActive())
 //        return;
-    if (image().isNull())
+    //不取image()，避免大图整张拷贝和旋转
+    QSize image_size = displayImageSize();
+    if (image_size.isEmpty())
         return;
-    QSize image_size = image().size();
     if ((image_size.width() >= width() ||
             image_size.height() >= height() - TITLEBAR_HEIGHT * 2) &&
             width() > 0 && height() > 0) {
@@ -586,9 +739,17 @@ const QImage LibImageGraphicsView::image()
         //FIXME: access to m_pixmapItem will crash
         if (nullptr == m_pixmapItem) {  //add to slove crash by shui
             img = QImage();
+        } else if (m_pixmapItem->tiledSource() && !m_pixmapItem->tiledSource()->image().isNull()) {
+            // 内存分块模式下返回完整图片而非预览图
+            img = m_pixmapItem->tiledSource()->image();
         } else {
             img = m_pixmapItem->pixmap().toImage();
         }
+        //显示的旋转只作用于图元，取图时再旋转像素
+        const int rotation = qRound(m_pixmapItem->rotation()) % 360;
+        if (!img.isNull() && 0 != rotation) {
+            img = LibUnionImage_NameSpace::rotateImageOrthogonal(img, rotation);
+        }
 
     } else if (m_imgSvgItem) { // 新增svg的image
         QImage image(m_imgSvgItem->renderer()->defaultSize(), QImage::Format_ARGB32_Premultiplied);
@@ -768,7 +929,8 @@ void LibImageGraphicsView::titleBarControl()
 //        realHeight = img.size().height() * imageRelativeScale() * devicePixelRatioF();
 
 //    } else {
-    realHeight = img.size().height() * imageRelativeScale() / devicePixelRatioF();
+    const QSize imgSize = (m_pixmapItem && m_pixmapItem->isTiled()) ? displayImageSize() : img.size();
+    realHeight = imgSize.height() * imageRelativeScale() / devicePixelRatioF();
 //    }
 
     if (realHeight > height() - TITLEBAR_HEIGHT * 2 + 1) {
@@ -806,11 +968,60 @@ void LibImageGraphicsView::onImgFileChanged(const QString &ddfFile)
 void LibImageGraphicsView::onLoadTimerTimeout()
 {
     qDebug() << "Load timer timeout, starting image cache";
-    QFuture<QVariantList> f = QtConcurrent::run(m_pool, cachePixmap, m_loadPath);
-    if (m_watcher.isRunning()) {
-        m_watcher.cancel();
-        m_watcher.waitForFinished();
+    QPointer<LibImageGraphicsView> view(this);
+    const QString path = m_loadPath;
+    // 该图片的旋转尚未写入文件时读取的仍是旋转前的内容，回写完成后再加载
+    if (isRotateWritePending(path)) {
+        qDebug() << "Waiting for rotation write-back of current image:" << path;
+        m_loadAfterRotateWrite = true;
+        if (m_decodeToken) {
+            m_decodeToken->cancel();
+        }
+        emit hideNavigation();
+        return;
+    }
+    m_loadAfterRotateWrite = false;
+    // 当前图片正在预取时不占用当前图片的线程等待，预取结束后重新加载，届时命中解码缓存
+    const bool deferred = LibImagePrefetcher::instance()->whenDecoded(path, [view, path]() {
+        QMetaObject::invokeMethod(qApp, [view, path]() {
+            if (view && view->m_loadPath == path) {
+                view->onLoadTimerTimeout();
+            }
+        }, Qt::QueuedConnection);
+    });
+    if (deferred) {
+        qDebug() << "Waiting for prefetch of current image:" << path;
+        if (m_decodeToken) {
+            m_decodeToken->cancel();
+        }
+        emit hideNavigation();
+        return;
+    }
+
+    // 大图解码期间按限定的频率刷新已解码的部分，预览尺寸与模糊缩略图一致
+    LibUnionImage_NameSpace::ProgressiveOptions options;
+    options.previewSize = QSize(width(), height() - TITLEBAR_HEIGHT * 2) * devicePixelRatioF();
+    options.updateInterval = PROGRESSIVE_UPDATE_INTERVAL;
+    // 取消上一次仍在进行的解码，不等待其结束
+    if (m_decodeToken) {
+        m_decodeToken->cancel();
     }
+    m_decodeToken.reset(new LibUnionImage_NameSpace::DecodeCancelToken);
+    options.cancelToken = m_decodeToken;
+    // 解码任务不随界面析构等待结束，在主线程中检查界面是否仍然存在，界面析构时取消标记终止解码
+    LibUnionImage_NameSpace::ProgressiveCallback callback = [view, path](const QImage &preview) {
+        QMetaObject::invokeMethod(qApp, [view, path, preview]() {
+            if (view) {
+                view->onProgressiveImage(path, preview);
+            }
+        }, Qt::QueuedConnection);
+        return true;
+    };
+    // 被取代的解码在下一个扫描行批次后退出，调度器为当前图片保留线程，新请求不必排在其后
+    QFuture<QVariantList> f = LibTaskScheduler::instance()->run(LibTaskScheduler::VisibleImage, [path, options, callback]() {
+        return cachePixmap(path, options, callback);
+    });
+    // 切换监视的任务后旧任务的结果不再通知
     m_watcher.setFuture(f);
     emit hideNavigation();
 
@@ -949,22 +1160,10 @@ void LibImageGraphicsView::slotsDown()
 bool LibImageGraphicsView::slotRotatePixmap(int nAngel)
 {
     if (!m_pixmapItem) return false;
-    QPixmap pixmap = m_pixmapItem->pixmap();
-    QTransform rotate;
-    rotate.rotate(nAngel);
-
-    pixmap = pixmap.transformed(rotate, Qt::SmoothTransformation);
-    pixmap.setDevicePixelRatio(devicePixelRatioF());
-    scene()->clear();
+    //只旋转图元，已解码的图片和分块继续使用，像素在回写文件时由后台线程旋转
     resetTransform();
-    m_pixmapItem = new LibGraphicsPixmapItem(pixmap);
-    m_pixmapItem->setTransformationMode(Qt::SmoothTransformation);
-    // Make sure item show in center of view after reload
-    QRectF rect = m_pixmapItem->boundingRect();
-    //            rect.setHeight(rect.height() + 50);
-    setSceneRect(rect);
-    //            setSceneRect(m_pixmapItem->boundingRect());
-    scene()->addItem(m_pixmapItem);
+    rotatePixmapItem(nAngel);
+    QPixmap pixmap = rotatedPreview(m_pixmapItem->pixmap(), qRound(m_pixmapItem->rotation()));
 
     autoFit();
     m_rotateAngel += nAngel;
@@ -989,7 +1188,7 @@ bool LibImageGraphicsView::slotRotatePixmap(int nAngel)
             }
         }
     }
-    emit currentThumbnailChanged(thumbnailPixmap, pixmap.size());
+    emit currentThumbnailChanged(thumbnailPixmap, displayImageSize());
     emit imageChanged(m_path);
     return true;
 }
@@ -1012,26 +1211,114 @@ void LibImageGraphicsView::slotRotatePixCurrent()
                 return;
             }
 
+            //记录文件和角度，切换图片后仍写入被旋转的文件，按顺序写入避免同时写同一文件
             disconnect(m_imgFileWatcher, &QFileSystemWatcher::fileChanged, this, &LibImageGraphicsView::onImgFileChanged);
-            Libutils::image::rotate(m_path, m_rotateAngel);
+            //丢弃旋转前的解码缓存并停止预取，回写完成前切换回该图片时不会使用旋转前的内容
+            LibImagePrefetcher::instance()->beginWrite(m_path);
+            m_rotateWriteQueue.append(qMakePair(m_path, m_rotateAngel));
+            m_rotateAngel = 0;
+            startRotateWrite();
+        }
+    }
+}
 
-            // 如果是 MTP 文件，则将缓存文件的变更提交到 MTP 目录下
-            MtpFileProxy::instance()->submitChangesToMTP(m_path);
+void LibImageGraphicsView::flushRotation()
+{
+    slotRotatePixCurrent();
 
-            //如果是相册调用，则告知刷新
-            if (LibCommonService::instance()->getImgViewerType() == imageViewerSpace::ImgViewerTypeAlbum) {
-                emit ImageEngine::instance()->sigRotatePic(m_path);
+    //等待后台正在写入的文件，完成通知在此处理，之后到达的完成信号直接忽略
+    if (!m_rotateWritePath.isEmpty()) {
+        m_rotateWriteWatcher->waitForFinished();
+        const QString path = m_rotateWritePath;
+        m_rotateWritePath.clear();
+        notifyRotateWritten(path);
+    }
+    //队列中其余的请求在当前线程按顺序写入
+    while (!m_rotateWriteQueue.isEmpty()) {
+        const QPair<QString, int> request = m_rotateWriteQueue.takeFirst();
+        Libutils::image::rotate(request.first, request.second);
+        notifyRotateWritten(request.first);
+    }
+}
+
+void LibImageGraphicsView::startRotateWrite()
+{
+    if (!m_rotateWritePath.isEmpty() || m_rotateWriteQueue.isEmpty()) {
+        return;
+    }
+    if (!m_rotateWriteWatcher) {
+        m_rotateWriteWatcher = new QFutureWatcher<bool>(this);
+        connect(m_rotateWriteWatcher, &QFutureWatcher<bool>::finished, this, &LibImageGraphicsView::onRotateWriteFinished);
+    }
+
+    const QPair<QString, int> request = m_rotateWriteQueue.takeFirst();
+    const QString path = request.first;
+    const int angle = request.second;
+    m_rotateWritePath = path;
+    //旋转原图像素并写入文件，不阻塞界面
+    m_rotateWriteWatcher->setFuture(LibTaskScheduler::instance()->run(LibTaskScheduler::VisibleImage, [path, angle]() {
+        return Libutils::image::rotate(path, angle);
+    }));
+}
+
+void LibImageGraphicsView::onRotateWriteFinished()
+{
+    //已由flushRotation同步处理，或是替换任务前遗留的完成信号
+    if (m_rotateWritePath.isEmpty() || !m_rotateWriteWatcher->future().isFinished()) {
+        return;
+    }
+    const QString path = m_rotateWritePath;
+    m_rotateWritePath.clear();
+    notifyRotateWritten(path);
+
+    //回写期间再次旋转的请求
+    startRotateWrite();
+}
+
+void LibImageGraphicsView::notifyRotateWritten(const QString &path)
+{
+    //回写期间可能缓存的旧内容一并丢弃
+    LibImagePrefetcher::instance()->endWrite(path);
+    //切换回该图片时等待回写的加载，最后一次回写完成后开始
+    if (m_loadAfterRotateWrite && path == m_loadPath && !isRotateWritePending(path)) {
+        m_loadAfterRotateWrite = false;
+        QTimer::singleShot(0, this, [ = ] {
+            if (m_loadPath == path) {
+                onLoadTimerTimeout();
             }
+        });
+    }
 
-            QTimer::singleShot(1000, this, [ = ] {
-                connect(m_imgFileWatcher, &QFileSystemWatcher::fileChanged, this, &LibImageGraphicsView::onImgFileChanged);
-            });
-            m_rotateAngel = 0;
+    // 如果是 MTP 文件，则将缓存文件的变更提交到 MTP 目录下
+    MtpFileProxy::instance()->submitChangesToMTP(path);
+
+    //如果是相册调用，则告知刷新
+    if (LibCommonService::instance()->getImgViewerType() == imageViewerSpace::ImgViewerTypeAlbum) {
+        emit ImageEngine::instance()->sigRotatePic(path);
+    }
+
+    QTimer::singleShot(1000, this, [ = ] {
+        if (!m_rotateWritePath.isEmpty() || !m_rotateWriteQueue.isEmpty()) {
+            return;
+        }
+        connect(m_imgFileWatcher, &QFileSystemWatcher::fileChanged, this, &LibImageGraphicsView::onImgFileChanged, Qt::UniqueConnection);
+    });
 
-            // 通知授权控制图片编辑完成
-            PermissionConfig::instance()->triggerAction(PermissionConfig::TidEdit, m_path);
+    // 通知授权控制图片编辑完成
+    PermissionConfig::instance()->triggerAction(PermissionConfig::TidEdit, path);
+}
+
+bool LibImageGraphicsView::isRotateWritePending(const QString &path) const
+{
+    if (m_rotateWritePath == path) {
+        return true;
+    }
+    for (const QPair<QString, int> &request : m_rotateWriteQueue) {
+        if (request.first == path) {
+            return true;
         }
     }
+    return false;
 }
 
 void LibImageGraphicsView::mouseDoubleClickEvent(QMouseEvent *e)
@@ -1110,7 +1397,7 @@ void LibImageGraphicsView::mouseMoveEvent(QMouseEvent *e)
         QGraphicsView::mouseMoveEvent(e);
         viewport()->setCursor(Qt::ClosedHandCursor);
 
-        emit transformChanged();
+        queueTransformChanged();
     }
     emit sigMouseMove();
 }
@@ -1235,29 +1522,38 @@ void LibImageGraphicsView::onCacheFinish()
     hideSpinner();
 
     QVariantList vl = m_watcher.result();
-    if (vl.length() == 2) {
+    if (vl.length() >= 2) {
         const QString path = vl.first().toString();
         if (path == m_path) {
             if (!m_pixmapItem) {
                 qWarning() << "No pixmap item available for cache update";
                 return;
             }
-            QPixmap pixmap = vl.last().value<QPixmap>();
+            QPixmap pixmap = vl.at(1).value<QPixmap>();
+            // 超大图片返回的是预览图和区域解码源
+            const QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> tiledSource =
+                vl.value(2).value<QSharedPointer<LibUnionImage_NameSpace::TiledImageSource>>();
             QPixmap tmpPixmap = pixmap;
             tmpPixmap.setDevicePixelRatio(devicePixelRatioF());
             if (!tmpPixmap.isNull()) {
                 pixmap = tmpPixmap;
             }
+            m_pixmapItem->setGraphicsEffect(nullptr);
+            m_pixmapItem->setPixmap(pixmap);
+            m_pixmapItem->setRotation(0);
+            m_pixmapItem->setPos(QPointF());
+            setSceneRect(m_pixmapItem->boundingRect());
+            if (tiledSource) {
+                m_pixmapItem->setTiledSource(tiledSource);
+                setSceneRect(m_pixmapItem->boundingRect());
+            }
+            //加载完成前的旋转同样只作用于图元
             if (m_newImageRotateAngle != 0) {
                 qDebug() << "Applying rotation angle:" << m_newImageRotateAngle;
-                QTransform rotate;
-                rotate.rotate(m_newImageRotateAngle);
-                pixmap = pixmap.transformed(rotate, Qt::SmoothTransformation);
+                rotatePixmapItem(m_newImageRotateAngle);
+                pixmap = rotatedPreview(pixmap, qRound(m_pixmapItem->rotation()));
                 m_newImageRotateAngle = 0;
             }
-            m_pixmapItem->setGraphicsEffect(nullptr);
-            m_pixmapItem->setPixmap(pixmap);
-            setSceneRect(m_pixmapItem->boundingRect());
             autoFit();
             emit imageChanged(path);
             this->update();
@@ -1292,7 +1588,7 @@ void LibImageGraphicsView::onCacheFinish()
                 else {
                     thumbnailPixmap = pixmap.scaled(200,200);
                 }
-                emit currentThumbnailChanged(thumbnailPixmap, pixmap.size());
+                emit currentThumbnailChanged(thumbnailPixmap, displayImageSize());
             }
 
         }
@@ -1331,6 +1627,48 @@ void LibImageGraphicsView::scaleAtPoint(QPoint pos, qreal factor)
     centerOn(static_cast<int>(centerScenePos.x()), static_cast<int>(centerScenePos.y()));
 }
 
+void LibImageGraphicsView::queueZoom(const QPoint &pos, qreal factor)
+{
+    m_pendingZoomFactor *= factor;
+    m_pendingZoomAnchor = pos;
+    scheduleFrame();
+}
+
+void LibImageGraphicsView::queueTransformChanged()
+{
+    m_pendingTransformChanged = true;
+    scheduleFrame();
+}
+
+void LibImageGraphicsView::scheduleFrame()
+{
+    if (m_frameTimer->isActive()) {
+        return;
+    }
+    //按所在屏幕的刷新率对齐，每帧最多执行一次
+    int interval = DEFAULT_FRAME_INTERVAL;
+    QScreen *currentScreen = window()->windowHandle() ? window()->windowHandle()->screen() : QGuiApplication::primaryScreen();
+    if (currentScreen && currentScreen->refreshRate() > 1) {
+        interval = qMax(1, qRound(1000.0 / currentScreen->refreshRate()));
+    }
+    m_frameTimer->start(interval);
+}
+
+void LibImageGraphicsView::applyPendingInput()
+{
+    const qreal factor = m_pendingZoomFactor;
+    m_pendingZoomFactor = 1.0;
+    const bool transformPending = m_pendingTransformChanged;
+    m_pendingTransformChanged = false;
+
+    //缩放本身会发送变换通知
+    if (!qFuzzyCompare(factor, 1.0)) {
+        scaleAtPoint(m_pendingZoomAnchor, factor);
+    } else if (transformPending) {
+        emit transformChanged();
+    }
+}
+
 void LibImageGraphicsView::handleGestureEvent(QGestureEvent *gesture)
 {
     if (QGesture *pinch = gesture->gesture(Qt::PinchGesture))
@@ -1344,7 +1682,7 @@ void LibImageGraphicsView::pinchTriggered(QPinchGesture *gesture)
     if (changeFlags & QPinchGesture::ScaleFactorChanged) {
         QPoint pos = mapFromGlobal(gesture->centerPoint().toPoint());
         if (abs(gesture->scaleFactor() - 1) > 0.006) {
-            scaleAtPoint(pos, gesture->scaleFactor());
+            queueZoom(pos, gesture->scaleFactor());
         }
     }
 #ifndef tablet_PC
@@ -1454,25 +1792,10 @@ void LibImageGraphicsView::OnFinishPinchAnimal()
 //        return;
 //    }
     if (!m_pixmapItem) return;
-    //QStranform旋转到180度有问题，暂未解决，因此动画结束后旋转Pixmap到180
-    QPixmap pixmap;
-    pixmap = m_pixmapItem->pixmap();
-    QTransform rotate;
-    rotate.rotate(m_endvalue);
-
-    pixmap = pixmap.transformed(rotate, Qt::FastTransformation);
-    pixmap.setDevicePixelRatio(devicePixelRatioF());
-    scene()->clear();
+    //动画结束后撤销视图的旋转，改为旋转图元到最终角度
     resetTransform();
-    m_pixmapItem = new LibGraphicsPixmapItem(pixmap);
-    m_pixmapItem->setTransformationMode(Qt::SmoothTransformation);
-    // Make sure item show in center of view after reload
-    QRectF rect = m_pixmapItem->boundingRect();
-    //            rect.setHeight(rect.height() + 50);
-    setSceneRect(rect);
-    //            setSceneRect(m_pixmapItem->boundingRect());
-
-    scene()->addItem(m_pixmapItem);
+    rotatePixmapItem(static_cast<int>(m_endvalue));
+    QPixmap pixmap = rotatedPreview(m_pixmapItem->pixmap(), qRound(m_pixmapItem->rotation()));
     scale(m_scal, m_scal);
     if (m_bRoate) {
         m_rotateAngel += m_endvalue;
@@ -1498,7 +1821,7 @@ void LibImageGraphicsView::OnFinishPinchAnimal()
                     }
                 }
             }
-            emit currentThumbnailChanged(thumbnailPixmap, pixmap.size());
+            emit currentThumbnailChanged(thumbnailPixmap, displayImageSize());
             emit UpdateNavImg();
         }
     }
@@ -1631,6 +1954,60 @@ void LibImageGraphicsView::hideSpinner()
     }
 }
 
+void LibImageGraphicsView::onProgressiveImage(const QString &path, const QImage &preview)
+{
+    // 完整图片已显示或已切换到其他图片时丢弃中间结果
+    if (path != m_path || !m_pixmapItem || m_pixmapItem->isTiled() || FullFinish == m_newImageLoadPhase) {
+        return;
+    }
+
+    // 已解码的部分覆盖到当前显示的缩略图上，未解码的区域透明，仍显示缩略图
+    QPixmap merged = m_pixmapItem->pixmap();
+    const bool hasBase = !merged.isNull();
+    if (!hasBase) {
+        merged = QPixmap(preview.size());
+        merged.fill(Qt::transparent);
+        merged.setDevicePixelRatio(devicePixelRatioF());
+    }
+    {
+        QPainter painter(&merged);
+        painter.setRenderHint(QPainter::SmoothPixmapTransform);
+        painter.drawImage(QRectF(QPointF(0, 0), QSizeF(merged.size()) / merged.devicePixelRatioF()), preview);
+    }
+    m_pixmapItem->setGraphicsEffect(nullptr);
+    m_pixmapItem->setPixmap(merged);
+    if (!hasBase) {
+        hideSpinner();
+        //图片尺寸变化后按当前旋转角度重新定位图元
+        rotatePixmapItem(0);
+        autoFit();
+    }
+}
+
+void LibImageGraphicsView::rotatePixmapItem(int angle)
+{
+    // 已解码的图片和分块继续使用，旋转角度保持在[0, 360)
+    int rotation = (qRound(m_pixmapItem->rotation()) + angle) % 360;
+    if (rotation < 0) {
+        rotation += 360;
+    }
+    m_pixmapItem->setPos(QPointF());
+    m_pixmapItem->setTransformOriginPoint(m_pixmapItem->boundingRect().center());
+    m_pixmapItem->setRotation(rotation);
+    // 场景坐标与旋转后的图片坐标一致，导航窗口的可见区域按此计算
+    m_pixmapItem->setPos(-m_pixmapItem->sceneBoundingRect().topLeft());
+    setSceneRect(m_pixmapItem->sceneBoundingRect());
+}
+
+QSize LibImageGraphicsView::displayImageSize()
+{
+    if (m_pixmapItem) {
+        const QSize size = m_pixmapItem->imageSize();
+        return (qRound(m_pixmapItem->rotation()) % 180 == 0) ? size : size.transposed();
+    }
+    return image().size();
+}
+
 void LibImageGraphicsView::wheelEvent(QWheelEvent *event)
 {
     // 加载过程不可缩放
@@ -1652,8 +2029,7 @@ void LibImageGraphicsView::wheelEvent(QWheelEvent *event)
         } else {
 
             qreal factor = qPow(1.2, event->angleDelta().y() / 240.0);
-            qDebug() << factor;
-            scaleAtPoint(event->position().toPoint(), factor);
+            queueZoom(event->position().toPoint(), factor);
 
             event->accept();
         }
@@ -18,6 +18,7 @@
 
 #include "image-viewer_global.h"
 #include "service/commonservice.h"
+#include "unionimage/unionimage.h"
 
 #include <DSpinner>
 
@@ -28,7 +29,6 @@ class QFile;
 class LibGraphicsMovieItem;
 class LibGraphicsPixmapItem;
 class QGraphicsSvgItem;
-class QThreadPool;
 class QGestureEvent;
 class QPinchGesture;
 class QSwipeGesture;
@@ -152,16 +152,21 @@ public slots:
     void slotsDown();
 
     /**
-     * @brief slotRotatePixmap  根据角度旋转pixmap
+     * @brief slotRotatePixmap  根据角度旋转图元，像素在回写文件时旋转
      * @param nAngel        旋转的角度
      */
     bool slotRotatePixmap(int nAngel);
 
     /**
-     * @brief slotRotatePixCurrent  判断当前图片是否被旋转，如果是，写入本地
+     * @brief slotRotatePixCurrent  判断当前图片是否被旋转，如果是，加入回写队列在后台写入本地
      */
     void slotRotatePixCurrent();
 
+    /**
+     * @brief flushRotation  同步完成当前图片及队列中所有旋转的回写，返回后可直接使用文件
+     */
+    void flushRotation();
+
 protected:
     void mouseDoubleClickEvent(QMouseEvent *e) override;
     void mouseReleaseEvent(QMouseEvent *e) override;
@@ -190,10 +195,32 @@ private slots:
      */
     void OnFinishPinchAnimal();
 
+    //旋转结果回写完成后通知相册、MTP及授权控制
+    void onRotateWriteFinished();
+
 private:
     QPixmap getBlurPixmap(const QString &path, const imageViewerSpace::ItemInfo &info, const QPixmap &previousPix);
     void addLoadSpinner(bool enhanceImage = false);
     void hideSpinner();
+    //渐进解码的中间结果，合并到当前显示的图片中
+    void onProgressiveImage(const QString &path, const QImage &preview);
+    //旋转图元本身，不旋转像素也不重建场景
+    void rotatePixmapItem(int angle);
+    //上一次回写完成后取出队列中的下一个请求在后台写入
+    void startRotateWrite();
+    //单个文件回写完成后的通知
+    void notifyRotateWritten(const QString &path);
+    //该文件是否有正在回写或等待回写的旋转
+    bool isRotateWritePending(const QString &path) const;
+    //当前显示的原图尺寸(已旋转)，分块模式下为原图而非预览图尺寸
+    QSize displayImageSize();
+    //累积缩放输入，下一帧统一执行，连续的滚轮和捏合事件每帧只变换一次
+    void queueZoom(const QPoint &pos, qreal factor);
+    //累积拖动后的变换通知，下一帧统一发送
+    void queueTransformChanged();
+    void scheduleFrame();
+    //执行累积的缩放并发送通知
+    void applyPendingInput();
 
 private:
     bool m_isFitImage = false;
@@ -201,9 +228,9 @@ private:
     QColor m_backgroundColor;
     RendererType m_renderer;
     QFutureWatcher<QVariantList> m_watcher;
+    LibUnionImage_NameSpace::DecodeCancelTokenPtr m_decodeToken;   //当前加载请求的取消标记
     QString m_path;
     QString m_loadingIconPath;
-    QThreadPool *m_pool;
     LibGraphicsMovieItem *m_movieItem = nullptr;
     LibGraphicsPixmapItem *m_pixmapItem = nullptr;
     LibImageSvgItem *m_imgSvgItem = nullptr;
@@ -212,6 +239,11 @@ private:
 //    CFileWatcher *m_imgFileWatcher;
     QFileSystemWatcher *m_imgFileWatcher{nullptr};
     QTimer *m_isChangedTimer;
+    QTimer *m_zoomSettleTimer = nullptr;
+    QTimer *m_frameTimer = nullptr;
+    qreal m_pendingZoomFactor = 1.0;
+    QPoint m_pendingZoomAnchor;
+    bool m_pendingTransformChanged = false;
 
     bool m_isFirstPinch = false;
     QPointF m_centerPoint;
@@ -230,6 +262,11 @@ private:
     bool m_press = false;
     //旋转角度
     int m_rotateAngel = 0;
+    //旋转结果回写文件的后台任务
+    QFutureWatcher<bool> *m_rotateWriteWatcher = nullptr;
+    QString m_rotateWritePath;      //正在回写的文件，为空时没有未处理完成的回写
+    QList<QPair<QString, int>> m_rotateWriteQueue;     //等待回写的文件及角度，按旋转顺序写入
+    bool m_loadAfterRotateWrite = false;    //当前图片的旋转回写完成后再加载
 
     //新增tiff多图切换窗口
     MorePicFloatWidget *m_morePicFloatWidget{nullptr};
@@ -0,0 +1,141 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "tileloader.h"
+#include "service/taskscheduler.h"
+
+#include <QMutexLocker>
+#include <QDebug>
+
+namespace {
+
+// 分块输出边长(像素)
+const int TILE_SIZE = 512;
+// 分块缓存上限(KB)
+const int TILE_CACHE_KB = 256 * 1024;
+// 最低一级分块的长边不小于该值，更低的分辨率由预览图提供
+const int MIN_LEVEL_EXTENT = 2048;
+
+}
+
+LibTileLoader::LibTileLoader(const QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> &source, QObject *parent)
+    : QObject(parent)
+    , m_source(source)
+    , m_state(new RequestState)
+{
+    m_cache.setMaxCost(TILE_CACHE_KB);
+    m_state->loader = this;
+
+    const QSize size = m_source->size();
+    int extent = qMax(size.width(), size.height());
+    while (extent / 2 >= MIN_LEVEL_EXTENT) {
+        extent /= 2;
+        ++m_maxLevel;
+    }
+    qDebug() << "Created tile loader for:" << m_source->path() << "size:" << size << "max level:" << m_maxLevel;
+}
+
+LibTileLoader::~LibTileLoader()
+{
+    // 排队中的任务随后直接跳过，执行中的任务不再投递结果
+    {
+        QMutexLocker locker(&m_state->mutex);
+        m_state->wanted.clear();
+        m_state->loader = nullptr;
+    }
+    qDebug() << "Destroyed tile loader for:" << m_source->path();
+}
+
+quint64 LibTileLoader::tileKey(int level, int x, int y)
+{
+    return (static_cast<quint64>(level) << 56) | (static_cast<quint64>(static_cast<quint32>(y) & 0xfffffff) << 28)
+           | (static_cast<quint32>(x) & 0xfffffff);
+}
+
+QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> LibTileLoader::source() const
+{
+    return m_source;
+}
+
+int LibTileLoader::tileSize() const
+{
+    return TILE_SIZE;
+}
+
+int LibTileLoader::maxLevel() const
+{
+    return m_maxLevel;
+}
+
+QRect LibTileLoader::tileSourceRect(int level, int x, int y) const
+{
+    const int span = TILE_SIZE << level;
+    return QRect(x * span, y * span, span, span) & QRect(QPoint(0, 0), m_source->size());
+}
+
+QPixmap LibTileLoader::tile(int level, int x, int y)
+{
+    QPixmap *pixmap = m_cache.object(tileKey(level, x, y));
+    return pixmap ? *pixmap : QPixmap();
+}
+
+void LibTileLoader::setWantedTiles(const QList<quint64> &keys)
+{
+    {
+        QMutexLocker locker(&m_state->mutex);
+        m_state->wanted.clear();
+        for (quint64 key : keys) {
+            m_state->wanted.insert(key);
+        }
+    }
+
+    for (quint64 key : keys) {
+        if (m_pending.contains(key) || m_cache.contains(key)) {
+            continue;
+        }
+        m_pending.insert(key);
+
+        const int level = static_cast<int>(key >> 56);
+        const int y = static_cast<int>((key >> 28) & 0xfffffff);
+        const int x = static_cast<int>(key & 0xfffffff);
+        const QRect rect = tileSourceRect(level, x, y);
+        const QSize scaledSize((rect.width() + (1 << level) - 1) >> level, (rect.height() + (1 << level) - 1) >> level);
+        QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> source = m_source;
+        QSharedPointer<RequestState> state = m_state;
+        LibTaskScheduler::instance()->post(LibTaskScheduler::VisibleImage, [ = ]() {
+            QImage image;
+            bool wanted = false;
+            {
+                QMutexLocker locker(&state->mutex);
+                wanted = state->wanted.contains(key);
+            }
+            // 已移出视野的分块不再解码，返回空图以清除等待标记
+            if (wanted) {
+                image = source->readRegion(rect, scaledSize);
+            }
+            // 持锁投递，加载器析构时会等待投递完成，析构后未处理的事件随对象一起移除
+            QMutexLocker locker(&state->mutex);
+            if (LibTileLoader *loader = state->loader) {
+                QMetaObject::invokeMethod(loader, [loader, key, image]() {
+                    loader->onTileDecoded(key, image);
+                }, Qt::QueuedConnection);
+            }
+        });
+    }
+}
+
+void LibTileLoader::onTileDecoded(quint64 key, const QImage &image)
+{
+    m_pending.remove(key);
+    if (image.isNull()) {
+        return;
+    }
+
+    const int level = static_cast<int>(key >> 56);
+    const int y = static_cast<int>((key >> 28) & 0xfffffff);
+    const int x = static_cast<int>(key & 0xfffffff);
+    QPixmap *pixmap = new QPixmap(QPixmap::fromImage(image));
+    m_cache.insert(key, pixmap, qMax(1, pixmap->width() * pixmap->height() * 4 / 1024));
+    emit tileReady(tileSourceRect(level, x, y));
+}
@@ -0,0 +1,71 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef TILELOADER_H
+#define TILELOADER_H
+
+#include <QCache>
+#include <QMutex>
+#include <QObject>
+#include <QPixmap>
+#include <QSet>
+#include <QSharedPointer>
+
+#include "unionimage/tiledimagesource.h"
+
+/**
+ * @brief The LibTileLoader class
+ * 超大图片的分块加载器，在任务调度器中按当前图片优先级异步解码分块并缓存
+ * 第level级分块以2^level的比例缩小，每个分块输出tileSize()像素见方
+ * 只解码最近一次setWantedTiles()请求的分块，平移时已移出视野的排队任务直接跳过
+ */
+class LibTileLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit LibTileLoader(const QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> &source, QObject *parent = nullptr);
+    ~LibTileLoader() override;
+
+    static quint64 tileKey(int level, int x, int y);
+
+    QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> source() const;
+    int tileSize() const;
+    // 最大分块级别，更低分辨率由预览图提供
+    int maxLevel() const;
+
+    // 分块在原图中的区域(显示坐标)
+    QRect tileSourceRect(int level, int x, int y) const;
+
+    // 返回已缓存的分块，未缓存时返回空图
+    QPixmap tile(int level, int x, int y);
+
+    /**
+     * @brief setWantedTiles
+     * @param[in]           keys    按优先级排列的分块
+     * 替换需要的分块集合，未缓存且未在解码的分块投递到调度器
+     */
+    void setWantedTiles(const QList<quint64> &keys);
+
+signals:
+    // 分块解码完成，参数为分块在原图中的区域
+    void tileReady(const QRect &sourceRect);
+
+private:
+    void onTileDecoded(quint64 key, const QImage &image);
+
+    // 与解码任务共享的请求状态，加载器析构后任务仍可安全访问
+    struct RequestState {
+        QMutex mutex;
+        QSet<quint64> wanted;
+        LibTileLoader *loader = nullptr;    // 析构时置空，持锁投递结果
+    };
+
+    QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> m_source;
+    QSharedPointer<RequestState> m_state;
+    QCache<quint64, QPixmap> m_cache;
+    QSet<quint64> m_pending;
+    int m_maxLevel = 0;
+};
+
+#endif // TILELOADER_H
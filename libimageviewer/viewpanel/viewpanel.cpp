@@ -38,6 +38,7 @@
 #include "service/permissionconfig.h"
 #include "service/configsetter.h"
 #include "service/imagedataservice.h"
+#include "service/imageprefetcher.h"
 #include "service/mtpfileproxy.h"
 #include "unionimage/imageutils.h"
 #include "service/aimodelservice.h"
@@ -159,7 +160,7 @@ LibViewPanel::~LibViewPanel()
 {
     // 关闭前保存旋转状态
     if (m_view) {
-        m_view->slotRotatePixCurrent();
+        m_view->flushRotation();
     }
     // 析构时通知图片窗口关闭
     PermissionConfig::instance()->triggerAction(PermissionConfig::TidClose, m_currentPath);
@@ -167,6 +168,8 @@ LibViewPanel::~LibViewPanel()
     // 清空图像缓存目录
     Libutils::image::clearCacheImageFolder();
 
+    LibImagePrefetcher::instance()->cancel();
+
     if (m_bottomToolbar) {
         m_bottomToolbar->deleteLater();
         m_bottomToolbar = nullptr;
@@ -209,7 +212,7 @@ void LibViewPanel::loadImage(const QString &path, QStringList paths)
         if (!paths.contains(targetImageInfo.absoluteFilePath())) {
             // 关闭前保存旋转状态
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
             // 不含授权文件，提示文件关闭
             PermissionConfig::instance()->triggerAction(PermissionConfig::TidClose, 
@@ -1001,6 +1004,7 @@ bool LibViewPanel::startdragImage(const QStringList &paths, const QString &first
         loadImage(loadingPath, image_list);
 
         LibCommonService::instance()->m_listAllPath = image_list;
+        LibImageDataService::instance()->setAllDataKeys(image_list);
         LibCommonService::instance()->m_noLoadingPath = image_list;
         LibCommonService::instance()->m_listLoaded.clear();
         //看图首先制作显示的图片的缩略图
@@ -1014,6 +1018,7 @@ bool LibViewPanel::startdragImage(const QStringList &paths, const QString &first
         //展示当前图片
         loadImage(realPath, realPaths);
         LibCommonService::instance()->m_listAllPath = realPaths;
+        LibImageDataService::instance()->setAllDataKeys(realPaths);
         LibCommonService::instance()->m_noLoadingPath = realPaths;
         LibCommonService::instance()->m_listLoaded.clear();
         //看图首先制作显示的图片的缩略图
@@ -1365,6 +1370,7 @@ bool LibViewPanel::startChooseFileDialog()
         //展示当前图片
         loadImage(loadingPath, image_list);
         LibCommonService::instance()->m_listAllPath = image_list;
+        LibImageDataService::instance()->setAllDataKeys(image_list);
         LibCommonService::instance()->m_noLoadingPath = image_list;
         LibCommonService::instance()->m_listLoaded.clear();
         //看图首先制作显示的图片的缩略图
@@ -1755,7 +1761,7 @@ void LibViewPanel::onMenuItemClicked(QAction *action)
         }
         case IdPrint: {
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
 
             //打开重命名窗口时关闭定时器
@@ -1777,7 +1783,7 @@ void LibViewPanel::onMenuItemClicked(QAction *action)
         }
         case IdRename: {
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
             //todo,重命名
             QString oldPath = m_bottomToolbar->getCurrentItemInfo().path;
@@ -1829,7 +1835,7 @@ void LibViewPanel::onMenuItemClicked(QAction *action)
         }
         case IdCopy: {
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
 
             // 判断当前是否为AI增强图片，若为设置增强后的图片
@@ -1844,7 +1850,7 @@ void LibViewPanel::onMenuItemClicked(QAction *action)
         }
         case IdMoveToTrash: {
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
             //todo,删除
             if (m_bottomToolbar) {
@@ -1876,7 +1882,7 @@ void LibViewPanel::onMenuItemClicked(QAction *action)
         }
         case IdSetAsWallpaper: {
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
 
             // 仅 jpeg 和 png 图片类型使用文件路径直接设置
@@ -1890,7 +1896,7 @@ void LibViewPanel::onMenuItemClicked(QAction *action)
         }
         case IdDisplayInFileManager : {
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
             QString path = m_bottomToolbar->getCurrentItemInfo().path;
             // MTP文件需调整文件路径
@@ -1902,7 +1908,7 @@ void LibViewPanel::onMenuItemClicked(QAction *action)
         }
         case IdImageInfo: {
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
             //todo,文件信息
             if (!m_info && !m_extensionPanel) {
@@ -1932,7 +1938,7 @@ void LibViewPanel::onMenuItemClicked(QAction *action)
         }
         case IdOcr: {
             if (m_view) {
-                m_view->slotRotatePixCurrent();
+                m_view->flushRotation();
             }
             //todo,ocr
             slotOcrPicture();
@@ -2007,7 +2013,7 @@ void LibViewPanel::startSlideShow(const ViewInfo &info)
     qInfo() << "Starting slideshow";
     //判断旋转图片本体是否旋转
     if (m_view) {
-        m_view->slotRotatePixCurrent();
+        m_view->flushRotation();
     }
     if (m_bottomToolbar) {
         m_bottomToolbar->setVisible(false);
@@ -2079,6 +2085,11 @@ void LibViewPanel::openImg(int index, QString path)
         Q_EMIT AIModelService::instance()->clearPreviousEnhance();
     }
 
+    // 按翻页方向预取相邻图片，需在setImage前更新当前图片，避免重复解码
+    LibImagePrefetcher::instance()->navigate(path, LibCommonService::instance()->m_listAllPath);
+    // 缩略图缓存按与当前图片的距离淘汰
+    LibImageDataService::instance()->setVisualIndex(LibCommonService::instance()->m_listAllPath.indexOf(path));
+
     //展示图片
     m_view->slotRotatePixCurrent();
     m_view->setImage(path);
@@ -12,6 +12,7 @@ HEADERS += \
     $$PWD/scen/graphicsitem.h \
     $$PWD/scen/imagegraphicsview.h \
     $$PWD/scen/imagesvgitem.h \
+    $$PWD/scen/tileloader.h \
 
 SOURCES += \
     $$PWD/viewpanel.cpp \
@@ -27,3 +28,4 @@ SOURCES += \
     $$PWD/scen/graphicsitem.cpp \
     $$PWD/scen/imagegraphicsview.cpp \
     $$PWD/scen/imagesvgitem.cpp \
+    $$PWD/scen/tileloader.cpp \
@@ -4,6 +4,7 @@
 
 #include "printhelper.h"
 #include "service/permissionconfig.h"
+#include "service/decodedimagecache.h"
 
 #include <QPrintDialog>
 #include <QPrintPreviewDialog>
@@ -67,7 +68,7 @@ void PrintHelper::showPrintDialog(const QStringList &paths, QWidget *parent)
         } else {
             // QImage不应该多次赋值，所以换到这里来，修复style问题
             QImage img;
-            LibUnionImage_NameSpace::loadStaticImageFromFile(path, img, errMsg);         
+            LibDecodedImageCache::instance()->loadImage(path, img, errMsg);
             if (!img.isNull()) {
                 m_re->appendImage(img);
             } else {
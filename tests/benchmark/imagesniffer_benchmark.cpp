@@ -0,0 +1,123 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "unionimage/snifferimageformat.h"
+
+#include <QCoreApplication>
+#include <QDirIterator>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QMimeDatabase>
+#include <QTemporaryDir>
+#include <QTextStream>
+#include <QVector>
+
+namespace {
+
+const int COPIES_PER_FORMAT = 200;
+const int MEMORY_ROUNDS = 20000;
+
+// 各格式的最小文件头样本，不足部分补零
+const struct {
+    const char *name;
+    const char *data;
+    int size;
+} SAMPLES[] = {
+    {"png", "\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16},
+    {"jpg", "\xff\xd8\xff\xe0\0\x10JFIF", 10},
+    {"gif", "GIF89a", 6},
+    {"webp", "RIFF\x24\0\0\0WEBPVP8 ", 16},
+    {"tiff", "II*\0\x08\0\0\0", 8},
+    {"heic", "\0\0\0\x18" "ftypheic\0\0\0\0mif1heic", 24},
+    {"avif", "\0\0\0\x1c" "ftypmif1\0\0\0\0mif1avifmiaf", 28},
+    {"jp2", "\0\0\0\x0cjP  \r\n\x87\n", 12},
+    {"psd", "8BPS\0\x01", 6},
+    {"bmp", "BM\x36\0\0\0", 6},
+    {"txt", "plain text, not an image", 24},
+};
+
+QByteArray sampleData(int index)
+{
+    QByteArray data(SAMPLES[index].data, SAMPLES[index].size);
+    data.append(QByteArray(SNIFF_HEADER_SIZE * 4, '\0'));
+    return data;
+}
+
+}
+
+/**
+ * 文件格式嗅探基准测试：统计每秒可分类的文件头/文件数量，并与QMimeDatabase按内容匹配对比
+ * 用法: imagesniffer-benchmark [目录]，未指定目录时使用生成的样本文件
+ */
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    const int sampleCount = static_cast<int>(sizeof(SAMPLES) / sizeof(SAMPLES[0]));
+    QVector<QByteArray> headers;
+    for (int i = 0; i < sampleCount; ++i) {
+        headers.append(sampleData(i));
+    }
+
+    // 内存中的文件头分类
+    QElapsedTimer timer;
+    timer.start();
+    int recognized = 0;
+    for (int round = 0; round < MEMORY_ROUNDS; ++round) {
+        for (const QByteArray &header : headers) {
+            recognized += DetectImageFormatFromData(header).isEmpty() ? 0 : 1;
+        }
+    }
+    const double memorySeconds = timer.nsecsElapsed() / 1e9;
+    out << "in-memory headers: " << QString::number(MEMORY_ROUNDS * headers.size() / memorySeconds, 'f', 0)
+        << " /s (" << recognized << " recognized)" << Qt::endl;
+
+    QStringList files;
+    QTemporaryDir tempDir;
+    if (argc >= 2) {
+        QDirIterator it(QString::fromLocal8Bit(argv[1]), QDir::Files, QDirIterator::Subdirectories);
+        while (it.hasNext()) {
+            files.append(it.next());
+        }
+    } else {
+        for (int i = 0; i < sampleCount; ++i) {
+            for (int copy = 0; copy < COPIES_PER_FORMAT; ++copy) {
+                // 不带后缀，强制按内容判断
+                const QString path = tempDir.path() + QString("/%1_%2").arg(SAMPLES[i].name).arg(copy);
+                QFile file(path);
+                if (file.open(QIODevice::WriteOnly)) {
+                    file.write(headers.at(i));
+                    files.append(path);
+                }
+            }
+        }
+    }
+    if (files.isEmpty()) {
+        out << "no files to classify" << Qt::endl;
+        return 1;
+    }
+
+    timer.restart();
+    recognized = 0;
+    for (const QString &path : files) {
+        recognized += DetectImageFormat(path).isEmpty() ? 0 : 1;
+    }
+    const double sniffSeconds = timer.nsecsElapsed() / 1e9;
+    out << "sniffer files:     " << QString::number(files.size() / sniffSeconds, 'f', 0)
+        << " /s (" << recognized << "/" << files.size() << " images)" << Qt::endl;
+
+    // 包含QMimeDatabase首次加载规则的时间
+    timer.restart();
+    recognized = 0;
+    QMimeDatabase db;
+    for (const QString &path : files) {
+        const QString name = db.mimeTypeForFile(path, QMimeDatabase::MatchContent).name();
+        recognized += (name.startsWith("image/") || name.startsWith("video/x-mng")) ? 1 : 0;
+    }
+    const double mimeSeconds = timer.nsecsElapsed() / 1e9;
+    out << "QMimeDatabase:     " << QString::number(files.size() / mimeSeconds, 'f', 0)
+        << " /s (" << recognized << "/" << files.size() << " images)" << Qt::endl;
+    return 0;
+}
@@ -0,0 +1,139 @@
+// SPDX-FileCopyrightText: 2025 UnionTech Software Technology Co., Ltd.
+//
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "unionimage/imagetransform.h"
+
+#include <QGuiApplication>
+#include <QElapsedTimer>
+#include <QTransform>
+#include <QTextStream>
+
+#include <functional>
+
+namespace {
+
+const int DEFAULT_WIDTH = 6000;
+const int DEFAULT_HEIGHT = 4000;
+const int ROUNDS = 5;
+
+struct KernelName {
+    LibUnionImage_NameSpace::TransformKernel kernel;
+    const char *name;
+};
+
+const KernelName KERNELS[] = {
+    {LibUnionImage_NameSpace::TransformKernelScalar, "scalar"},
+    {LibUnionImage_NameSpace::TransformKernelSSE2, "sse2"},
+    {LibUnionImage_NameSpace::TransformKernelAVX2, "avx2"},
+    {LibUnionImage_NameSpace::TransformKernelNEON, "neon"},
+};
+
+const char *ORIENTATION_NAMES[8] = {
+    "none", "hflip", "rot180", "vflip", "transpose", "rot90", "transverse", "rot270"
+};
+
+QImage createPattern(const QSize &size, QImage::Format format)
+{
+    QImage image(size, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+        for (int x = 0; x < image.width(); ++x) {
+            line[x] = qRgba(x & 0xff, y & 0xff, (x * 7 + y * 13) & 0xff, 255);
+        }
+    }
+    return image.convertToFormat(format);
+}
+
+QImage qtReference(const QImage &image, int orientation)
+{
+    QTransform rotate90;
+    rotate90.rotate(90);
+    QTransform rotate270;
+    rotate270.rotate(270);
+    switch (orientation) {
+    case 2:
+        return image.mirrored(true, false);
+    case 3:
+        return image.mirrored(true, true);
+    case 4:
+        return image.mirrored(false, true);
+    case 5:
+        return image.transformed(rotate90).mirrored(true, false);
+    case 6:
+        return image.transformed(rotate90);
+    case 7:
+        return image.transformed(rotate90).mirrored(false, true);
+    case 8:
+        return image.transformed(rotate270);
+    default:
+        return image;
+    }
+}
+
+// 返回多轮中的最短耗时(毫秒)
+double bestOf(const std::function<QImage()> &func, QImage &result)
+{
+    double best = -1;
+    for (int i = 0; i < ROUNDS; ++i) {
+        QElapsedTimer timer;
+        timer.start();
+        result = func();
+        const double elapsed = timer.nsecsElapsed() / 1e6;
+        if (best < 0 || elapsed < best) {
+            best = elapsed;
+        }
+    }
+    return best;
+}
+
+}
+
+/**
+ * 正交变换内核基准测试：对比各内核与QImage::transformed/mirrored的耗时，并逐位校验结果
+ * 用法: imagetransform-benchmark [width height]
+ */
+int main(int argc, char *argv[])
+{
+    QGuiApplication app(argc, argv);
+    QTextStream out(stdout);
+
+    QSize size(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+    if (argc >= 3) {
+        size = QSize(QString(argv[1]).toInt(), QString(argv[2]).toInt());
+    }
+
+    int mismatches = 0;
+    const QImage::Format formats[] = {QImage::Format_ARGB32, QImage::Format_RGB888};
+    for (QImage::Format format : formats) {
+        const QImage image = createPattern(size, format);
+        const double mpix = size.width() * static_cast<double>(size.height()) / 1e6;
+        out << "format " << format << ", " << size.width() << "x" << size.height() << Qt::endl;
+
+        for (int orientation = 2; orientation <= 8; ++orientation) {
+            QImage expected;
+            const double qtTime = bestOf([&]() { return qtReference(image, orientation); }, expected);
+            out << QString("  %1 qt %2 ms").arg(ORIENTATION_NAMES[orientation - 1], -10).arg(qtTime, 0, 'f', 2);
+
+            for (const KernelName &kernel : KERNELS) {
+                if (!LibUnionImage_NameSpace::isTransformKernelSupported(kernel.kernel)) {
+                    continue;
+                }
+                QImage result;
+                const double time = bestOf([&]() {
+                    return LibUnionImage_NameSpace::orientImage(image, orientation, kernel.kernel);
+                }, result);
+                const bool same = (result == expected);
+                if (!same) {
+                    ++mismatches;
+                }
+                out << QString(" | %1 %2 ms (%3 Mpix/s)%4").arg(kernel.name).arg(time, 0, 'f', 2)
+                    .arg(mpix * 1000 / time, 0, 'f', 0).arg(same ? "" : " MISMATCH");
+            }
+            out << Qt::endl;
+        }
+    }
+
+    out << (mismatches ? "FAILED" : "OK") << ", mismatches: " << mismatches << Qt::endl;
+    return mismatches ? 1 : 0;
+}
@@ -12,6 +12,11 @@
 #define  private public
 #include "viewpanel/scen/imagegraphicsview.h"
 #include "viewpanel/scen/imagesvgitem.h"
+#include "viewpanel/scen/graphicsitem.h"
+#include "service/decodedimagecache.h"
+#include "unionimage/tiledimagesource.h"
+
+#include <QStyleOptionGraphicsItem>
 
 
 //view panel
@@ -172,6 +177,177 @@ TEST_F(gtestview, imagegraphicsview_slotRotatePixmap)
 
 }
 
+TEST_F(gtestview, imagegraphicsview_rotateItemOnly)
+{
+    LibImageGraphicsView *widget = new LibImageGraphicsView(nullptr);
+
+    widget->resize(1090, 1080);
+    widget->show();
+    QImage source(300, 200, QImage::Format_RGB32);
+    source.fill(Qt::red);
+    widget->setImage(QApplication::applicationDirPath() + "/jpg.jpg", source);
+    QTest::qWait(200);
+    ASSERT_NE(widget->m_pixmapItem, nullptr);
+
+    // 旋转只改变图元角度，不重建图元也不改变其像素
+    LibGraphicsPixmapItem *item = widget->m_pixmapItem;
+    const QSize pixmapSize = item->pixmap().size();
+    EXPECT_TRUE(widget->slotRotatePixmap(90));
+    EXPECT_EQ(widget->m_pixmapItem, item);
+    EXPECT_EQ(item->pixmap().size(), pixmapSize);
+    EXPECT_EQ(qRound(item->rotation()), 90);
+    EXPECT_EQ(widget->displayImageSize(), pixmapSize.transposed());
+    EXPECT_EQ(widget->image().size(), pixmapSize.transposed());
+    EXPECT_EQ(widget->sceneRect().topLeft(), QPointF(0, 0));
+
+    widget->slotRotatePixmap(-90);
+    EXPECT_EQ(qRound(item->rotation()), 0);
+    EXPECT_EQ(widget->image().size(), pixmapSize);
+
+    widget->m_rotateAngel = 0;
+    widget->deleteLater();
+    widget = nullptr;
+}
+
+TEST_F(gtestview, imagegraphicsview_rotateWriteBack)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    // 4x2图片，最左一列为红色
+    QImage source(4, 2, QImage::Format_RGB32);
+    source.fill(Qt::blue);
+    source.setPixel(0, 0, qRgb(255, 0, 0));
+    source.setPixel(0, 1, qRgb(255, 0, 0));
+    const QString first = dir.path() + "/first.png";
+    const QString second = dir.path() + "/second.png";
+    const QString third = dir.path() + "/third.png";
+    ASSERT_TRUE(source.save(first));
+    ASSERT_TRUE(source.save(second));
+    ASSERT_TRUE(source.save(third));
+
+    LibImageGraphicsView *widget = new LibImageGraphicsView(nullptr);
+    widget->resize(1090, 1080);
+    widget->show();
+    widget->setImage(first, source);
+    QTest::qWait(200);
+    ASSERT_NE(widget->m_pixmapItem, nullptr);
+
+    // 回写未完成时再次旋转并切换图片，两次旋转都写入原来的文件
+    widget->slotRotatePixmap(90);
+    widget->slotRotatePixCurrent();
+    widget->slotRotatePixmap(90);
+    widget->slotRotatePixCurrent();
+    widget->setImage(second, source);
+    widget->flushRotation();
+    QImage result(first);
+    EXPECT_EQ(QSize(4, 2), result.size());
+    EXPECT_EQ(qRgb(255, 0, 0), result.pixel(3, 0));
+    EXPECT_EQ(qRgb(0, 0, 255), result.pixel(0, 0));
+    result = QImage(second);
+    EXPECT_EQ(qRgb(255, 0, 0), result.pixel(0, 0));
+
+    // 销毁视图时同步写入最后一次旋转
+    widget->setImage(third, source);
+    QTest::qWait(200);
+    ASSERT_NE(widget->m_pixmapItem, nullptr);
+    widget->slotRotatePixmap(90);
+    delete widget;
+    widget = nullptr;
+    result = QImage(third);
+    EXPECT_EQ(QSize(2, 4), result.size());
+    EXPECT_EQ(qRgb(255, 0, 0), result.pixel(0, 0));
+    EXPECT_EQ(qRgb(255, 0, 0), result.pixel(1, 0));
+    EXPECT_EQ(qRgb(0, 0, 255), result.pixel(0, 3));
+}
+
+TEST_F(gtestview, imagegraphicsview_rotateSwitchBack)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    // 4x2图片，最左一列为红色
+    QImage source(4, 2, QImage::Format_RGB32);
+    source.fill(Qt::blue);
+    source.setPixel(0, 0, qRgb(255, 0, 0));
+    source.setPixel(0, 1, qRgb(255, 0, 0));
+    const QString first = dir.path() + "/first.png";
+    const QString second = dir.path() + "/second.png";
+    ASSERT_TRUE(source.save(first));
+    ASSERT_TRUE(source.save(second));
+
+    LibImageGraphicsView *widget = new LibImageGraphicsView(nullptr);
+    widget->resize(1090, 1080);
+    widget->show();
+    widget->setImage(first, source);
+    QTest::qWait(200);
+    ASSERT_NE(widget->m_pixmapItem, nullptr);
+
+    // 模拟已预取的旋转前的解码结果，加入回写队列时丢弃
+    LibDecodedImageCache *cache = LibDecodedImageCache::instance();
+    cache->insert(first, source);
+    ASSERT_TRUE(cache->contains(first));
+    widget->slotRotatePixmap(90);
+    widget->slotRotatePixCurrent();
+    EXPECT_FALSE(cache->contains(first));
+
+    // 回写完成前切换出去再切换回来，等待回写后加载旋转后的内容
+    widget->setImage(second);
+    widget->setImage(first);
+    for (int i = 0; i < 250 && (widget->m_newImageLoadPhase != LibImageGraphicsView::FullFinish
+                                || !widget->m_pixmapItem || widget->m_pixmapItem->pixmap().isNull()); ++i) {
+        QTest::qWait(20);
+    }
+    ASSERT_EQ(widget->m_newImageLoadPhase, LibImageGraphicsView::FullFinish);
+    ASSERT_NE(widget->m_pixmapItem, nullptr);
+    const QImage shown = widget->m_pixmapItem->pixmap().toImage();
+    EXPECT_EQ(QSize(2, 4), shown.size());
+    EXPECT_EQ(qRgb(255, 0, 0), shown.pixel(0, 0));
+    EXPECT_EQ(qRgb(0, 0, 255), shown.pixel(0, 3));
+    EXPECT_FALSE(widget->isRotateWritePending(first));
+
+    delete widget;
+    widget = nullptr;
+    cache->remove(first);
+}
+
+TEST_F(gtestview, graphicsitem_lazyMipmaps)
+{
+    QPixmap pixmap(2048, 1024);
+    pixmap.fill(Qt::blue);
+    LibGraphicsPixmapItem item(pixmap);
+    // 设置图片时不生成多级图片
+    EXPECT_FALSE(item.m_mipmapsRequested);
+    EXPECT_EQ(nullptr, item.m_mipmapWatcher);
+
+    // 第一次缩小绘制时在后台生成
+    QImage canvas(600, 300, QImage::Format_ARGB32_Premultiplied);
+    QStyleOptionGraphicsItem option;
+    {
+        QPainter painter(&canvas);
+        painter.scale(0.25, 0.25);
+        item.paint(&painter, &option, nullptr);
+    }
+    EXPECT_TRUE(item.m_mipmapsRequested);
+    ASSERT_NE(nullptr, item.m_mipmapWatcher);
+    for (int i = 0; i < 100 && item.m_mipmaps.isEmpty(); ++i) {
+        QTest::qWait(20);
+    }
+    EXPECT_FALSE(item.m_mipmaps.isEmpty());
+
+    // 随后进入分块模式的预览图不生成多级图片
+    item.setPixmap(pixmap);
+    EXPECT_FALSE(item.m_mipmapsRequested);
+    EXPECT_TRUE(item.m_mipmaps.isEmpty());
+    item.setTiledSource(LibUnionImage_NameSpace::TiledImageSource::fromImage(pixmap.toImage()));
+    ASSERT_TRUE(item.isTiled());
+    {
+        QPainter painter(&canvas);
+        painter.scale(0.25, 0.25);
+        item.paint(&painter, &option, nullptr);
+    }
+    EXPECT_FALSE(item.m_mipmapsRequested);
+    EXPECT_TRUE(item.m_mipmaps.isEmpty());
+}
+
 TEST_F(gtestview, imagegraphicsview_slotRotatePixCurrentNull)
 {
     LibImageGraphicsView *widget = new LibImageGraphicsView(nullptr);
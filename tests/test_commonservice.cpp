@@ -4,6 +4,13 @@
 
 #include "gtestview.h"
 #include "service/commonservice.h"
+#include "service/decodedimagecache.h"
+#include "service/imagedataservice.h"
+#include "service/imageprefetcher.h"
+#include "service/taskscheduler.h"
+#include "service/thumbnailpack.h"
+#include "service/thumbnailrequestqueue.h"
+#include "service/thumbnailstore.h"
 
 TEST_F(gtestview, cp2Image)
 {
@@ -26,3 +33,398 @@ TEST_F(gtestview, commonservice_reName)
 //    EXPECT_EQ(true, bRet);
 }
 
+TEST_F(gtestview, decodedImageCache_hitAndInvalidate)
+{
+    // 在副本上修改文件时间，不影响其他用例共用的测试图片
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString path = dir.filePath("jpg171.jpg");
+    ASSERT_TRUE(QFile::copy(":/jpg.jpg", path));
+    QFile(path).setPermissions(QFile::WriteUser | QFile::ReadUser);
+    LibDecodedImageCache *cache = LibDecodedImageCache::instance();
+    const qint64 budget = cache->maxBytes();
+    cache->clear();
+
+    QImage first;
+    QImage second;
+    QString errMsg;
+    const quint64 hits = cache->hitCount();
+    const quint64 misses = cache->missCount();
+    ASSERT_TRUE(cache->loadImage(path, first, errMsg));
+    EXPECT_EQ(misses + 1, cache->missCount());
+    EXPECT_TRUE(cache->loadImage(path, second, errMsg));
+    EXPECT_EQ(hits + 1, cache->hitCount());
+    // 命中时共享同一份像素数据
+    EXPECT_EQ(first.constBits(), second.constBits());
+    EXPECT_GT(cache->totalBytes(), 0);
+
+    // 文件修改后旧条目失效
+    QFile file(path);
+    ASSERT_TRUE(file.open(QIODevice::ReadWrite));
+    EXPECT_TRUE(file.setFileTime(QDateTime::currentDateTime().addSecs(60), QFileDevice::FileModificationTime));
+    file.close();
+    EXPECT_FALSE(cache->find(path, second));
+
+    // 超过预算的图片不缓存
+    cache->setMaxBytes(0);
+    cache->insert(path, QImage(64, 64, QImage::Format_ARGB32));
+    EXPECT_FALSE(cache->find(path, second));
+
+    cache->setMaxBytes(budget);
+    cache->clear();
+}
+
+TEST_F(gtestview, decodedImageCache_tiledSource)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString path = dir.filePath("wide.jpg");
+    ASSERT_TRUE(QFile::copy(":/jpg.jpg", path));
+    LibDecodedImageCache *cache = LibDecodedImageCache::instance();
+    cache->clear();
+
+    QImage image(4096, 64, QImage::Format_RGB32);
+    image.fill(Qt::green);
+    cache->insert(path, image);
+    QImage cached;
+    QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> source;
+    ASSERT_TRUE(cache->find(path, cached, &source));
+    EXPECT_TRUE(source.isNull());
+
+    // 分块源与解码结果一同缓存，再次命中时返回同一个源
+    const qint64 imageBytes = cache->totalBytes();
+    const QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> built = LibUnionImage_NameSpace::TiledImageSource::fromImage(cached, path);
+    cache->setTiledSource(path, built);
+    ASSERT_TRUE(cache->find(path, cached, &source));
+    EXPECT_EQ(built, source);
+    EXPECT_GT(cache->totalBytes(), imageBytes);
+
+    // 由其他图片生成的源不附加，重新写入后不再返回旧的源
+    cache->insert(path, image.copy());
+    cache->setTiledSource(path, built);
+    ASSERT_TRUE(cache->find(path, cached, &source));
+    EXPECT_TRUE(source.isNull());
+
+    cache->clear();
+}
+
+TEST_F(gtestview, imagePrefetcher_directionWindow)
+{
+    QStringList paths;
+    for (int i = 160; i < 170; i++) {
+        paths << QApplication::applicationDirPath() + "/test/jpg" + QString::number(i) + ".jpg";
+    }
+    LibImagePrefetcher *prefetcher = LibImagePrefetcher::instance();
+
+    // 向后翻页时预取后续图片，并保留上一张
+    prefetcher->navigate(paths.at(4), paths);
+    prefetcher->navigate(paths.at(5), paths);
+    QStringList window = prefetcher->window();
+    ASSERT_GE(window.size(), 3);
+    EXPECT_EQ(paths.at(6), window.first());
+    EXPECT_EQ(paths.at(7), window.at(1));
+    EXPECT_EQ(paths.at(4), window.last());
+    EXPECT_FALSE(window.contains(paths.at(5)));
+
+    // 反向翻页时窗口随之反向
+    prefetcher->navigate(paths.at(4), paths);
+    window = prefetcher->window();
+    ASSERT_GE(window.size(), 3);
+    EXPECT_EQ(paths.at(3), window.first());
+    EXPECT_EQ(paths.at(5), window.last());
+
+    // 预取结果存入解码缓存
+    for (int i = 0; i < 50 && !LibDecodedImageCache::instance()->contains(paths.at(3)); i++) {
+        QThread::msleep(100);
+    }
+    EXPECT_TRUE(LibDecodedImageCache::instance()->contains(paths.at(3)));
+
+    prefetcher->cancel();
+    EXPECT_TRUE(prefetcher->window().isEmpty());
+    // 未在预取的图片不记录后续操作，由调用方直接加载
+    bool called = false;
+    EXPECT_FALSE(prefetcher->whenDecoded(paths.at(9), [&called]() { called = true; }));
+    EXPECT_FALSE(called);
+}
+
+TEST_F(gtestview, taskScheduler_priorityAndStats)
+{
+    LibTaskScheduler *scheduler = LibTaskScheduler::instance();
+    ASSERT_GE(scheduler->workerCount(), 2);
+
+    // 后台任务占满可用线程时，当前图片的任务仍能立即执行
+    const int oldCap = scheduler->maxConcurrency(LibTaskScheduler::BackgroundThumbnail);
+    scheduler->setMaxConcurrency(LibTaskScheduler::BackgroundThumbnail, scheduler->workerCount());
+    const quint64 finished = scheduler->stats(LibTaskScheduler::BackgroundThumbnail).finished;
+    QSemaphore release;
+    for (int i = 0; i < scheduler->workerCount() * 4; i++) {
+        scheduler->post(LibTaskScheduler::BackgroundThumbnail, [&release]() {
+            release.acquire();
+        });
+    }
+    QFuture<int> visible = scheduler->run(LibTaskScheduler::VisibleImage, []() {
+        return 42;
+    });
+    visible.waitForFinished();
+    EXPECT_EQ(42, visible.result());
+    EXPECT_LT(scheduler->stats(LibTaskScheduler::BackgroundThumbnail).running, scheduler->workerCount());
+
+    release.release(scheduler->workerCount() * 4);
+    EXPECT_TRUE(scheduler->waitForIdle(5000));
+    EXPECT_EQ(finished + scheduler->workerCount() * 4, scheduler->stats(LibTaskScheduler::BackgroundThumbnail).finished);
+    scheduler->setMaxConcurrency(LibTaskScheduler::BackgroundThumbnail, oldCap);
+
+    QList<int> values {1, 2, 3, 4};
+    QFuture<void> mapped = scheduler->map(LibTaskScheduler::Metadata, values, [](int &value) {
+        value *= 2;
+    });
+    mapped.waitForFinished();
+    EXPECT_EQ(QList<int>({2, 4, 6, 8}), values);
+}
+
+TEST_F(gtestview, thumbnailStore_budgetEvictsFarthest)
+{
+    LibThumbnailStore *store = LibThumbnailStore::instance();
+    const qint64 budget = store->maxBytes();
+    const int visualIndex = store->visualIndex();
+    store->clear();
+
+    QStringList paths;
+    for (int i = 0; i < 10; i++) {
+        paths << QString("/tmp/thumbnailstore/%1.jpg").arg(i);
+    }
+    QImage thumbnail(100, 100, QImage::Format_ARGB32);
+    thumbnail.fill(Qt::red);
+
+    // 预算可容纳4张，可见位置在列表中部
+    store->setMaxBytes(thumbnail.sizeInBytes() * 4);
+    store->setOrder(paths);
+    store->setVisualIndex(5);
+    for (const QString &path : paths) {
+        store->insert(path, thumbnail);
+        EXPECT_LE(store->totalBytes(), store->maxBytes());
+    }
+
+    // 保留距离可见位置最近的图片，最远的被淘汰并记录
+    QImage image;
+    EXPECT_TRUE(store->find(paths.at(5), image));
+    EXPECT_EQ(thumbnail.constBits(), image.constBits());
+    EXPECT_FALSE(store->contains(paths.at(0)));
+    EXPECT_TRUE(store->takeEvicted(paths.at(0)));
+    EXPECT_FALSE(store->takeEvicted(paths.at(0)));
+
+    // 缩略图只保存一份，信息表中取出时附带
+    imageViewerSpace::ItemInfo info;
+    info.path = paths.at(5);
+    info.image = thumbnail;
+    LibCommonService::instance()->slotSetImgInfoByPath(info.path, info);
+    EXPECT_EQ(thumbnail.constBits(), LibCommonService::instance()->getImgInfoByPath(info.path).image.constBits());
+
+    // 缩略图被淘汰后，内嵌预览不能覆盖已读取的图片类型和原始尺寸
+    info.imageType = imageViewerSpace::ImageTypeStatic;
+    info.imgOriginalWidth = 4000;
+    info.imgOriginalHeight = 3000;
+    LibCommonService::instance()->slotSetImgInfoByPath(info.path, info);
+    store->remove(info.path);
+    imageViewerSpace::ItemInfo preview;
+    preview.path = info.path;
+    preview.imgOriginalWidth = 160;
+    preview.imgOriginalHeight = 120;
+    preview.image = thumbnail;
+    EXPECT_FALSE(LibCommonService::instance()->setImgPreviewByPath(preview.path, preview));
+    const imageViewerSpace::ItemInfo stored = LibCommonService::instance()->getImgInfoByPath(info.path);
+    EXPECT_EQ(imageViewerSpace::ImageTypeStatic, stored.imageType);
+    EXPECT_EQ(4000, stored.imgOriginalWidth);
+    EXPECT_EQ(3000, stored.imgOriginalHeight);
+
+    store->clear();
+    store->setOrder(QStringList());
+    store->setVisualIndex(visualIndex);
+    store->setMaxBytes(budget);
+}
+
+TEST_F(gtestview, thumbnailPack_persistAndRecover)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString path = QApplication::applicationDirPath() + "/test/jpg5.jpg";
+
+    imageViewerSpace::ItemInfo info;
+    info.image = QImage(200, 150, QImage::Format_RGB32);
+    info.image.fill(Qt::blue);
+    info.imgOriginalWidth = 4000;
+    info.imgOriginalHeight = 3000;
+    info.imageType = imageViewerSpace::ImageTypeStatic;
+
+    {
+        LibThumbnailPack pack(dir.path());
+        ASSERT_TRUE(pack.isValid());
+        EXPECT_TRUE(pack.insert(path, info));
+        // 重复写入后旧条目失效，压缩后丢弃
+        EXPECT_TRUE(pack.insert(path, info));
+        EXPECT_EQ(1, pack.count());
+        EXPECT_GT(pack.deadBytes(), 0);
+        EXPECT_TRUE(pack.compact());
+        EXPECT_EQ(0, pack.deadBytes());
+    }
+
+    // 重新打开后读取，尾部未提交的数据不截断(其他进程可能仍映射着)，之后的写入从提交长度处覆盖
+    QFile packFile(dir.path() + "/thumbnails.pack");
+    ASSERT_TRUE(packFile.open(QIODevice::Append));
+    packFile.write(QByteArray(100, 'x'));
+    packFile.close();
+    const qint64 packSizeWithTail = QFileInfo(packFile.fileName()).size();
+    {
+        LibThumbnailPack pack(dir.path());
+        imageViewerSpace::ItemInfo result;
+        EXPECT_TRUE(pack.find(path, result));
+        EXPECT_EQ(info.image.size(), result.image.size());
+        EXPECT_EQ(info.image.pixel(10, 10), result.image.pixel(10, 10));
+        EXPECT_EQ(4000, result.imgOriginalWidth);
+        EXPECT_EQ(imageViewerSpace::ImageTypeStatic, result.imageType);
+        EXPECT_EQ(packSizeWithTail, QFileInfo(packFile.fileName()).size());
+        EXPECT_LT(pack.packBytes(), packSizeWithTail);
+
+        // 未命中时输出的身份包含内容采样哈希，写入时直接复用
+        const QString other = dir.path() + "/other.jpg";
+        QFile otherFile(other);
+        ASSERT_TRUE(otherFile.open(QIODevice::WriteOnly));
+        otherFile.write(QByteArray(1024, 'o'));
+        otherFile.close();
+        LibUnionImage_NameSpace::FileIdentity identity;
+        EXPECT_FALSE(pack.find(other, result, &identity));
+        EXPECT_TRUE(identity.isValid());
+        EXPECT_NE(0u, identity.contentHash);
+        EXPECT_TRUE(pack.insert(other, info, identity));
+        EXPECT_TRUE(pack.find(other, result));
+        EXPECT_TRUE(pack.find(path, result));
+        EXPECT_GE(QFileInfo(packFile.fileName()).size(), packSizeWithTail);
+    }
+
+    // 索引损坏时扫描打包文件重建
+    QFile indexFile(dir.path() + "/thumbnails.idx");
+    ASSERT_TRUE(indexFile.open(QIODevice::WriteOnly | QIODevice::Truncate));
+    indexFile.write(QByteArray(64, 'x'));
+    indexFile.close();
+    {
+        LibThumbnailPack pack(dir.path());
+        imageViewerSpace::ItemInfo result;
+        EXPECT_TRUE(pack.find(path, result));
+        EXPECT_EQ(2, pack.count());
+    }
+
+    // 超过三个采样块大小的文件，修改采样块之外的数据时内容哈希不变
+    const QString original = dir.path() + "/original.jpg";
+    QFile file(original);
+    ASSERT_TRUE(file.open(QIODevice::WriteOnly));
+    file.write(QByteArray(512 * 1024, 'a'));
+    file.close();
+    {
+        LibThumbnailPack pack(dir.path());
+        EXPECT_TRUE(pack.insert(original, info));
+        const int records = pack.count();
+
+        // 移动后按内容找回，并为新身份建立链接，再次查找直接命中，压缩后链接仍然有效
+        const QString moved = dir.path() + "/moved.jpg";
+        ASSERT_TRUE(QFile::copy(original, moved));
+        ASSERT_TRUE(QFile::remove(original));
+        imageViewerSpace::ItemInfo result;
+        EXPECT_TRUE(pack.find(moved, result));
+        EXPECT_EQ(info.image.pixel(10, 10), result.image.pixel(10, 10));
+        EXPECT_EQ(records + 1, pack.count());
+        EXPECT_TRUE(pack.find(moved, result));
+        EXPECT_EQ(records + 1, pack.count());
+        EXPECT_TRUE(pack.compact());
+        EXPECT_TRUE(pack.find(moved, result));
+        EXPECT_EQ(records + 1, pack.count());
+
+        // 重命名不改变内容和修改时间，仍可复用
+        const QString renamed = dir.path() + "/renamed.jpg";
+        ASSERT_TRUE(QFile::rename(moved, renamed));
+        EXPECT_TRUE(pack.find(renamed, result));
+
+        // 原地修改采样块之外的数据，大小不变，旧缩略图不能再使用
+        const QString inPlace = dir.path() + "/inplace.jpg";
+        QFile edited(inPlace);
+        ASSERT_TRUE(edited.open(QIODevice::WriteOnly));
+        edited.write(QByteArray(512 * 1024, 'c'));
+        edited.close();
+        EXPECT_TRUE(pack.insert(inPlace, info));
+        EXPECT_TRUE(pack.find(inPlace, result));
+        ASSERT_TRUE(edited.open(QIODevice::ReadWrite));
+        ASSERT_TRUE(edited.seek(100 * 1024));
+        edited.write("b", 1);
+        edited.setFileTime(QDateTime::currentDateTime().addSecs(60), QFileDevice::FileModificationTime);
+        edited.close();
+        EXPECT_FALSE(pack.find(inPlace, result));
+    }
+}
+
+TEST_F(gtestview, imageDataService_readThumbnailDrainAndCancel)
+{
+    LibImageDataService *service = LibImageDataService::instance();
+    service->stopReadThumbnail();
+    ASSERT_TRUE(service->waitForReadThumbnail(10000));
+
+    QStringList paths;
+    for (int i = 180; i < 184; ++i) {
+        const QString path = QApplication::applicationDirPath() + QString("/test/jpg%1.jpg").arg(i);
+        LibThumbnailStore::instance()->remove(path);
+        paths << path;
+    }
+    const quint64 finished = service->thumbnailStats().finished;
+    EXPECT_TRUE(service->readThumbnailByPaths(QString(), paths, false));
+    EXPECT_TRUE(service->waitForReadThumbnail(10000));
+
+    LibImageDataService::ThumbnailStats stats = service->thumbnailStats();
+    EXPECT_EQ(0, stats.queued);
+    EXPECT_EQ(0, stats.inFlight);
+    EXPECT_EQ(finished + static_cast<quint64>(paths.size()), stats.finished);
+    EXPECT_GE(stats.maxLatencyMs, stats.lastLatencyMs);
+
+    // 取消后排队的请求被丢弃，已投递的任务直接结束
+    for (const QString &path : paths) {
+        LibThumbnailStore::instance()->remove(path);
+    }
+    service->readThumbnailByPaths(QString(), paths, false);
+    service->stopReadThumbnail();
+    EXPECT_EQ(0, service->thumbnailStats().queued);
+    EXPECT_TRUE(service->waitForReadThumbnail(10000));
+}
+
+TEST_F(gtestview, thumbnailRequestQueue_centerOutAndDrop)
+{
+    LibThumbnailRequestQueue queue;
+    for (int i = 0; i < 20; ++i) {
+        queue.push(QString("/tmp/%1.jpg").arg(i), i);
+    }
+    queue.push("/tmp/unranked.jpg", -1);
+    EXPECT_EQ(21, queue.size());
+
+    // 可见范围内的先取出，之后由近及远
+    queue.setVisibleRange(8, 9);
+    EXPECT_EQ(QString("/tmp/8.jpg"), queue.pop());
+    EXPECT_EQ(QString("/tmp/9.jpg"), queue.pop());
+    QStringList next;
+    next << queue.pop() << queue.pop();
+    EXPECT_TRUE(next.contains("/tmp/7.jpg"));
+    EXPECT_TRUE(next.contains("/tmp/10.jpg"));
+
+    // 滚动后按新范围取出，过远的请求被丢弃
+    queue.setVisibleRange(18, 19, 3);
+    EXPECT_EQ(QString("/tmp/18.jpg"), queue.pop());
+    EXPECT_FALSE(queue.contains("/tmp/0.jpg"));
+    EXPECT_TRUE(queue.takeDropped("/tmp/0.jpg"));
+    EXPECT_FALSE(queue.takeDropped("/tmp/0.jpg"));
+    EXPECT_EQ(5, queue.size());
+
+    // 行号变化后重新排列
+    QHash<QString, int> rows;
+    rows.insert("/tmp/unranked.jpg", 19);
+    queue.reorder(rows);
+    EXPECT_EQ(QString("/tmp/unranked.jpg"), queue.pop());
+
+    queue.clear();
+    EXPECT_TRUE(queue.isEmpty());
+    EXPECT_TRUE(queue.pop().isEmpty());
+}
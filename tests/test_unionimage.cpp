@@ -11,13 +11,27 @@
 #include "viewpanel/navigationwidget.h"
 #define  private public
 #include "unionimage/baseutils.h"
+#include "unionimage/fileidentity.h"
 #include "unionimage/imageutils.h"
 #include "unionimage/imgoperate.h"
 #include "unionimage/pluginbaseutils.h"
 #include "unionimage/snifferimageformat.h"
 #include "unionimage/unionimage.h"
+#include "unionimage/imageexif.h"
+#include "unionimage/imagetransform.h"
+#include "unionimage/tiffdecoder.h"
+#include "unionimage/tiledimagesource.h"
+#include "unionimage/progressivedecoder.h"
 #include "service/commonservice.h"
 
+#include <QUrl>
+#include <QImageReader>
+#include <QImageWriter>
+#include <QScopeGuard>
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+#include <QColorSpace>
+#endif
+
 
 TEST_F(gtestview, baseutils_trashFileNull)
 {
@@ -146,3 +160,526 @@ TEST_F(gtestview, image_supportedImageFormats)
 {
     pluginUtils::base::supportedImageFormats();
 }
+
+TEST_F(gtestview, unionimage_probeImageJpg)
+{
+    LibUnionImage_NameSpace::ImageProbeInfo info = LibUnionImage_NameSpace::probeImage(QApplication::applicationDirPath() + "/test/jpg170.jpg");
+    EXPECT_EQ(QString("JPG"), info.format);
+    EXPECT_EQ(imageViewerSpace::ImageTypeStatic, info.imageType);
+    EXPECT_TRUE(info.size.isValid());
+
+    QImage image;
+    QString errMsg;
+    EXPECT_TRUE(LibUnionImage_NameSpace::loadStaticImageFromFile(info.path, image, errMsg, info));
+    EXPECT_FALSE(image.isNull());
+}
+
+TEST_F(gtestview, unionimage_rotateImageAngles)
+{
+    QImage image(40, 20, QImage::Format_RGB32);
+    image.fill(Qt::red);
+    // 90度倍数宽高互换，其余角度插值旋转后外接矩形变大
+    QImage rotated = image;
+    EXPECT_TRUE(LibUnionImage_NameSpace::rotateImage(90, rotated));
+    EXPECT_EQ(QSize(20, 40), rotated.size());
+    rotated = image;
+    EXPECT_TRUE(LibUnionImage_NameSpace::rotateImage(45, rotated));
+    EXPECT_GT(rotated.width(), image.width());
+    EXPECT_GT(rotated.height(), image.height());
+
+    QImage null;
+    EXPECT_FALSE(LibUnionImage_NameSpace::rotateImage(45, null));
+}
+
+TEST_F(gtestview, unionimage_probeImageRawSuffix)
+{
+    // RAW文件内容检测为TIFF，解码时仍按后缀交给RAW插件，避免只解出内嵌预览图
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString raw = dir.path() + "/raw.nef";
+    const QString unknown = dir.path() + "/raw.xyz";
+    const QString noSuffix = dir.path() + "/raw";
+    ASSERT_TRUE(QFile::copy(":/tif.tif", raw));
+    ASSERT_TRUE(QFile::copy(":/tif.tif", unknown));
+    ASSERT_TRUE(QFile::copy(":/tif.tif", noSuffix));
+
+    LibUnionImage_NameSpace::ImageProbeInfo info = LibUnionImage_NameSpace::probeImage(raw);
+    EXPECT_EQ(QString("NEF"), info.suffix);
+    EXPECT_EQ(QString("TIFF"), info.format);
+    EXPECT_EQ(QString("NEF"), info.readFormat());
+
+    // 后缀不支持或缺失时使用检测到的格式
+    info = LibUnionImage_NameSpace::probeImage(unknown);
+    EXPECT_EQ(QString("TIFF"), info.readFormat());
+    info = LibUnionImage_NameSpace::probeImage(noSuffix);
+    EXPECT_EQ(QString("TIFF"), info.readFormat());
+    EXPECT_EQ(imageViewerSpace::ImageTypeStatic, info.imageType);
+}
+
+TEST_F(gtestview, unionimage_probeImageNull)
+{
+    LibUnionImage_NameSpace::ImageProbeInfo info = LibUnionImage_NameSpace::probeImage("");
+    EXPECT_EQ(imageViewerSpace::ImageTypeBlank, info.imageType);
+    EXPECT_EQ(0, info.frameCount);
+}
+
+TEST_F(gtestview, unionimage_loadStaticImageScaled)
+{
+    // 使用未被其他用例旋转过的副本，原图为1600x900
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    const QString path = dir.path() + "/scaled.jpg";
+    ASSERT_TRUE(QFile::copy(":/jpg.jpg", path));
+    QImage full;
+    QImage scaled;
+    QString errMsg;
+    ASSERT_TRUE(LibUnionImage_NameSpace::loadStaticImageFromFile(path, full, errMsg));
+    ASSERT_EQ(QSize(1600, 900), full.size());
+
+    // 目标尺寸很小时按DCT的1/8比例解码，结果小于原图且不小于目标尺寸
+    ASSERT_TRUE(LibUnionImage_NameSpace::loadStaticImageFromFile(path, scaled, errMsg, "", QSize(16, 16)));
+    EXPECT_EQ(QSize(200, 112), scaled.size());
+
+    // 1/8比例小于目标尺寸时退到1/4
+    ASSERT_TRUE(LibUnionImage_NameSpace::loadStaticImageFromFile(path, scaled, errMsg, "", QSize(300, 150)));
+    EXPECT_EQ(QSize(400, 225), scaled.size());
+    EXPECT_LT(scaled.width(), full.width());
+    EXPECT_GE(scaled.width(), 300);
+    EXPECT_GE(scaled.height(), 150);
+}
+
+TEST_F(gtestview, unionimage_readExifData)
+{
+    LibUnionImage_NameSpace::ExifData exif;
+    EXPECT_FALSE(LibUnionImage_NameSpace::readExifData(QApplication::applicationDirPath() + "/gif.gif", exif));
+    EXPECT_EQ(1, exif.orientation);
+    EXPECT_FALSE(exif.hasThumbnail());
+
+    QImage preview = LibUnionImage_NameSpace::loadExifThumbnail(QApplication::applicationDirPath() + "/test/jpg170.jpg", &exif);
+    if (!exif.hasThumbnail()) {
+        EXPECT_TRUE(preview.isNull());
+    }
+}
+
+TEST_F(gtestview, unionimage_loadExifThumbnailEmbedded)
+{
+    // 主图96x64为棋盘格，EXIF方向为6，IFD1内嵌16x8左暗右亮的缩略图
+    LibUnionImage_NameSpace::ExifData exif;
+    const QImage preview = LibUnionImage_NameSpace::loadExifThumbnail(":/exifthumb.jpg", &exif);
+    EXPECT_TRUE(exif.hasThumbnail());
+    EXPECT_EQ(6, exif.orientation);
+    EXPECT_EQ(QSize(96, 64), exif.pixelSize);
+    EXPECT_TRUE(exif.thumbnail.isEmpty());
+
+    // 结果来自内嵌缩略图而非主图：尺寸为缩略图旋转后的8x16，顺时针旋转后左侧暗区到了上方
+    ASSERT_FALSE(preview.isNull());
+    EXPECT_EQ(QSize(8, 16), preview.size());
+    EXPECT_LT(qGray(preview.pixel(4, 2)), 80);
+    EXPECT_GT(qGray(preview.pixel(4, 13)), 180);
+}
+
+TEST_F(gtestview, unionimage_orientImage)
+{
+    QImage image(37, 21, QImage::Format_ARGB32);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x) {
+            image.setPixel(x, y, qRgba(x * 5, y * 7, (x + y) & 0xff, 255));
+        }
+    }
+
+    QTransform rotate90;
+    rotate90.rotate(90);
+    QTransform rotate270;
+    rotate270.rotate(270);
+    EXPECT_EQ(image, LibUnionImage_NameSpace::orientImage(image, 1));
+    EXPECT_EQ(image.mirrored(true, false), LibUnionImage_NameSpace::orientImage(image, 2));
+    EXPECT_EQ(image.mirrored(true, true), LibUnionImage_NameSpace::orientImage(image, 3));
+    EXPECT_EQ(image.mirrored(false, true), LibUnionImage_NameSpace::orientImage(image, 4));
+    EXPECT_EQ(image.transformed(rotate90).mirrored(true, false), LibUnionImage_NameSpace::orientImage(image, 5));
+    EXPECT_EQ(image.transformed(rotate90), LibUnionImage_NameSpace::orientImage(image, 6));
+    EXPECT_EQ(image.transformed(rotate90).mirrored(false, true), LibUnionImage_NameSpace::orientImage(image, 7));
+    EXPECT_EQ(image.transformed(rotate270), LibUnionImage_NameSpace::orientImage(image, 8));
+
+    EXPECT_EQ(6, LibUnionImage_NameSpace::orientationAfterRotation(1, 90));
+    EXPECT_EQ(1, LibUnionImage_NameSpace::orientationAfterRotation(6, -90));
+    EXPECT_EQ(7, LibUnionImage_NameSpace::orientationAfterRotation(2, 90));
+}
+
+TEST_F(gtestview, unionimage_orientImageKernels)
+{
+    QTransform rotate90;
+    rotate90.rotate(90);
+    QTransform rotate270;
+    rotate270.rotate(270);
+
+    // 奇数尺寸覆盖微内核边缘，大图覆盖多线程分带
+    const QList<QSize> sizes = {QSize(67, 45), QSize(2101, 2053)};
+    const QList<QImage::Format> formats = {QImage::Format_ARGB32, QImage::Format_RGB888};
+    const QList<LibUnionImage_NameSpace::TransformKernel> kernels = {
+        LibUnionImage_NameSpace::TransformKernelScalar, LibUnionImage_NameSpace::TransformKernelSSE2,
+        LibUnionImage_NameSpace::TransformKernelAVX2, LibUnionImage_NameSpace::TransformKernelNEON
+    };
+    for (const QSize &size : sizes) {
+        for (QImage::Format format : formats) {
+            QImage image(size, QImage::Format_ARGB32);
+            for (int y = 0; y < image.height(); ++y) {
+                QRgb *line = reinterpret_cast<QRgb *>(image.scanLine(y));
+                for (int x = 0; x < image.width(); ++x) {
+                    line[x] = qRgba(x & 0xff, y & 0xff, (x >> 8) ^ (y >> 8), 255);
+                }
+            }
+            image = image.convertToFormat(format);
+
+            const QImage expected[8] = {
+                image, image.mirrored(true, false), image.mirrored(true, true), image.mirrored(false, true),
+                image.transformed(rotate90).mirrored(true, false), image.transformed(rotate90),
+                image.transformed(rotate90).mirrored(false, true), image.transformed(rotate270)
+            };
+            for (LibUnionImage_NameSpace::TransformKernel kernel : kernels) {
+                if (!LibUnionImage_NameSpace::isTransformKernelSupported(kernel)) {
+                    continue;
+                }
+                for (int orientation = 2; orientation <= 8; ++orientation) {
+                    EXPECT_EQ(expected[orientation - 1], LibUnionImage_NameSpace::orientImage(image, orientation, kernel));
+                }
+            }
+        }
+    }
+    EXPECT_TRUE(LibUnionImage_NameSpace::isTransformKernelSupported(LibUnionImage_NameSpace::TransformKernelAuto));
+}
+
+TEST_F(gtestview, unionimage_detectImageFormatFromData)
+{
+    EXPECT_EQ("png", DetectImageFormatFromData(QByteArray("\x89PNG\r\n\x1a\n\0\0\0\rIHDR", 16)));
+    EXPECT_EQ("jpg", DetectImageFormatFromData(QByteArray("\xff\xd8\xff\xe0", 4)));
+    EXPECT_EQ("webp", DetectImageFormatFromData(QByteArray("RIFF\x24\0\0\0WEBPVP8 ", 16)));
+    EXPECT_EQ("cr2", DetectImageFormatFromData(QByteArray("II*\0\x10\0\0\0CR\x02\0", 12)));
+    EXPECT_EQ("tiff", DetectImageFormatFromData(QByteArray("MM\0*\0\0\0\x08", 8)));
+    EXPECT_EQ("heic", DetectImageFormatFromData(QByteArray("\0\0\0\x18" "ftypheic\0\0\0\0mif1heic", 24)));
+    EXPECT_EQ("avif", DetectImageFormatFromData(QByteArray("\0\0\0\x1c" "ftypmif1\0\0\0\0mif1avifmiaf", 28)));
+    EXPECT_EQ("", DetectImageFormatFromData(QByteArray("\0\0\0\x18" "ftypisom\0\0\0\0isomavc1", 24)));
+    EXPECT_EQ("jp2", DetectImageFormatFromData(QByteArray("\0\0\0\x0cjP  \r\n\x87\n", 12)));
+    EXPECT_EQ("psd", DetectImageFormatFromData(QByteArray("8BPS\0\x01", 6)));
+    EXPECT_EQ("ppm", DetectImageFormatFromData("P6\n640 480\n255\n"));
+    EXPECT_EQ("svg", DetectImageFormatFromData("<?xml version=\"1.0\"?>\n<svg xmlns=\"http://www.w3.org/2000/svg\">"));
+
+    QByteArray tga(18, '\0');
+    tga[2] = 2;
+    tga[12] = 64;
+    tga[14] = 32;
+    tga[16] = 32;
+    EXPECT_EQ("tga", DetectImageFormatFromData(tga));
+    EXPECT_EQ("", DetectImageFormatFromData("plain text file"));
+
+    EXPECT_EQ("jpg", DetectImageFormat(QApplication::applicationDirPath() + "/test/jpg170.jpg"));
+    EXPECT_EQ("gif", DetectImageFormat(QApplication::applicationDirPath() + "/gif.gif"));
+}
+
+TEST_F(gtestview, unionimage_decodeTiffImage)
+{
+    // 缓存写入临时目录，不影响用户的缓存目录
+    QTemporaryDir cacheHome;
+    ASSERT_TRUE(cacheHome.isValid());
+    const QByteArray oldCacheHome = qgetenv("XDG_CACHE_HOME");
+    qputenv("XDG_CACHE_HOME", QFile::encodeName(cacheHome.path()));
+    auto restoreCacheHome = qScopeGuard([&oldCacheHome]() {
+        if (oldCacheHome.isEmpty()) {
+            qunsetenv("XDG_CACHE_HOME");
+        } else {
+            qputenv("XDG_CACHE_HOME", oldCacheHome);
+        }
+    });
+    ASSERT_TRUE(LibUnionImage_NameSpace::tiffCachePath().startsWith(cacheHome.path()));
+
+    const QString path = QApplication::applicationDirPath() + "/tif.tif";
+    QImage image;
+    QString errMsg;
+    ASSERT_TRUE(LibUnionImage_NameSpace::decodeTiffImage(path, image, errMsg)) << errMsg.toStdString();
+    QImageReader reader(path);
+    reader.setAutoTransform(true);
+    const QImage expected = reader.read();
+    ASSERT_FALSE(expected.isNull());
+    EXPECT_EQ(expected.size(), image.size());
+
+    // 第一次读取写入持久化缓存，第二次命中缓存，结果与解码一致
+    QImage first;
+    QImage cached;
+    ASSERT_TRUE(LibUnionImage_NameSpace::loadTiffImageCached(path, first, errMsg));
+    ASSERT_EQ(1, QDir(LibUnionImage_NameSpace::tiffCachePath()).entryList(QStringList() << "*.raw", QDir::Files).size());
+    ASSERT_TRUE(LibUnionImage_NameSpace::loadTiffImageCached(path, cached, errMsg));
+    EXPECT_EQ(image, cached);
+
+    EXPECT_FALSE(LibUnionImage_NameSpace::decodeTiffImage("nfoiehrf2oq3hjrfowhnefoi", image, errMsg));
+}
+
+TEST_F(gtestview, unionimage_decodeCancelToken)
+{
+    const QString path = QApplication::applicationDirPath() + "/test/jpg172.jpg";
+    const LibUnionImage_NameSpace::ImageProbeInfo probeInfo = LibUnionImage_NameSpace::probeImage(path);
+    LibUnionImage_NameSpace::DecodeCancelTokenPtr token(new LibUnionImage_NameSpace::DecodeCancelToken);
+    QImage image;
+    QString errMsg;
+    EXPECT_FALSE(LibUnionImage_NameSpace::isDecodeCancelled(token));
+    EXPECT_FALSE(LibUnionImage_NameSpace::isDecodeCancelled(LibUnionImage_NameSpace::DecodeCancelTokenPtr()));
+    EXPECT_TRUE(LibUnionImage_NameSpace::loadStaticImageFromFile(path, image, errMsg, probeInfo, QSize(), token));
+
+    // 已取消的标记使解码直接返回失败
+    token->cancel();
+    image = QImage();
+    EXPECT_FALSE(LibUnionImage_NameSpace::loadStaticImageFromFile(path, image, errMsg, probeInfo, QSize(), token));
+    EXPECT_TRUE(image.isNull());
+    EXPECT_EQ(QString("decode cancelled"), errMsg);
+    EXPECT_FALSE(LibUnionImage_NameSpace::decodeTiffImage(QApplication::applicationDirPath() + "/tif.tif", image, errMsg, token));
+}
+
+TEST_F(gtestview, unionimage_tiledImageSource)
+{
+    EXPECT_FALSE(LibUnionImage_NameSpace::TiledImageSource::isHugeImage(QSize(4000, 3000)));
+    EXPECT_TRUE(LibUnionImage_NameSpace::TiledImageSource::isHugeImage(QSize(40000, 40000)));
+
+    const QStringList paths = {QApplication::applicationDirPath() + "/test/jpg170.jpg",
+                               QApplication::applicationDirPath() + "/tif.tif"};
+    for (const QString &path : paths) {
+        const LibUnionImage_NameSpace::ImageProbeInfo info = LibUnionImage_NameSpace::probeImage(path);
+        QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> source = LibUnionImage_NameSpace::TiledImageSource::create(info);
+        if (!source) {
+            continue;
+        }
+        EXPECT_EQ(info.displaySize(), source->size());
+
+        // 区域按请求尺寸输出，超出图片的部分被裁掉
+        const QRect rect(source->size().width() / 4, source->size().height() / 4,
+                         source->size().width() / 2, source->size().height() / 2);
+        EXPECT_EQ(rect.size(), source->readRegion(rect).size());
+        EXPECT_EQ(QSize(32, 32), source->readRegion(rect, QSize(32, 32)).size());
+        EXPECT_TRUE(source->readRegion(QRect(-100, -100, 50, 50)).isNull());
+
+        const QImage preview = source->readPreview(QSize(64, 64));
+        EXPECT_LE(preview.width(), 64);
+        EXPECT_LE(preview.height(), 64);
+    }
+}
+
+TEST_F(gtestview, unionimage_loadStaticImageProgressive)
+{
+    const QString path = QApplication::applicationDirPath() + "/test/jpg170.jpg";
+    int calls = 0;
+    LibUnionImage_NameSpace::ProgressiveOptions options;
+    options.previewSize = QSize(64, 64);
+    options.updateInterval = 0;
+    auto callback = [&calls](const QImage &preview) {
+        ++calls;
+        return !preview.isNull();
+    };
+
+    // 小图直接整体解码，结果与loadStaticImageFromFile一致且不输出中间结果
+    QImage progressive;
+    QImage expected;
+    QString errMsg;
+    if (LibUnionImage_NameSpace::loadStaticImageFromFile(path, expected, errMsg)) {
+        EXPECT_TRUE(LibUnionImage_NameSpace::loadStaticImageProgressive(path, progressive, errMsg, options, callback));
+        EXPECT_EQ(expected, progressive);
+        EXPECT_EQ(0, calls);
+    }
+
+    EXPECT_FALSE(LibUnionImage_NameSpace::loadStaticImageProgressive("nfoiehrf2oq3hjrfowhnefoi", progressive, errMsg, options, callback));
+}
+
+TEST_F(gtestview, unionimage_loadStaticImageProgressiveDecoders)
+{
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+
+    // 带渐变和内嵌ICC配置的图片，覆盖逐行输出和色彩空间
+    QImage source(640, 480, QImage::Format_RGB32);
+    for (int y = 0; y < source.height(); ++y) {
+        QRgb *line = reinterpret_cast<QRgb *>(source.scanLine(y));
+        for (int x = 0; x < source.width(); ++x) {
+            line[x] = qRgb(x % 256, y % 256, (x + y) % 256);
+        }
+    }
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+    source.setColorSpace(QColorSpace::DisplayP3);
+#endif
+    const QString jpgPath = dir.filePath("progressive.jpg");
+    QImageWriter jpgWriter(jpgPath, "jpg");
+    jpgWriter.setProgressiveScanWrite(true);
+    ASSERT_TRUE(jpgWriter.write(source));
+    const QString pngPath = dir.filePath("sequential.png");
+    ASSERT_TRUE(source.save(pngPath, "png"));
+    const QString alphaPath = dir.filePath("alpha.png");
+    ASSERT_TRUE(source.convertToFormat(QImage::Format_ARGB32).save(alphaPath, "png"));
+
+    LibUnionImage_NameSpace::ProgressiveOptions options;
+    options.previewSize = QSize(64, 64);
+    options.updateInterval = 0;
+    options.minPixels = 0;
+
+    struct Case {
+        QString path;
+        bool progressive;
+        int tolerance;
+    };
+    const QList<Case> cases = {
+#ifdef USE_LIBJPEG
+        {jpgPath, true, 2},
+#else
+        {jpgPath, false, 0},
+#endif
+#ifdef USE_LIBPNG
+        {pngPath, true, 0},
+        {alphaPath, true, 0},
+#else
+        {pngPath, false, 0},
+        {alphaPath, false, 0},
+#endif
+    };
+    for (const Case &item : cases) {
+        int calls = 0;
+        auto callback = [&calls](const QImage &preview) {
+            ++calls;
+            return !preview.isNull();
+        };
+        QImage expected;
+        QImage progressive;
+        QString errMsg;
+        ASSERT_TRUE(LibUnionImage_NameSpace::loadStaticImageFromFile(item.path, expected, errMsg)) << item.path.toStdString();
+        ASSERT_TRUE(LibUnionImage_NameSpace::loadStaticImageProgressive(item.path, progressive, errMsg, options, callback)) << item.path.toStdString();
+        if (item.progressive) {
+            EXPECT_EQ(QString("use progressive decode"), errMsg) << item.path.toStdString();
+            EXPECT_GE(calls, 1) << item.path.toStdString();
+        }
+
+        // 最终结果与Qt插件的格式、色彩空间一致，JPEG允许反变换实现带来的少量误差
+        ASSERT_EQ(expected.size(), progressive.size()) << item.path.toStdString();
+        EXPECT_EQ(expected.format(), progressive.format()) << item.path.toStdString();
+#if QT_VERSION >= QT_VERSION_CHECK(5, 14, 0)
+        EXPECT_EQ(expected.colorSpace(), progressive.colorSpace()) << item.path.toStdString();
+#endif
+        int maxDiff = 0;
+        for (int y = 0; y < expected.height(); ++y) {
+            for (int x = 0; x < expected.width(); ++x) {
+                const QRgb a = expected.pixel(x, y);
+                const QRgb b = progressive.pixel(x, y);
+                maxDiff = qMax(maxDiff, qAbs(qRed(a) - qRed(b)));
+                maxDiff = qMax(maxDiff, qAbs(qGreen(a) - qGreen(b)));
+                maxDiff = qMax(maxDiff, qAbs(qBlue(a) - qBlue(b)));
+                maxDiff = qMax(maxDiff, qAbs(qAlpha(a) - qAlpha(b)));
+            }
+        }
+        EXPECT_LE(maxDiff, item.tolerance) << item.path.toStdString();
+    }
+}
+
+TEST_F(gtestview, unionimage_fileIdentity)
+{
+    const QString path = QApplication::applicationDirPath() + "/test/jpg172.jpg";
+    const QString copyPath = QApplication::applicationDirPath() + "/test/jpg172_identity.jpg";
+    QFile::remove(copyPath);
+
+    const LibUnionImage_NameSpace::FileIdentity identity = LibUnionImage_NameSpace::fileIdentity(path, true);
+    ASSERT_TRUE(identity.isValid());
+    EXPECT_EQ(identity, LibUnionImage_NameSpace::fileIdentity(path));
+    EXPECT_EQ(identity.key(), LibUnionImage_NameSpace::fileIdentity(path).key());
+    EXPECT_NE(0u, identity.contentKey());
+    EXPECT_EQ(16, identity.toString().size());
+
+    // 复制后身份不同，内容键相同
+    ASSERT_TRUE(QFile::copy(path, copyPath));
+    const LibUnionImage_NameSpace::FileIdentity copied = LibUnionImage_NameSpace::fileIdentity(copyPath, true);
+    EXPECT_NE(identity.key(), copied.key());
+    EXPECT_EQ(identity.contentKey(), copied.contentKey());
+    QFile::remove(copyPath);
+
+    EXPECT_FALSE(LibUnionImage_NameSpace::fileIdentity("nfoiehrf2oq3hjrfowhnefoi").isValid());
+    EXPECT_EQ(0u, LibUnionImage_NameSpace::sampledContentHash("nfoiehrf2oq3hjrfowhnefoi"));
+}
+
+TEST_F(gtestview, image_cachedThumbnailValidated)
+{
+    // 缩略图写入临时缓存目录，断言失败时同样清理，不影响用户的~/.cache/thumbnails
+    QTemporaryDir dir;
+    ASSERT_TRUE(dir.isValid());
+    Libutils::image::setThumbnailCachePath(dir.filePath("thumbnails"));
+    auto restore = qScopeGuard([] {
+        Libutils::image::setThumbnailCachePath(QString());
+    });
+
+    const QString path = dir.filePath("jpg173_thumb.jpg");
+    ASSERT_TRUE(QFile::copy(QApplication::applicationDirPath() + "/test/jpg173.jpg", path));
+
+    // 模拟文件管理器生成的缩略图
+    QImage thumbnail(256, 128, QImage::Format_RGB32);
+    thumbnail.fill(Qt::red);
+    thumbnail.setText("Thumb::URI", QUrl::fromLocalFile(path).toString(QUrl::FullyEncoded));
+    thumbnail.setText("Thumb::MTime", QString::number(QFileInfo(path).lastModified().toSecsSinceEpoch()));
+    const QString thumbnailFile = Libutils::image::thumbnailPath(path, Libutils::image::ThumbLarge);
+    ASSERT_TRUE(thumbnail.save(thumbnailFile, "png"));
+
+    EXPECT_EQ(QSize(256, 128), Libutils::image::cachedThumbnail(path).size());
+    EXPECT_FALSE(Libutils::image::getThumbnail(path, true).isNull());
+
+    // 原图修改时间变化后缩略图失效
+    thumbnail.setText("Thumb::MTime", QString::number(QFileInfo(path).lastModified().toSecsSinceEpoch() - 100));
+    ASSERT_TRUE(thumbnail.save(thumbnailFile, "png"));
+    EXPECT_TRUE(Libutils::image::cachedThumbnail(path).isNull());
+    EXPECT_TRUE(Libutils::image::getThumbnail(path, true).isNull());
+    EXPECT_TRUE(thumbnailFile.startsWith(dir.path()));
+}
+
+TEST_F(gtestview, imagetransform_halveImage)
+{
+    QImage image(5, 4, QImage::Format_ARGB32_Premultiplied);
+    image.fill(qRgba(200, 100, 50, 255));
+    image.setPixel(0, 0, qRgba(0, 0, 0, 255));
+
+    const QImage halved = LibUnionImage_NameSpace::halveImage(image);
+    EXPECT_EQ(QSize(2, 2), halved.size());
+    EXPECT_EQ(QImage::Format_ARGB32_Premultiplied, halved.format());
+    // 左上角2x2块中一个黑色像素，按盒式滤波取平均
+    EXPECT_EQ(qRgb(150, 75, 38), halved.pixel(0, 0));
+    EXPECT_EQ(qRgb(200, 100, 50), halved.pixel(1, 1));
+
+    // 奇数宽度的最后一列并入最后一个输出像素，3x2块取平均
+    image.fill(qRgba(0, 0, 0, 255));
+    for (int y = 0; y < image.height(); ++y) {
+        image.setPixel(4, y, qRgba(240, 120, 60, 255));
+    }
+    const QImage folded = LibUnionImage_NameSpace::halveImage(image);
+    EXPECT_EQ(qRgb(80, 40, 20), folded.pixel(1, 0));
+    EXPECT_EQ(qRgb(0, 0, 0), folded.pixel(0, 1));
+
+    // 奇数高度的最后一行同样合并，1像素宽时整列取平均
+    QImage column(1, 3, QImage::Format_RGB32);
+    column.setPixel(0, 0, qRgb(0, 0, 0));
+    column.setPixel(0, 1, qRgb(0, 0, 0));
+    column.setPixel(0, 2, qRgb(90, 90, 90));
+    EXPECT_EQ(qRgb(30, 30, 30), LibUnionImage_NameSpace::halveImage(column).pixel(0, 0));
+
+    EXPECT_EQ(QSize(1, 1), LibUnionImage_NameSpace::halveImage(QImage(1, 1, QImage::Format_RGB32)).size());
+    EXPECT_TRUE(LibUnionImage_NameSpace::halveImage(QImage()).isNull());
+}
+
+TEST_F(gtestview, tiledImageSource_memoryLevels)
+{
+    QImage image(3000, 1000, QImage::Format_RGB32);
+    image.fill(Qt::blue);
+    image.setPixel(2999, 999, qRgb(255, 0, 0));
+
+    QSharedPointer<LibUnionImage_NameSpace::TiledImageSource> source = LibUnionImage_NameSpace::TiledImageSource::fromImage(image);
+    ASSERT_FALSE(source.isNull());
+    EXPECT_EQ(LibUnionImage_NameSpace::TiledImageSource::BackendMemory, source->backend());
+    EXPECT_EQ(QSize(3000, 1000), source->size());
+    EXPECT_EQ(image, source->image());
+
+    // 原始分辨率的分块直接裁剪
+    const QImage tile = source->readRegion(QRect(2488, 488, 512, 512));
+    EXPECT_EQ(QSize(512, 512), tile.size());
+    EXPECT_EQ(qRgb(255, 0, 0), tile.pixel(511, 511));
+
+    // 缩小的分块从对应级别裁剪
+    EXPECT_EQ(QSize(256, 256), source->readRegion(QRect(0, 0, 512, 512), QSize(256, 256)).size());
+    EXPECT_EQ(512, source->readPreview(QSize(512, 512)).width());
+
+    EXPECT_TRUE(LibUnionImage_NameSpace::TiledImageSource::fromImage(QImage()).isNull());
+}